@@ -0,0 +1,133 @@
+#include "AnomalyDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+namespace {
+    const double MAX_Z = 3.0;
+}
+
+const char* AnomalyEvent::kindStr() const {
+    const char* names[] = {"dropout", "foldback", "droop", "overvoltage", "oscillation"};
+    return names[(int)kind];
+}
+
+/**
+ * ChannelDetector member function definitions
+ */
+ChannelDetector::ChannelDetector(const AnomalyConfig& config, const double& minimumSd) : cfg(config), minSd(minimumSd) {}
+
+double ChannelDetector::sd() const {
+    return std::max(std::sqrt(variance), minSd);
+}
+
+int ChannelDetector::shift() const {
+    if (cusumLow > cfg.threshold) return -1;
+    if (cusumHigh > cfg.threshold) return 1;
+    return 0;
+}
+
+void ChannelDetector::update(const double& x) {
+    ++seen;
+    if (seen == 1) {
+        baseline = x;
+        return;
+    }
+
+    // Warmup only learns the baseline, as a running mean so the first sample isn't overweighted
+    if (seen <= cfg.warmup) {
+        double delta = x - baseline;
+        baseline += delta / seen;
+        variance += (delta * (x - baseline) - variance) / seen;
+        return;
+    }
+
+    // Each sample's contribution is clipped, so one wild reading can't raise an alarm on its own. Sums are
+    // capped so a large step clears soon after the baseline catches up with it
+    double z = std::clamp((x - baseline) / this->sd(), -MAX_Z, MAX_Z);
+    cusumLow = std::clamp(cusumLow - z - cfg.slack, 0.0, 2 * cfg.threshold);
+    cusumHigh = std::clamp(cusumHigh + z - cfg.slack, 0.0, 2 * cfg.threshold);
+
+    // Large deviations that alternate sides count as crossings
+    int side = (z > 0.5) ? 1 : (z < -0.5) ? -1 : 0;
+    bool crossed = (side != 0 && lastSide != 0 && side != lastSide);
+    if (side != 0) lastSide = side;
+    crossings += cfg.alpha * ((crossed ? 1.0 : 0.0) - crossings);
+
+    // The baseline keeps following slowly, so a shift reads as one episode that clears once the new level is learned
+    double delta = x - baseline;
+    baseline += cfg.alpha * delta;
+    variance = (1 - cfg.alpha) * (variance + cfg.alpha * delta * delta);
+}
+
+void ChannelDetector::reset() {
+    seen = 0;
+    baseline = variance = 0;
+    cusumLow = cusumHigh = 0;
+    crossings = 0;
+    lastSide = 0;
+}
+
+/**
+ * AnomalyDetector member function definitions
+ */
+AnomalyDetector::AnomalyDetector(const AnomalyConfig& config) :
+    cfg(config), voltage(cfg, config.minVoltageSd), current(cfg, config.minCurrentSd) {}
+
+void AnomalyDetector::setTargets(const int& mV, const int& mA) {
+    targetVoltage = mV;
+    targetCurrent = mA;
+    this->reset();
+}
+
+void AnomalyDetector::reset() {
+    voltage.reset();
+    current.reset();
+    std::fill(std::begin(pending), std::end(pending), 0);
+    std::fill(std::begin(active), std::end(active), false);
+}
+
+bool AnomalyDetector::healthy() const {
+    return std::all_of(std::begin(pending), std::end(pending), [](const int& n) { return n == 0; });
+}
+
+std::optional<AnomalyEvent> AnomalyDetector::update(const Telemetry& sample) {
+    using Kind = AnomalyEvent::Kind;
+
+    voltage.update(sample.sinkVoltage);
+    current.update(sample.sinkMeasCurrent);
+    int vShift = voltage.shift(), iShift = current.shift();
+
+    bool dropped = targetCurrent > 0 && sample.sinkMeasCurrent <= cfg.zeroCurrent;
+    bool low = targetVoltage > 0 && sample.sinkVoltage < targetVoltage * (1 - cfg.tolerance);
+    bool high = targetVoltage > 0 && sample.sinkVoltage > targetVoltage * (1 + cfg.tolerance);
+
+    // Raw condition per kind this sample
+    bool holds[KINDS];
+    holds[(int)Kind::Dropout] = dropped;
+    holds[(int)Kind::Foldback] = !dropped && iShift < 0;
+    holds[(int)Kind::Droop] = low || vShift < 0;
+    holds[(int)Kind::Overvoltage] = high;
+    holds[(int)Kind::Oscillation] = std::max(voltage.crossingRate(), current.crossingRate()) > cfg.oscillationRate;
+
+    double scores[KINDS] = {0, current.lowScore(), voltage.lowScore(), 0, std::max(voltage.crossingRate(), current.crossingRate())};
+
+    // Most severe first, so a dropout isn't also reported as foldback or droop
+    std::optional<AnomalyEvent> event;
+    for (int k = 0; k < KINDS; ++k) {
+        if (!holds[k]) {
+            pending[k] = 0;
+            active[k] = false;
+            continue;
+        }
+
+        ++pending[k];
+        if (active[k] || pending[k] < cfg.debounce) continue;
+
+        active[k] = true;
+        if (!event) event = AnomalyEvent{(Kind)k, sample, scores[k]};
+    }
+
+    return event;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <optional>
+
+#include "Telemetry.hpp"
+
+// Detector tuning. Thresholds are in standard deviations of the learned baseline
+struct AnomalyConfig {
+    double alpha = 0.05;            // EWMA weight of a new sample in the baseline
+    double slack = 0.5;             // CUSUM allowance per sample, shifts smaller than this are ignored
+    double threshold = 8.0;         // CUSUM alarm level. Higher is less sensitive
+    int debounce = 2;               // Consecutive samples a condition must hold before it is reported
+    int warmup = 10;                // Samples used only to learn the baseline
+    double minVoltageSd = 20.0;     // mV, floor on the voltage baseline's deviation so a quiet rail isn't over-sensitive
+    double minCurrentSd = 20.0;     // mA, same for current
+    int zeroCurrent = 10;           // mA, at or below this the load counts as dropped
+    double tolerance = 0.05;        // Allowed fraction off the target voltage or current
+    double oscillationRate = 0.7;   // Fraction of samples crossing the baseline, in opposite directions, that counts as oscillation
+};
+
+// A degradation found in the status stream
+struct AnomalyEvent {
+    enum class Kind {
+        Dropout,        // Load current at zero
+        Foldback,       // Current shifted down but not to zero
+        Droop,          // Voltage below the window, or shifted down within it
+        Overvoltage,    // Voltage above the window
+        Oscillation     // Current or voltage swinging around the baseline
+    };
+
+    Kind kind;
+    Telemetry sample;   // Sample that raised the event
+    double score = 0;   // CUSUM sum or crossing rate behind the event, 0 for window checks
+
+    const char* kindStr() const;
+};
+
+/**
+ * @brief Online change-point detection on one channel.
+ * EWMA mean and variance form the baseline, and a two-sided CUSUM on the standardised deviation
+ * flags a sustained shift away from it. Constant memory however long the stream.
+ */
+class ChannelDetector
+{
+public:
+    ChannelDetector(const AnomalyConfig& config, const double& minSd);
+
+    void update(const double& x);
+
+    // -1 or +1 while a downward or upward shift is detected, 0 otherwise
+    int shift() const;
+
+    void reset();
+
+    double mean() const { return baseline; }
+    double sd() const;
+    double crossingRate() const { return crossings; }
+    double lowScore() const { return cusumLow; }
+    double highScore() const { return cusumHigh; }
+
+private:
+    const AnomalyConfig& cfg;
+    double minSd;
+
+    int seen = 0;
+    double baseline = 0, variance = 0;
+    double cusumLow = 0, cusumHigh = 0;
+    double crossings = 0;   // EWMA of alternating baseline crossings
+    int lastSide = 0;       // Side of the baseline the last large deviation was on
+};
+
+/**
+ * @brief Per-tester anomaly detection on voltage and current.
+ * Conditions are debounced, and each is reported once when it starts, not again until it clears.
+ */
+class AnomalyDetector
+{
+public:
+    explicit AnomalyDetector(const AnomalyConfig& config = AnomalyConfig());
+
+    // Targets for the window checks. Restarts the learned baselines
+    void setTargets(const int& targetVoltage, const int& targetCurrent);
+
+    // Feed a sample. Returns an event when a condition starts
+    std::optional<AnomalyEvent> update(const Telemetry& sample);
+
+    // Forget baselines and debounce state, e.g. after recovery
+    void reset();
+
+    // True if no condition held on the last sample
+    bool healthy() const;
+
+    const AnomalyConfig& config() const { return cfg; }
+
+private:
+    AnomalyConfig cfg;
+    ChannelDetector voltage, current;
+    int targetVoltage = 0, targetCurrent = 0;
+
+    static const int KINDS = 5;
+    int pending[KINDS] = {};    // Consecutive samples each condition has held
+    bool active[KINDS] = {};    // Reported and not yet cleared
+};
@@ -0,0 +1,229 @@
+#include "AsyncLog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace {
+    const size_t RING_SIZE = 4096; // Power of two
+    const size_t MAX_BATCH = 512;
+    const int DEFAULT_COLOR = 7;
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        int color;
+        bool isError;
+        std::string text;
+    };
+
+    struct Line {
+        int color;
+        bool isError;
+        std::string text;
+    };
+
+    /**
+     * Bounded multi-producer ring with per-slot sequence numbers. A producer claims a slot with one
+     * compare-exchange on the tail, fills it, then publishes it by bumping the slot's sequence. Only
+     * the writer thread consumes, so the head needs no atomics of its own.
+     */
+    class Pipeline
+    {
+    public:
+        Log::Overflow policy = Log::Overflow::Block;
+        std::chrono::microseconds maxWait = std::chrono::milliseconds(50);
+
+        std::atomic<unsigned long long> dropped{0}, delayed{0}, written{0}, batches{0};
+
+        Pipeline() : ring(new Slot[RING_SIZE]) {
+            for (size_t i = 0; i < RING_SIZE; ++i) {
+                ring[i].seq.store(i, std::memory_order_relaxed);
+                ring[i].text.reserve(128);
+            }
+            writer = std::thread(&Pipeline::writerLoop, this);
+        }
+
+        // Drain what's left on exit
+        ~Pipeline() {
+            stopping.store(true);
+            wake.fetch_add(1, std::memory_order_release);
+            wake.notify_one();
+            writer.join();
+        }
+
+        bool tryPush(int color, bool isError, std::string_view text) {
+            size_t pos = tail.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &ring[pos & (RING_SIZE - 1)];
+                intptr_t diff = (intptr_t)slot->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false; // Full
+                } else {
+                    pos = tail.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->color = color;
+            slot->isError = isError;
+            slot->text.assign(text); // Slot keeps its capacity, so this rarely allocates
+            slot->seq.store(pos + 1, std::memory_order_release);
+
+            wake.fetch_add(1, std::memory_order_release);
+            wake.notify_one();
+            return true;
+        }
+
+        void flush() {
+            // Everything claimed before now must be printed
+            size_t target = tail.load(std::memory_order_acquire);
+            while (printed.load(std::memory_order_acquire) < target) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+
+    private:
+        std::unique_ptr<Slot[]> ring;
+        alignas(64) std::atomic<size_t> tail{0};
+        alignas(64) size_t head = 0;            // Writer only
+        std::atomic<size_t> printed{0};         // Lines up to here are on the console
+        std::atomic<uint32_t> wake{0};
+        std::atomic<bool> stopping{false};
+        std::thread writer;
+
+        // Move up to 'batch.size()' published lines out of the ring. Returns the number taken
+        size_t drain(std::vector<Line>& batch) {
+            size_t n = 0;
+            while (n < batch.size()) {
+                Slot& slot = ring[head & (RING_SIZE - 1)];
+                if (slot.seq.load(std::memory_order_acquire) != head + 1) break;
+
+                batch[n].color = slot.color;
+                batch[n].isError = slot.isError;
+                std::swap(batch[n].text, slot.text); // Buffers cycle between ring and batch
+                slot.seq.store(head + RING_SIZE, std::memory_order_release);
+
+                ++head;
+                ++n;
+            }
+            return n;
+        }
+
+        void print(std::vector<Line>& batch, size_t n) {
+            // Group by color so each tester's lines go out together. Stable, so every tester's lines stay in order
+            std::vector<size_t> order(n);
+            for (size_t i = 0; i < n; ++i) order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return batch[a].color < batch[b].color; });
+
+#ifdef _WIN32
+            static HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+#endif
+            std::string chunk;
+            for (size_t i = 0; i < n; ++i) {
+                const Line& line = batch[order[i]];
+                chunk += line.text;
+                chunk += '\n';
+
+                // Write when the next line needs a different stream or color
+                bool last = (i + 1 == n);
+                if (!last && batch[order[i + 1]].isError == line.isError && batch[order[i + 1]].color == line.color) continue;
+
+#ifdef _WIN32
+                SetConsoleTextAttribute(hConsole, line.color);
+#endif
+                std::ostream& output = line.isError ? std::cerr : std::cout;
+                output.write(chunk.data(), chunk.size());
+                output.flush();
+                chunk.clear();
+            }
+
+#ifdef _WIN32
+            SetConsoleTextAttribute(hConsole, DEFAULT_COLOR);
+#endif
+        }
+
+        void writerLoop() {
+            std::vector<Line> batch(MAX_BATCH);
+
+            while (true) {
+                uint32_t seen = wake.load(std::memory_order_acquire);
+
+                size_t n = this->drain(batch);
+                if (n > 0) {
+                    this->print(batch, n);
+                    written.fetch_add(n, std::memory_order_relaxed);
+                    batches.fetch_add(1, std::memory_order_relaxed);
+                    printed.store(head, std::memory_order_release);
+                    continue;
+                }
+
+                if (stopping.load()) {
+                    // A producer may have claimed a slot and not published it yet. Stop once nothing is claimed
+                    if (tail.load(std::memory_order_acquire) == head) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                wake.wait(seen, std::memory_order_acquire); // Returns once a producer bumps the counter
+            }
+        }
+    };
+
+    Pipeline& pipeline() {
+        static Pipeline instance; // Started on first use, drained and joined at exit
+        return instance;
+    }
+}
+
+namespace Log {
+
+void configure(const Overflow& policy, const std::chrono::microseconds& maxWait) {
+    Pipeline& p = pipeline();
+    p.policy = policy;
+    p.maxWait = maxWait;
+}
+
+bool submit(int color, bool isError, std::string_view text) {
+    Pipeline& p = pipeline();
+    if (p.tryPush(color, isError, text)) return true;
+
+    // Full. Backpressure for a bounded time, then give up on the line
+    if (p.policy == Overflow::Block) {
+        p.delayed.fetch_add(1, std::memory_order_relaxed);
+        auto deadline = std::chrono::steady_clock::now() + p.maxWait;
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+            if (p.tryPush(color, isError, text)) return true;
+        }
+    }
+
+    p.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void flush() {
+    pipeline().flush();
+}
+
+Stats stats() {
+    Pipeline& p = pipeline();
+    Stats s;
+    s.written = p.written.load();
+    s.dropped = p.dropped.load();
+    s.delayed = p.delayed.load();
+    s.batches = p.batches.load();
+    return s;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Asynchronous console logging.
+ * Testers hand finished lines to a lock-free multi-producer ring, and a single writer thread drains it,
+ * grouping lines by color so each batch costs a few console writes and color changes instead of a
+ * locked, flushed write per line. Lines of the same color keep their order.
+ */
+namespace Log {
+    // What a producer does when the ring is full
+    enum class Overflow {
+        Block,  // Wait for space up to maxWait, then drop the line
+        Drop    // Drop the line immediately
+    };
+
+    struct Stats {
+        unsigned long long written = 0;  // Lines printed
+        unsigned long long dropped = 0;  // Lines lost to a full ring
+        unsigned long long delayed = 0;  // Lines that had to wait for space
+        unsigned long long batches = 0;  // Writer passes that printed something
+    };
+
+    // Set overflow policy. Call before the first line is logged
+    void configure(const Overflow& policy, const std::chrono::microseconds& maxWait = std::chrono::milliseconds(50));
+
+    // Queue one line. 'color' is a console text attribute, stderr is used if isError is set. Returns false if dropped
+    bool submit(int color, bool isError, std::string_view text);
+
+    // Block until every line queued so far has been printed
+    void flush();
+
+    Stats stats();
+}
@@ -0,0 +1,230 @@
+#include "AsyncTester.hpp"
+#include "ConsoleCapture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+Async::Task<std::string> AsyncTester::runCommand(std::string commandArg) const {
+    tester::CommandBatch batch = Tester.batch();
+    batch.queue(tester::CommandBatch::Kind::Command, commandArg);
+    co_return std::move((co_await this->run(std::move(batch))).front().output);
+}
+
+Async::Task<std::string> AsyncTester::spawnCommand(std::string commandArg) const {
+    if (Tester.token.cancelled()) throw JobCancelled("(" + Tester.serialNumber + ") Command cancelled.");
+
+    if (Capture::isReplaying()) {
+        std::string key = captureKey(Tester, commandArg);
+        std::string_view output;
+        uint32_t delayMicros = 0;
+        if (!Capture::replay(key, output, &delayMicros)) throw std::runtime_error("No recorded response for: " + key);
+
+        std::string copy(output);
+        if (delayMicros > 0) co_await Async::sleepFor(std::chrono::microseconds(delayMicros), Tester.token);
+        co_return copy;
+    }
+
+    std::vector<std::string> argv = consoleArgv(Tester, commandArg);
+    std::chrono::milliseconds timeout = commandTimeout(commandArg);
+    auto start = std::chrono::steady_clock::now();
+    Async::ProcessResult result;
+    try {
+        result = co_await Async::runProcess(std::move(argv), timeout, Tester.token);
+    } catch (const Spawn::Timeout&) {
+        Tester.noteCommand(true);
+        throw timeoutError(Tester, commandArg, timeout);
+    }
+    Tester.noteCommand(false);
+
+    if (Capture::isRecording()) {
+        uint32_t latency = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        Capture::record(captureKey(Tester, commandArg), result.output, result.exitCode, latency);
+    }
+
+    co_return std::move(result.output);
+}
+
+Async::Task<std::vector<std::string>> AsyncTester::runOnSession(std::vector<std::string> commands, std::chrono::milliseconds timeout, std::string what) const {
+    std::vector<std::string> outputs;
+    ConsoleSession* session = Tester.session.get();
+    Async::Reactor* reactor = Async::Reactor::current();
+    if (Capture::isReplaying() || session == nullptr || reactor == nullptr) co_return outputs;
+#ifdef _WIN32
+    if (!session->bindTo(reactor->completionPort())) co_return outputs;
+#endif
+    Tester.token.throwIfCancelled("(" + Tester.serialNumber + ") Command cancelled.");
+    if (!session->begin(commands)) co_return outputs;
+
+    // The watchdog or a cancel kills the worker, which ends the pending read
+    bool done = false, timedOut;
+    {
+        Spawn::Deadline deadline(timeout, [session]() { session->kill(); });
+        Cancel::Registration onCancel = Tester.token.onCancel([session]() { session->kill(); });
+        char chunk[4096];
+        while (!done) {
+            size_t n = co_await Async::Reactor::ReadAwaiter{*reactor, session->outputPipe(), chunk, sizeof(chunk)};
+            if (n == 0) break;
+            done = session->deliver(chunk, n, outputs);
+        }
+        timedOut = deadline.expired();
+    }
+
+    size_t finished = session->lastCompleted();
+    try {
+        session->conclude(done, timedOut, timeout, Tester.token);
+    } catch (const Spawn::Timeout&) {
+        Tester.noteCommand(true);
+        throw timeoutError(Tester, what, timeout);
+    }
+    outputs.resize(finished);
+    co_return outputs;
+}
+
+Async::Task<std::vector<tester::CommandBatch::StepResult>> AsyncTester::run(tester::CommandBatch batch) const {
+    std::vector<tester::CommandBatch::StepResult> results = batch.prepare();
+
+    for (const tester::CommandBatch::Round& round : batch.rounds()) {
+        if (!round.steps.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            std::string what = (round.steps.size() == 1) ? batch.steps[round.steps[0]].args : "batch"; // Names the command if it times out
+            std::vector<std::string> outputs = co_await this->runOnSession(round.commands, round.timeout, std::move(what));
+            batch.recordRound(round, outputs, outputs.size(), start);
+
+            // Steps the worker didn't finish are spawned, as in the blocking batch
+            for (size_t i = outputs.size(); i < round.steps.size(); ++i) outputs.push_back(co_await this->spawnCommand(batch.steps[round.steps[i]].args));
+            batch.parseRound(round, outputs, results);
+        }
+
+        if (round.waitAfter > 0) {
+            co_await Async::sleepFor(std::chrono::milliseconds(round.waitAfter), Tester.token);
+            Tester.token.throwIfCancelled("(" + Tester.serialNumber + ") Command batch cancelled.");
+        }
+    }
+
+    // Reactor time, which is virtual in a replay
+    for (tester::CommandBatch::StepResult& result : results) {
+        if (result.kind == tester::CommandBatch::Kind::Status) result.Stats.timestamp = Async::now();
+    }
+    co_return results;
+}
+
+Async::Task<tester::status> AsyncTester::getStatus() const {
+    std::string output = co_await this->runCommand("-s");
+    tester::status Stats = Tester.parseStatus(output);
+    if (!Stats.isValid()) throw std::runtime_error("(" + Tester.serialNumber + ") Tester failed to respond.");
+    Stats.timestamp = Async::now(); // Reactor time, which is virtual in a replay
+    co_return Stats;
+}
+
+Async::Task<tester::status> AsyncTester::waitForSettle(std::string transition, int targetVoltage, int targetCurrent, std::chrono::milliseconds timeout, int leaveVoltage) const {
+    co_return co_await this->waitForSettle(Tester.batch(), std::move(transition), targetVoltage, targetCurrent, timeout, leaveVoltage);
+}
+
+Async::Task<tester::status> AsyncTester::waitForSettle(tester::CommandBatch lead, std::string transition, int targetVoltage, int targetCurrent,
+                                                       std::chrono::milliseconds timeout, int leaveVoltage) const {
+    using namespace std::chrono;
+
+    const tester::SettleConfig& cfg = Tester.settleConfig;
+    auto startTime = Async::now();
+    auto deadline = startTime + timeout;
+
+    tester::status Stats;
+    tester::SettleTracker tracker;
+    tracker.leaveVoltage = leaveVoltage;
+    bool settled = false;
+
+    bool first = true;
+
+    while (true) {
+        auto sampleTime = Async::now();
+        if (first) { // Lead steps and the first sample share a round trip
+            Stats = (co_await this->run(std::move(lead.getStatus()))).back().Stats;
+            if (!Stats.isValid()) throw std::runtime_error("(" + Tester.serialNumber + ") Tester failed to respond.");
+            first = false;
+        } else Stats = co_await this->getStatus();
+
+        if (tracker.update(cfg, Stats, targetVoltage, targetCurrent)) {
+            settled = true;
+            break;
+        }
+        if (Async::now() >= deadline) break;
+
+        // Keep sample rate, but never sleep past the timeout
+        co_await Async::sleepUntil(std::min(sampleTime + milliseconds(cfg.pollInterval), deadline), Tester.token);
+    }
+
+    Tester.recordSettle(transition, (uint32_t)duration_cast<milliseconds>(Async::now() - startTime).count(), settled);
+    co_return Stats;
+}
+
+Async::Task<tester::status> AsyncTester::setProfile(std::string profileNumStr) const {
+    // Use advertised voltage as target when known so the old rail isn't mistaken for a settled one. Otherwise
+    // wait for the rail to move off its present voltage
+    const Pdo* pdo = Tester.sink.pdos.find(std::string_view(profileNumStr));
+    bool known = pdo != nullptr && !pdo->isVariableVoltage;
+    int targetVoltage = (known) ? pdo->maxVoltage : 0;
+    int before = (known) ? -1 : (co_await this->getStatus()).sinkVoltage;
+
+    // Profile change and first status read go out together
+    co_return co_await this->waitForSettle(Tester.batch().setProfile(profileNumStr), "-v " + profileNumStr, targetVoltage, -1,
+                                           std::chrono::milliseconds(3000), before);
+}
+
+Async::Task<tester::status> AsyncTester::setVariableVoltageProfile(std::string profileNumStr, int sinkVoltage) const {
+    std::string args = "-v " + profileNumStr + "," + std::to_string(sinkVoltage);
+    co_return co_await this->waitForSettle(Tester.batch().setVariableVoltageProfile(profileNumStr, sinkVoltage), args, sinkVoltage, -1,
+                                           std::chrono::milliseconds(3000));
+}
+
+Async::Task<tester::status> AsyncTester::setLoad(std::string loadCurrent, std::string loadSpeed, std::chrono::milliseconds settleTimeout) const {
+    co_return co_await this->waitForSettle(Tester.batch().setLoad(loadCurrent, loadSpeed), "-l " + loadCurrent, 0, std::stoi(loadCurrent), settleTimeout);
+}
+
+Async::Task<tester::status> AsyncTester::unload() const {
+    co_await this->setProfile("1");
+    co_return co_await this->setLoad("0");
+}
+
+Async::Task<bool> AsyncTester::isConnected() const {
+    std::string output = co_await this->runCommand("-c");
+    co_return Tester.parseConnection(output);
+}
+
+Async::Task<bool> AsyncTester::reconnect() const {
+    // Both toggles and the check go out in one round trip
+    co_return (co_await this->run(Tester.batch().disconnect().connect().isConnected())).back().connected;
+}
+
+Async::Task<std::vector<PdoChange>> AsyncTester::refreshProfiles() const {
+    std::string output = co_await this->runCommand("-p");
+    co_return Tester.sink.applyProfiles(output);
+}
+
+namespace {
+    // Poll one tester family. Each family has its own virtual tester, so both polls can run at once
+    Async::Task<std::vector<std::string>> pollFamily(std::string testerType) {
+        tester virtualtester;
+        virtualtester.assignType(testerType);
+        co_return parseTesterList(co_await AsyncTester(virtualtester).runCommand("-f"));
+    }
+}
+
+Async::Task<testerList> findTestersAsync() {
+    // Both polls run at once, merged PM240 first so numbering matches findTesters()
+    auto [pm240, pm125] = co_await Async::all(pollFamily("PM240"), pollFamily("PM125"));
+
+    testerList list;
+    for (const auto& [testerType, found] : {std::pair<std::string, std::vector<std::string>&>{"PM240", pm240}, {"PM125", pm125}}) {
+        for (const std::string& sn : found) {
+            list.testers.push_back(sn);
+            list.type.push_back(testerType);
+        }
+    }
+
+    co_return list;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "tester.hpp"
+#include "Reactor.hpp"
+
+/**
+ * @brief Coroutine versions of the tester operations, for use on an Async::Reactor.
+ * Same commands and settle rules as the blocking tester functions, but every console call and
+ * poll interval suspends the coroutine instead of the thread:
+ *
+ *     tester::status Stats = co_await t.setLoad("3000");
+ *
+ * Commands go through the tester's console worker when it has one, read on the reactor, and are
+ * spawned directly otherwise. Arguments are taken by value since a coroutine can outlive the
+ * caller's temporaries.
+ */
+class AsyncTester
+{
+public:
+    explicit AsyncTester(tester& parent) : Tester(parent) {}
+
+    tester& Tester;
+
+    // Run a console switch and return its output. Honours record/replay like runCommand()
+    Async::Task<std::string> runCommand(std::string commandArg) const;
+
+    // Send a command batch, see tester::CommandBatch::run()
+    Async::Task<std::vector<tester::CommandBatch::StepResult>> run(tester::CommandBatch batch) const;
+
+    // Read status from tester. Throws if the tester didn't report every field
+    Async::Task<tester::status> getStatus() const;
+
+    // Poll status until voltage and current settle, see tester::waitForSettle()
+    Async::Task<tester::status> waitForSettle(std::string transition, int targetVoltage, int targetCurrent, std::chrono::milliseconds timeout, int leaveVoltage = -1) const;
+
+    // As above, sending 'lead' in the same round trip as the first sample
+    Async::Task<tester::status> waitForSettle(tester::CommandBatch lead, std::string transition, int targetVoltage, int targetCurrent,
+                                              std::chrono::milliseconds timeout, int leaveVoltage = -1) const;
+
+    // Set DUT profile
+    Async::Task<tester::status> setProfile(std::string profileNumStr) const;
+
+    // Set DUT variable voltage profile
+    Async::Task<tester::status> setVariableVoltageProfile(std::string profileNumStr, int sinkVoltage) const;
+
+    // Set load current. settleTimeout is the longest time to wait for the current to settle
+    Async::Task<tester::status> setLoad(std::string maxCurrent, std::string loadSpeed = "200",
+                                        std::chrono::milliseconds settleTimeout = std::chrono::milliseconds(500)) const;
+
+    // Set load to zero
+    Async::Task<tester::status> unload() const;
+
+    // Return sink connection status
+    Async::Task<bool> isConnected() const;
+
+    // Toggle sink internal connection closed then open. Returns true if the sink is connected afterwards
+    Async::Task<bool> reconnect() const;
+
+    // Fetch the current advertisement, see tester::Sink::refreshProfiles()
+    Async::Task<std::vector<PdoChange>> refreshProfiles() const;
+
+private:
+    // runCommand() without the console worker: a replayed response or a direct spawn
+    Async::Task<std::string> spawnCommand(std::string commandArg) const;
+
+    // Send one round through the console worker. Returns the outputs of the commands it finished, none without a worker.
+    // 'what' names the round in a timeout error
+    Async::Task<std::vector<std::string>> runOnSession(std::vector<std::string> commands, std::chrono::milliseconds timeout, std::string what) const;
+};
+
+// Find connected PM240 and PM125 testers without blocking the reactor. Unlike findTesters(), finding none isn't an error
+Async::Task<testerList> findTestersAsync();
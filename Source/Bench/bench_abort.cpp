@@ -0,0 +1,171 @@
+/**
+ * Abort to safe state: how long after Ctrl+C every tester in a rack has unloaded, and whether any console command
+ * outlives the abort.
+ *
+ * Half the simulated rack runs on an Async::Reactor the way batstress does, half on blocking threads the way
+ * usbvalidator and the batstress sweep do. In each half, every other tester is stuck in a console command that
+ * never answers, the rest poll and sleep between quick ones. The benchmark's own executable stands in for the
+ * console. Ctrl+C arrives once everyone is busy, and every tester must then unload through an uncancellable
+ * command:
+ *
+ *     bench_abort.exe 16
+ */
+
+#include "../CancelToken.hpp"
+#include "../ProcessSpawn.hpp"
+#include "../Reactor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    namespace fs = std::filesystem;
+
+    const std::chrono::milliseconds ABORT_AFTER(700); // Long enough for every tester to be mid-command
+
+    // Hung console: append to 'path' every 20ms. Gives up after a minute so a leak can't run forever
+    int beat(const std::string& path) {
+        for (int i = 0; i < 3000; ++i) {
+            std::ofstream(path, std::ios::app) << '.';
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return 0;
+    }
+
+    // True if the heartbeat at 'path' is still growing
+    bool beating(const fs::path& path) {
+        std::error_code ec;
+        auto before = fs::file_size(path, ec);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return fs::file_size(path, ec) != before;
+    }
+
+    // Console commands for simulated tester 'i'
+    struct Commands {
+        std::vector<std::string> busy;   // Stuck for good on odd testers, answers in 50ms on even ones
+        std::vector<std::string> unload; // Simulated "-l 0" plus settle
+    };
+
+    Commands commandsFor(const std::string& self, const fs::path& heartbeat, const int& i) {
+        Commands c;
+        c.busy = (i % 2) ? std::vector<std::string>{self, "--hang", heartbeat.string()} : std::vector<std::string>{self, "--sleep", "50"};
+        c.unload = {self, "--sleep", "20"};
+        return c;
+    }
+
+    double sinceAbort() {
+        return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(Clock::now() - Cancel::global().cancelledAt()).count();
+    }
+
+    Async::Task<void> reactorTester(Commands c, Cancel::Token job, std::vector<double>& latency) {
+        bool aborted = false;
+        try {
+            while (true) {
+                co_await Async::runProcess(c.busy, std::chrono::milliseconds(0), job);
+                co_await Async::sleepFor(std::chrono::seconds(1), job);
+                job.throwIfCancelled();
+            }
+        } catch (const JobCancelled&) {
+            aborted = true;
+        }
+        if (aborted) {
+            co_await Async::runProcess(c.unload, std::chrono::milliseconds(0), Cancel::Token());
+            latency.push_back(sinceAbort());
+        }
+    }
+
+    double threadTester(Commands c, Cancel::Token job) {
+        Spawn::Runner runner;
+        try {
+            while (true) {
+                runner.run(c.busy, std::chrono::milliseconds(0), job);
+                if (!job.sleepFor(std::chrono::seconds(1))) job.throwIfCancelled();
+            }
+        } catch (const JobCancelled&) {}
+        runner.run(c.unload, std::chrono::milliseconds(0), Cancel::Token());
+        return sinceAbort();
+    }
+
+    void print(const char* label, const std::vector<double>& latency, const int& expected) {
+        double total = 0, worst = 0;
+        for (double d : latency) {
+            total += d;
+            worst = std::max(worst, d);
+        }
+        std::cout << label << ": " << latency.size() << "/" << expected << " testers unloaded, mean " << std::fixed << std::setprecision(1)
+                  << ((latency.empty()) ? 0.0 : total / latency.size()) << "ms, max " << worst << "ms after Ctrl+C" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string self = fs::absolute(argv[0]).string();
+    if (argc == 3 && std::string(argv[1]) == "--hang") return beat(argv[2]);
+    if (argc == 3 && std::string(argv[1]) == "--sleep") {
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::atoi(argv[2])));
+        return 0;
+    }
+
+    int count = (argc > 1) ? std::atoi(argv[1]) : 16;
+    if (count < 2 || count > 256) {
+        std::cerr << "Usage: bench_abort [testers, 2-256]" << std::endl;
+        return -1;
+    }
+    int onReactor = count - count / 2, onThreads = count / 2;
+
+    // Named per run so a console leaked by an earlier run can't make this one look leaky
+    fs::path heartbeat = fs::temp_directory_path() / ("bench_abort." + std::to_string(Clock::now().time_since_epoch().count()) + ".beat");
+
+    try {
+        Async::Reactor reactor;
+        std::vector<double> reactorLatency;
+        for (int i = 0; i < onReactor; ++i) {
+            reactor.spawn(reactorTester(commandsFor(self, heartbeat, i), Cancel::global().child(), reactorLatency), "SIM" + std::to_string(i + 1));
+        }
+
+        std::vector<std::future<double>> threads;
+        for (int i = 0; i < onThreads; ++i) {
+            threads.push_back(std::async(std::launch::async, threadTester, commandsFor(self, heartbeat, i), Cancel::global().child()));
+        }
+
+        std::atomic<bool> abortRequested{false};
+        Cancel::Registration wakeOnAbort = Cancel::global().onCancel([&reactor]() { reactor.wake(); });
+        std::thread ctrlC([&abortRequested]() {
+            std::this_thread::sleep_for(ABORT_AFTER);
+            abortRequested = true;
+            Cancel::global().cancel();
+        });
+        reactor.run(&abortRequested);
+        ctrlC.join();
+
+        std::vector<double> threadLatency;
+        for (std::future<double>& f : threads) threadLatency.push_back(f.get());
+
+        print("Async::Reactor", reactorLatency, onReactor);
+        print("Threads", threadLatency, onThreads);
+
+        bool leaked = beating(heartbeat);
+        std::error_code ec;
+        fs::remove(heartbeat, ec);
+        if (leaked) std::cout << "A hung console command outlived the abort" << std::endl;
+        if (reactor.failures() > 0) std::cout << reactor.failures() << " reactor tester(s) failed" << std::endl;
+
+        bool ok = (int)reactorLatency.size() == onReactor && (int)threadLatency.size() == onThreads && !leaked && reactor.failures() == 0;
+        return (ok) ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,181 @@
+/**
+ * Completion tracking under load: a few hundred simulated testers finishing at their own pace.
+ *
+ * Every simulated tester runs a handful of short steps, once as a Sched::TaskGroup job and once as a coroutine on
+ * an Async::Reactor. Some fail and some are retired, and the first one runs several times longer than the rest. The
+ * benchmark checks that every outcome is reported exactly once with the right status, that failures name only the
+ * testers that failed, and that the slow tester holds up nobody else's report:
+ *
+ *     bench_completion.exe 300
+ */
+
+#include "../Completion.hpp"
+#include "../Reactor.hpp"
+#include "../Scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // What simulated tester 'i' does
+    struct Plan {
+        std::string name;
+        int steps;
+        std::chrono::milliseconds stepTime;
+        JobOutcome::Status ending;
+    };
+
+    Plan planFor(const int& i) {
+        char name[32];
+        snprintf(name, sizeof(name), "SIM240-%04d", i + 1);
+
+        Plan plan{name, 3 + i % 5, std::chrono::milliseconds(5 + (i * 37) % 20), JobOutcome::Status::Passed};
+        if (i == 0) plan.stepTime = std::chrono::milliseconds(500); // One slow tester, finishes well after the rest
+        if (i % 17 == 5) plan.ending = JobOutcome::Status::Failed;
+        else if (i % 23 == 7) plan.ending = JobOutcome::Status::Cancelled;
+        return plan;
+    }
+
+    // End a simulated tester's last step the way its plan says
+    void finish(const Plan& plan) {
+        if (plan.ending == JobOutcome::Status::Failed) throw std::runtime_error("(" + plan.name + ") Tester failed to respond.");
+        if (plan.ending == JobOutcome::Status::Cancelled) throw JobCancelled("Tester disconnected.");
+    }
+
+    // Outcomes seen through the completion callback, checked against the plans
+    class Tally
+    {
+    public:
+        explicit Tally(const std::vector<Plan>& p) : plans(p), reports(p.size(), 0), finishedAt(p.size()), lag(p.size()) {}
+
+        void finished(const int& i) { finishedAt[i] = Clock::now(); }
+
+        void report(const JobOutcome& outcome) {
+            int i = std::atoi(outcome.name.c_str() + 7) - 1;
+            if (i < 0 || i >= (int)plans.size()) throw std::runtime_error("Outcome for unknown tester " + outcome.name);
+            ++reports[i];
+            lag[i] = Clock::now() - finishedAt[i];
+            if (outcome.status != plans[i].ending) ++wrongStatus;
+            if (i == 0) slowReportedAfter = seen;
+            ++seen;
+        }
+
+        // Print a summary, returns false if anything was reported wrongly
+        bool check(const char* label, const CompletionLog& log, const Clock::duration& wall) const {
+            size_t expectedFailures = 0, missing = 0, repeated = 0;
+            for (size_t i = 0; i < plans.size(); ++i) {
+                if (reports[i] == 0) ++missing;
+                if (reports[i] > 1) ++repeated;
+                if (plans[i].ending == JobOutcome::Status::Failed) ++expectedFailures;
+            }
+
+            // failedNames() lists failures in completion order, so compare as sets
+            std::vector<std::string> named, planned;
+            for (const JobOutcome& o : log.outcomes()) {
+                if (o.status == JobOutcome::Status::Failed) named.push_back(o.name);
+            }
+            for (const Plan& p : plans) {
+                if (p.ending == JobOutcome::Status::Failed) planned.push_back(p.name);
+            }
+            std::sort(named.begin(), named.end());
+            bool namesMatch = named == planned;
+
+            Clock::duration total{0}, worst{0};
+            for (const Clock::duration& d : lag) {
+                total += d;
+                worst = std::max(worst, d);
+            }
+            auto us = [](const Clock::duration& d) { return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(d).count(); };
+
+            bool ok = missing == 0 && repeated == 0 && wrongStatus == 0 && log.failures() == expectedFailures && namesMatch &&
+                      slowReportedAfter == plans.size() - 1;
+            std::cout << label << ": " << plans.size() << " testers in " << std::fixed << std::setprecision(0)
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(wall).count() << "ms, " << log.failures() << " failed, report lag mean "
+                      << std::setprecision(1) << us(total / (long long)lag.size()) << "us, max " << us(worst) << "us, slow tester reported "
+                      << slowReportedAfter + 1 << "/" << plans.size() << (ok ? ", OK" : ", MISMATCH") << std::endl;
+            if (missing > 0 || repeated > 0) std::cout << "  " << missing << " outcome(s) missing, " << repeated << " reported twice" << std::endl;
+            if (wrongStatus > 0) std::cout << "  " << wrongStatus << " outcome(s) with the wrong status" << std::endl;
+            if (!namesMatch) std::cout << "  Failed testers named: " << log.failedNames() << std::endl;
+            return ok;
+        }
+
+    private:
+        const std::vector<Plan>& plans;
+        std::vector<int> reports;
+        std::vector<Clock::time_point> finishedAt;
+        std::vector<Clock::duration> lag;
+        size_t wrongStatus = 0;
+        size_t seen = 0;
+        size_t slowReportedAfter = 0;   // Outcomes reported before the slow tester's
+    };
+
+    bool runScheduler(const std::vector<Plan>& plans) {
+        Tally tally(plans);
+        Sched::Scheduler scheduler(4); // Far fewer workers than testers, every step sleeps instead of blocking
+        Sched::TaskGroup group(scheduler);
+        group.completions().onComplete([&tally](const JobOutcome& o) { tally.report(o); });
+
+        auto start = Clock::now();
+        for (int i = 0; i < (int)plans.size(); ++i) {
+            group.spawn([&plans, &tally, i, step = 0](Sched::TaskContext&) mutable {
+                const Plan& plan = plans[i];
+                if (++step < plan.steps) return Sched::Step::sleep(plan.stepTime);
+
+                tally.finished(i);
+                finish(plan);
+                return Sched::Step::done();
+            }, plans[i].name);
+        }
+        group.wait();
+
+        return tally.check("Scheduler", group.completions(), Clock::now() - start);
+    }
+
+    Async::Task<void> simulated(const Plan& plan, Tally& tally, int i) {
+        for (int step = 1; step < plan.steps; ++step) co_await Async::sleepFor(plan.stepTime);
+
+        tally.finished(i);
+        finish(plan);
+    }
+
+    bool runReactor(const std::vector<Plan>& plans) {
+        Tally tally(plans);
+        Async::Reactor reactor;
+        reactor.completions().onComplete([&tally](const JobOutcome& o) { tally.report(o); });
+
+        auto start = Clock::now();
+        for (int i = 0; i < (int)plans.size(); ++i) reactor.spawn(simulated(plans[i], tally, i), plans[i].name);
+        reactor.run();
+
+        return tally.check("Reactor", reactor.completions(), Clock::now() - start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = (argc > 1) ? std::atoi(argv[1]) : 300;
+    if (count < 2 || count > 9999) {
+        std::cerr << "Usage: bench_completion [testers, 2-9999]" << std::endl;
+        return -1;
+    }
+
+    std::vector<Plan> plans;
+    for (int i = 0; i < count; ++i) plans.push_back(planFor(i));
+
+    try {
+        bool ok = runScheduler(plans);
+        ok = runReactor(plans) && ok;
+        return (ok) ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
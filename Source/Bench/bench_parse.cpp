@@ -0,0 +1,116 @@
+/**
+ * Status parses per second through scanStatus(), the scanner every "-s" response goes through.
+ *
+ * Without arguments the built-in PM240 and PM125 responses are parsed. Pass a capture file (see
+ * ConsoleCapture.hpp) to parse the "-s" responses recorded from real testers instead:
+ *
+ *     bench_parse.exe 2000000
+ *     bench_parse.exe 2000000 ..\captures\rack.pmcap
+ */
+
+#include "../Telemetry.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Sample {
+        std::string output;
+        bool isPM240;
+    };
+
+    const char* PM240Status =
+        "Connected to PM240-0001\n"
+        "STATUS: CONNECTED\n"
+        "SOURCE VOLTAGE:20012mV\n"
+        "SINK VOLTAGE:19874mV\n"
+        "SINK SET CURRENT:3000mA\n"
+        "SINK MEASURED CURRENT:2987mA\n"
+        "TEMPERATURE:41C\n";
+
+    const char* PM125Status =
+        "Connected to PM125-0001\n"
+        "STATUS: CONNECTED\n"
+        "VOLTAGE:14962mV\n"
+        "SET CURRENT:2000mA\n"
+        "MEASURED CURRENT:1994mA\n";
+
+    template <typename T>
+    bool readValue(std::ifstream& file, T& value) {
+        return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    // Every recorded "-s" response in a capture file, model taken from the labels in the output
+    std::vector<Sample> loadCapture(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[7];
+        if (!file.read(magic, 7) || memcmp(magic, "PMCAP1\n", 7) != 0) {
+            throw std::runtime_error("Not a capture file: " + path);
+        }
+
+        std::vector<Sample> samples;
+        uint32_t commandBytes, outputBytes, latencyMicros;
+        int32_t exitCode;
+        uint64_t offsetMicros;
+        while (readValue(file, commandBytes) && readValue(file, outputBytes) && readValue(file, exitCode) &&
+               readValue(file, latencyMicros) && readValue(file, offsetMicros)) {
+            std::string command(commandBytes, '\0'), output(outputBytes, '\0');
+            if (!file.read(command.data(), commandBytes) || !file.read(output.data(), outputBytes)) break;
+            if (command.size() < 3 || command.compare(command.size() - 3, 3, " -s") != 0) continue;
+            samples.push_back({output, output.find("SINK VOLTAGE:") != std::string::npos});
+        }
+        return samples;
+    }
+
+    // Parses per second over 'count' passes through the samples
+    double measure(const std::vector<Sample>& samples, const int& count) {
+        Telemetry sample;
+        size_t valid = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            const Sample& s = samples[i % samples.size()];
+            valid += scanStatus(s.output, s.isPM240, sample);
+        }
+        std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+
+        if (valid == 0) throw std::runtime_error("No response parsed as a valid status");
+        return count / spent.count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    if (count <= 0) {
+        std::cerr << "Usage: bench_parse [parses] [capture file]" << std::endl;
+        return -1;
+    }
+
+    try {
+        std::vector<Sample> samples;
+        if (argc > 2) {
+            samples = loadCapture(argv[2]);
+            if (samples.empty()) throw std::runtime_error("No \"-s\" responses in " + std::string(argv[2]));
+        } else {
+            samples = {{PM240Status, true}, {PM125Status, false}};
+        }
+
+        double rate = measure(samples, count);
+        std::cout << std::fixed << std::setprecision(0)
+                  << samples.size() << " responses, " << count << " parses: "
+                  << rate << " parses/s, " << std::setprecision(1) << 1e9 / rate << " ns/parse" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
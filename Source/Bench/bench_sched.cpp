@@ -0,0 +1,79 @@
+/**
+ * Overhead of the Sched::Scheduler against the thread-per-tester bridge it replaced, at 8, 64 and 256 testers.
+ *
+ * Each simulated tester runs 20 cycles of 1ms busy work, standing in for a console round trip, and a 5ms wait
+ * for the rail to settle. On the scheduler the wait is a Step::sleep on a fixed pool, on the bridge every tester
+ * has its own thread that sleeps. With the pool sized so the busy work fits, both should finish in about the same
+ * time, so any difference is the cost of the scheduler itself:
+ *
+ *     bench_sched.exe 4
+ */
+
+#include "../Scheduler.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const int CYCLES = 20;
+    const std::chrono::milliseconds WORK(1);
+    const std::chrono::milliseconds SETTLE(5);
+
+    // Spin, so the work holds its thread the way a blocking round trip does
+    void work() {
+        Clock::time_point end = Clock::now() + WORK;
+        while (Clock::now() < end) {}
+    }
+
+    long long millisSince(const Clock::time_point& start) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    }
+
+    long long onScheduler(const int& testers, const size_t& workers) {
+        Clock::time_point start = Clock::now();
+        Sched::Scheduler scheduler(workers);
+        Sched::TaskGroup group(scheduler);
+        for (int i = 0; i < testers; ++i) {
+            group.spawn([cycle = 0](Sched::TaskContext&) mutable {
+                work();
+                return (++cycle == CYCLES) ? Sched::Step::done() : Sched::Step::sleep(SETTLE);
+            });
+        }
+        group.wait();
+        return millisSince(start);
+    }
+
+    long long onThreads(const int& testers) {
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < testers; ++i) {
+            threads.emplace_back([]() {
+                for (int cycle = 0; cycle < CYCLES; ++cycle) {
+                    work();
+                    if (cycle + 1 < CYCLES) std::this_thread::sleep_for(SETTLE);
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        return millisSince(start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t workers = (argc > 1) ? (size_t)atoi(argv[1]) : 4;
+    if (workers == 0) workers = 4;
+
+    std::cout << CYCLES << " cycles of " << WORK.count() << "ms work and " << SETTLE.count() << "ms settle per tester" << std::endl;
+    for (int testers : {8, 64, 256}) {
+        long long scheduled = onScheduler(testers, workers);
+        long long threaded = onThreads(testers);
+        std::cout << testers << " testers: scheduler (" << workers << " workers) " << scheduled << "ms, thread per tester " << threaded << "ms" << std::endl;
+    }
+
+    return 0;
+}
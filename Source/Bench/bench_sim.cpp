@@ -0,0 +1,118 @@
+/**
+ * End-to-end throughput of a simulated rack: every virtual tester polls "-s" from a job on the Sched::Scheduler
+ * pool, the way usbvalidator drives real testers, first spawning the console per command and then through each
+ * tester's resident console worker.
+ *
+ * Point PASSMARK_CONSOLE_DIR and PASSMARK_SIM_DIR at the consolesim stand-in, with consolesim.ini declaring at
+ * least as many PM240s as the rack (pm240 = 64):
+ *
+ *     set PASSMARK_CONSOLE_DIR=..\sim
+ *     set PASSMARK_SIM_DIR=..\sim
+ *     bench_sim.exe 64 10
+ *
+ * The optional third argument is a poll interval in ms. At 0 every tester polls back to back, which measures
+ * the most the rack can sustain.
+ */
+
+#include "../tester.hpp"
+#include "../AsyncLog.hpp"
+#include "../Scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Pass {
+        double seconds = 0;
+        std::vector<double> latency; // ms per status read, every tester
+        size_t failures = 0;
+    };
+
+    // Poll every tester in 'rack' for 'length', each as one job on 'scheduler'
+    Pass drive(std::vector<tester>& rack, Sched::Scheduler& scheduler, const Clock::duration& length, const std::chrono::milliseconds& poll) {
+        std::vector<std::vector<double>> perTester(rack.size());
+        Clock::time_point start = Clock::now(), end = start + length;
+
+        Sched::TaskGroup group(scheduler);
+        for (size_t i = 0; i < rack.size(); ++i) {
+            tester& Tester = rack[i];
+            std::vector<double>& latency = perTester[i];
+            group.spawn([&Tester, &latency, end, poll](Sched::TaskContext& ctx) {
+                if (ctx.cancelled() || Clock::now() >= end) return Sched::Step::done();
+
+                Clock::time_point sent = Clock::now();
+                Tester.getStatus();
+                latency.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+
+                return (poll.count() > 0) ? Sched::Step::sleep(poll) : Sched::Step::yield();
+            }, Tester.serialNumber);
+        }
+        group.wait();
+
+        Pass pass;
+        pass.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        pass.failures = group.failures();
+        for (const std::vector<double>& latency : perTester) pass.latency.insert(pass.latency.end(), latency.begin(), latency.end());
+        return pass;
+    }
+
+    void print(const char* label, Pass& pass) {
+        std::sort(pass.latency.begin(), pass.latency.end());
+        double total = 0;
+        for (double d : pass.latency) total += d;
+        auto at = [&pass](double q) { return (pass.latency.empty()) ? 0.0 : pass.latency[(size_t)(q * (pass.latency.size() - 1))]; };
+
+        std::cout << std::fixed << std::setprecision(1) << label << ": " << pass.latency.size() / pass.seconds << " commands/s, latency mean "
+                  << ((pass.latency.empty()) ? 0.0 : total / pass.latency.size()) << "ms, p50 " << at(0.5) << "ms, p99 " << at(0.99)
+                  << "ms, max " << at(1.0) << "ms";
+        if (pass.failures > 0) std::cout << ", " << pass.failures << " tester(s) failed";
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = (argc > 1) ? atoi(argv[1]) : 64;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+    int poll = (argc > 3) ? atoi(argv[3]) : 0;
+    if (count < 1 || count > 9999 || seconds < 1 || poll < 0) {
+        std::cerr << "Usage: bench_sim [testers] [seconds] [poll ms]" << std::endl;
+        return -1;
+    }
+
+    try {
+        std::vector<tester> rack(count);
+        for (int i = 0; i < count; ++i) {
+            char sn[16];
+            std::snprintf(sn, sizeof(sn), "SIM240-%04d", i + 1);
+            rack[i].serialNumber = sn;
+            rack[i].assignType("PM240");
+        }
+
+        Sched::Scheduler scheduler;
+        std::cout << count << " simulated testers on " << scheduler.workerCount() << " scheduler workers, " << seconds << "s per pass" << std::endl;
+
+        Pass spawned = drive(rack, scheduler, std::chrono::seconds(seconds), std::chrono::milliseconds(poll));
+        for (tester& Tester : rack) {
+            if (!Tester.startSession()) throw std::runtime_error("Could not start console worker for " + Tester.serialNumber);
+        }
+        Pass resident = drive(rack, scheduler, std::chrono::seconds(seconds), std::chrono::milliseconds(poll));
+
+        print("Spawn per command", spawned);
+        print("Console worker   ", resident);
+        Log::flush();
+        return (spawned.failures == 0 && resident.failures == 0) ? 0 : 1;
+    } catch (const std::exception& e) {
+        Log::flush();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * Cost of recording a batstress soak to a telemetry file, and of loading it back for analysis.
+ *
+ * Samples are recorded the way batstress does, from the reactor thread with the testers taking turns, one per
+ * tester per second of simulated soak and as fast as possible, so a whole soak's rows go in within seconds.
+ * Per-row latency is what the reactor pays for each sample; its maximum shows whether a block write ever
+ * stalled it. The file is then opened with TelemetryReader and one column is summed over every row:
+ *
+ *     bench_telemetry.exe 64 48
+ */
+
+#include "../TelemetryRecorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* PATH = "bench_telemetry.pmt";
+
+    double millisSince(const Clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Record 'seconds' of one-second samples for 'testers' testers. Returns the ns each row took
+    std::vector<uint32_t> record(const int& testers, const long long& seconds, double& totalMs) {
+        std::vector<uint32_t> latency;
+        latency.reserve((size_t)(seconds * testers));
+        Clock::time_point start = Clock::now();
+        {
+            TelemetryRecorder recorder(PATH);
+            std::vector<uint16_t> ids;
+            for (int t = 0; t < testers; ++t) {
+                char sn[16];
+                std::snprintf(sn, sizeof(sn), "SIM240-%04d", t + 1);
+                ids.push_back(recorder.addTester(sn));
+            }
+
+            Telemetry sample;
+            sample.sinkVoltage = 20000;
+            sample.sinkSetCurrent = 3000;
+            for (long long i = 0; i < seconds; ++i) {
+                sample.timestamp = start + std::chrono::seconds(i);
+                for (uint16_t id : ids) {
+                    sample.sinkMeasCurrent = 2990 + (int)((i + id) % 20);
+
+                    Clock::time_point sent = Clock::now();
+                    recorder.record(id, TelemetryFile::SAMPLE, 4, sample, 20000, 3000);
+                    latency.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count());
+                }
+            }
+        } // Closing writes the last block
+        totalMs = millisSince(start);
+        return latency;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int testers = (argc > 1) ? atoi(argv[1]) : 64;
+    int hours = (argc > 2) ? atoi(argv[2]) : 48;
+    if (testers < 1 || testers > 9999 || hours < 1) {
+        std::cerr << "Usage: bench_telemetry [testers] [soak hours]" << std::endl;
+        return -1;
+    }
+    long long rows = (long long)hours * 3600;
+
+    try {
+        std::cout << testers << " testers, " << hours << "h soak at 1 sample/s: " << rows * testers << " rows" << std::endl;
+
+        double recordMs = 0;
+        std::vector<uint32_t> latency = record(testers, rows, recordMs);
+        std::sort(latency.begin(), latency.end());
+        double total = 0;
+        for (uint32_t ns : latency) total += ns;
+        auto at = [&latency](double q) { return latency[(size_t)(q * (latency.size() - 1))]; };
+
+        std::cout << std::fixed << std::setprecision(1) << "Record: " << recordMs << "ms, per row mean " << total / latency.size() << "ns, p50 "
+                  << at(0.5) << "ns, p99 " << at(0.99) << "ns, p99.99 " << at(0.9999) << "ns, max " << at(1.0) / 1000.0 << "us" << std::endl;
+
+        Clock::time_point start = Clock::now();
+        TelemetryReader reader(PATH);
+        double loadMs = millisSince(start);
+
+        start = Clock::now();
+        long long sum = 0;
+        for (const TelemetryBlock& block : reader.blocks()) {
+            for (size_t i = 0; i < block.rows; ++i) sum += block.measCurrent[i];
+        }
+        double scanMs = millisSince(start);
+
+        if ((long long)reader.rowCount() != rows * testers) throw std::runtime_error("Read back " + std::to_string(reader.rowCount()) + " rows");
+        std::cout << "Load: " << loadMs << "ms for " << reader.blocks().size() << " blocks, scan of one column " << scanMs << "ms (mean "
+                  << (double)sum / reader.rowCount() << "mA)" << std::endl;
+    } catch (const std::exception& e) {
+        std::remove(PATH);
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    std::remove(PATH);
+    return 0;
+}
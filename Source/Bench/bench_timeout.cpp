@@ -0,0 +1,150 @@
+/**
+ * Kill-on-hang: how far past its deadline a wedged console command is stopped, and whether anything it started
+ * survives.
+ *
+ * The benchmark runs copies of itself as the hung console. Each copy starts a grandchild that writes a heartbeat
+ * file until it's killed, then blocks on it forever. Every run goes through the blocking Spawn::Runner and through
+ * Async::runProcess, and must throw Spawn::Timeout with the heartbeat stopped:
+ *
+ *     bench_timeout.exe 20 300
+ */
+
+#include "../ProcessSpawn.hpp"
+#include "../Reactor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    namespace fs = std::filesystem;
+
+    // Grandchild: append to 'path' every 20ms. Gives up after a minute so a leak can't run forever
+    int beat(const std::string& path) {
+        for (int i = 0; i < 3000; ++i) {
+            std::ofstream(path, std::ios::app) << '.';
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return 0;
+    }
+
+    // Child: start the grandchild through the shell and wait on it, like a console stuck on a hub that stopped
+    // answering. Spawn::Runner isn't used here as it would give the grandchild a process group of its own
+    int hang(const std::string& self, const std::string& path) {
+#ifdef _WIN32
+        std::string command = "\"\"" + self + "\" --beat \"" + path + "\"\""; // cmd /c strips the outer quotes
+#else
+        std::string command = "'" + self + "' --beat '" + path + "'";
+#endif
+        return std::system(command.c_str());
+    }
+
+    // True if the heartbeat at 'path' is still growing
+    bool beating(const fs::path& path) {
+        std::error_code ec;
+        auto before = fs::file_size(path, ec);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return fs::file_size(path, ec) != before;
+    }
+
+    struct Tally {
+        std::vector<Clock::duration> overshoot; // Past the deadline until Timeout was thrown
+        int missed = 0;                         // Runs that didn't throw Timeout
+        int leaked = 0;                         // Runs whose grandchild kept beating
+
+        void print(const char* label, const std::chrono::milliseconds& deadline) const {
+            Clock::duration total{0}, worst{0};
+            for (const Clock::duration& d : overshoot) {
+                total += d;
+                worst = std::max(worst, d);
+            }
+            auto ms = [](const Clock::duration& d) { return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(d).count(); };
+
+            std::cout << label << ": " << overshoot.size() << " timeouts at " << deadline.count() << "ms, killed " << std::fixed << std::setprecision(1)
+                      << ((overshoot.empty()) ? 0.0 : ms(total / (long long)overshoot.size())) << "ms past the deadline on average, max "
+                      << ms(worst) << "ms, " << missed << " missed, " << leaked << " leaked" << std::endl;
+        }
+    };
+
+    // One hung command under 'deadline'. 'run' returns true if it ended in Spawn::Timeout
+    template<typename Run>
+    void measure(Tally& tally, const fs::path& heartbeat, const std::chrono::milliseconds& deadline, Run run) {
+        std::error_code ec;
+        fs::remove(heartbeat, ec);
+
+        auto start = Clock::now();
+        if (run()) tally.overshoot.push_back(Clock::now() - start - deadline);
+        else ++tally.missed;
+
+        if (beating(heartbeat)) ++tally.leaked;
+        fs::remove(heartbeat, ec);
+    }
+
+    Async::Task<void> hungAsync(std::vector<std::string> argv, std::chrono::milliseconds deadline, bool& timedOut) {
+        try {
+            co_await Async::runProcess(argv, deadline);
+        } catch (const Spawn::Timeout&) {
+            timedOut = true;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string self = fs::absolute(argv[0]).string();
+    if (argc == 3 && std::string(argv[1]) == "--beat") return beat(argv[2]);
+    if (argc == 3 && std::string(argv[1]) == "--hang") return hang(self, argv[2]);
+
+    int runs = (argc > 1) ? std::atoi(argv[1]) : 20;
+    std::chrono::milliseconds deadline((argc > 2) ? std::atoi(argv[2]) : 300);
+    if (runs <= 0 || deadline.count() <= 0) {
+        std::cerr << "Usage: bench_timeout [runs] [deadline ms]" << std::endl;
+        return -1;
+    }
+
+    // Named per run so a grandchild leaked by an earlier run can't make this one look leaky
+    fs::path heartbeat = fs::temp_directory_path() / ("bench_timeout." + std::to_string(Clock::now().time_since_epoch().count()) + ".beat");
+    std::vector<std::string> hung{self, "--hang", heartbeat.string()};
+
+    try {
+        Tally blocking;
+        Spawn::Runner runner;
+        for (int i = 0; i < runs; ++i) {
+            measure(blocking, heartbeat, deadline, [&]() {
+                try {
+                    runner.run(hung, deadline);
+                    return false;
+                } catch (const Spawn::Timeout&) {
+                    return true;
+                }
+            });
+        }
+        blocking.print("Spawn::Runner", deadline);
+
+        Tally async;
+        for (int i = 0; i < runs; ++i) {
+            measure(async, heartbeat, deadline, [&]() {
+                bool timedOut = false;
+                Async::Reactor reactor;
+                reactor.spawn(hungAsync(hung, deadline, timedOut));
+                reactor.run();
+                return timedOut;
+            });
+        }
+        async.print("Async::runProcess", deadline);
+
+        return (blocking.missed + blocking.leaked + async.missed + async.leaked == 0) ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
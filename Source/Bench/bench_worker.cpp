@@ -0,0 +1,66 @@
+/**
+ * Commands per second through runCommand(), one console spawn per query against the resident console worker.
+ *
+ * Point PASSMARK_CONSOLE_DIR at a stand-in console (see consolesim.cpp) so no bench hardware is needed:
+ *
+ *     set PASSMARK_CONSOLE_DIR=..\sim
+ *     bench_worker.exe SIM240-0001 200
+ *
+ * Each backend runs the same "-s" query the stress loop issues, after a few warm-up calls.
+ */
+
+#include "../tester.hpp"
+#include "../AsyncLog.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    // Commands per second for 'count' status queries
+    double measure(const tester& Tester, const int& count) {
+        for (int i = 0; i < 3; ++i) runCommandView(Tester, "-s"); // Warm up caches and the worker
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            if (runCommandView(Tester, "-s").empty()) throw std::runtime_error("Empty response from console");
+        }
+        std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+        return count / spent.count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: bench_worker <SN> [commands] [PM240|PM125]" << std::endl;
+        return -1;
+    }
+
+    int count = (argc > 2) ? atoi(argv[2]) : 200;
+    if (count <= 0) count = 200;
+
+    tester Tester;
+    Tester.serialNumber = argv[1];
+    Tester.assignType((argc > 3) ? argv[3] : "PM240");
+
+    try {
+        double spawned = measure(Tester, count);
+        if (!Tester.startSession()) throw std::runtime_error("Could not start console worker");
+        double resident = measure(Tester, count);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Spawn per command: " << spawned << " commands/s (" << 1000.0 / spawned << "ms each)\n"
+                  << "Console worker:    " << resident << " commands/s (" << 1000.0 / resident << "ms each)\n"
+                  << "Speedup:           " << resident / spawned << "x over " << count << " commands" << std::endl;
+    } catch (const std::exception& e) {
+        Log::flush();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    Log::flush();
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "CancelToken.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Cancel {
+
+struct State {
+    std::mutex lock;                // Guards everything below except 'cancelled'. Held while callbacks run
+    std::condition_variable wake;
+    std::atomic<bool> cancelled{false};
+    Clock::time_point at;
+    std::vector<std::weak_ptr<State>> children;
+    std::map<unsigned long long, std::function<void()>> callbacks;
+    unsigned long long nextId = 0;
+};
+
+namespace {
+    void cancelState(const std::shared_ptr<State>& state, const Clock::time_point& at) {
+        std::vector<std::weak_ptr<State>> children;
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            if (state->cancelled.load()) return;
+            state->at = at;
+            state->cancelled.store(true);
+
+            // Run under the lock, so a Registration being destroyed waits for its callback to finish
+            for (auto& entry : state->callbacks) entry.second();
+            state->callbacks.clear();
+            children.swap(state->children);
+        }
+        state->wake.notify_all();
+
+        for (const std::weak_ptr<State>& weak : children) {
+            if (std::shared_ptr<State> child = weak.lock()) cancelState(child, at);
+        }
+    }
+}
+
+/**
+ * Token member function definitions
+ */
+Token Token::root() {
+    return Token(std::make_shared<State>());
+}
+
+Token Token::child() const {
+    auto childState = std::make_shared<State>();
+    if (!state) return Token(childState);
+
+    std::lock_guard<std::mutex> guard(state->lock);
+    if (state->cancelled.load()) {
+        childState->at = state->at;
+        childState->cancelled.store(true);
+    } else {
+        // Drop children that have gone before adding another, so long-lived parents don't grow
+        auto& children = state->children;
+        children.erase(std::remove_if(children.begin(), children.end(), [](const std::weak_ptr<State>& c) { return c.expired(); }), children.end());
+        children.push_back(childState);
+    }
+    return Token(childState);
+}
+
+void Token::cancel() const {
+    if (state) cancelState(state, Clock::now());
+}
+
+bool Token::cancelled() const {
+    return state && state->cancelled.load();
+}
+
+Clock::time_point Token::cancelledAt() const {
+    if (!this->cancelled()) return Clock::time_point();
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->at;
+}
+
+void Token::throwIfCancelled(const std::string& what) const {
+    if (this->cancelled()) throw JobCancelled(what);
+}
+
+Registration Token::onCancel(std::function<void()> callback) const {
+    Registration registration;
+    if (!state) return registration;
+
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (!state->cancelled.load()) {
+            registration.state = state;
+            registration.id = ++state->nextId;
+            state->callbacks.emplace(registration.id, std::move(callback));
+            return registration;
+        }
+    }
+
+    callback(); // Already cancelled
+    return registration;
+}
+
+bool Token::sleepFor(const Clock::duration& duration) const {
+    if (!state) {
+        std::this_thread::sleep_for(duration);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> guard(state->lock);
+    return !state->wake.wait_for(guard, duration, [this]() { return state->cancelled.load(); });
+}
+
+/**
+ * Registration member function definitions
+ */
+Registration::Registration(Registration&& other) noexcept : state(std::move(other.state)), id(other.id) {
+    other.id = 0;
+}
+
+Registration& Registration::operator=(Registration&& other) noexcept {
+    if (this != &other) {
+        this->reset();
+        state = std::move(other.state);
+        id = other.id;
+        other.id = 0;
+    }
+    return *this;
+}
+
+Registration::~Registration() {
+    this->reset();
+}
+
+void Registration::reset() {
+    if (state) {
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->callbacks.erase(id);
+    }
+    state.reset();
+    id = 0;
+}
+
+const Token& global() {
+    static const Token instance = Token::root();
+    return instance;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Completion.hpp"
+
+/**
+ * @brief Hierarchical cancellation.
+ * Cancelling a token cancels everything below it: the global token (Ctrl+C), then each tester's token, then
+ * per-job and per-operation tokens under those. Callbacks registered on a token run on the cancelling thread,
+ * which is how console children still running get killed, and anything sleeping on the token wakes at once.
+ */
+namespace Cancel {
+    using Clock = std::chrono::steady_clock;
+
+    struct State;
+    class Registration;
+
+    class Token
+    {
+    public:
+        // A token nothing can cancel. Costs nothing, e.g. for work that must finish such as the safety unload
+        Token() = default;
+
+        // A new top-level token that can be cancelled
+        static Token root();
+
+        // A token cancelled along with this one. The child of an uncancellable token is a new root
+        Token child() const;
+
+        // Cancel this token and its descendants. No-op if already cancelled
+        void cancel() const;
+
+        bool cancelled() const;
+
+        // When this token, or the ancestor it inherited cancellation from, was cancelled
+        Clock::time_point cancelledAt() const;
+
+        // Throw JobCancelled with 'what' if cancelled
+        void throwIfCancelled(const std::string& what = "Cancelled.") const;
+
+        // Run 'callback' once when cancelled, straight away if already cancelled. Once the Registration is
+        // destroyed the callback can no longer run, so it may capture locals that outlive the Registration
+        [[nodiscard]] Registration onCancel(std::function<void()> callback) const;
+
+        // Sleep up to 'duration'. Returns false if cut short by cancellation
+        bool sleepFor(const Clock::duration& duration) const;
+
+    private:
+        std::shared_ptr<State> state;
+
+        explicit Token(std::shared_ptr<State> s) : state(std::move(s)) {}
+    };
+
+    class Registration
+    {
+    public:
+        Registration() = default;
+        Registration(Registration&& other) noexcept;
+        Registration& operator=(Registration&& other) noexcept;
+        ~Registration();
+
+        Registration(const Registration&) = delete;
+        Registration& operator=(const Registration&) = delete;
+
+    private:
+        friend class Token;
+
+        std::shared_ptr<State> state;
+        unsigned long long id = 0;
+
+        void reset();
+    };
+
+    // Cancelled on Ctrl+C. Every tester's token descends from it
+    const Token& global();
+}
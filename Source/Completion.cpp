@@ -0,0 +1,54 @@
+#include "Completion.hpp"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+const char* JobOutcome::statusStr() const {
+    switch (status) {
+    case Status::Passed: return "PASSED";
+    case Status::Failed: return "FAILED";
+    case Status::Cancelled: return "CANCELLED";
+    }
+    return "UNKNOWN";
+}
+
+void CompletionLog::onComplete(Callback cb) {
+    std::lock_guard<std::mutex> guard(lock);
+    callback = std::move(cb);
+}
+
+void CompletionLog::record(JobOutcome outcome) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (outcome.status == JobOutcome::Status::Failed) ++failedCount;
+    finished.push_back(std::move(outcome));
+
+    // Held across the callback so reports don't interleave
+    if (callback) callback(finished.back());
+}
+
+std::vector<JobOutcome> CompletionLog::outcomes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return finished;
+}
+
+size_t CompletionLog::count() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return finished.size();
+}
+
+size_t CompletionLog::failures() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return failedCount;
+}
+
+std::string CompletionLog::failedNames() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::string names;
+    for (const JobOutcome& o : finished) {
+        if (o.status != JobOutcome::Status::Failed) continue;
+        if (!names.empty()) names += ", ";
+        names += (o.name.empty()) ? "<unnamed>" : o.name;
+    }
+    return names;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// How one tester job ended
+struct JobOutcome {
+    enum class Status { Passed, Failed, Cancelled };
+
+    std::string name;       // Usually the tester serial number
+    Status status = Status::Passed;
+    std::string error;      // what() of the exception that ended a failed job
+    std::chrono::steady_clock::duration elapsed{};
+
+    const char* statusStr() const;
+};
+
+// Thrown by a job that was stopped on purpose, e.g. its tester was unplugged. Reported as cancelled, not failed
+struct JobCancelled : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Collects job outcomes as each job finishes.
+ * Replaces waiting on every thread handle at once: there is no limit on the number of jobs, each
+ * completion is reported the moment it happens, and a failure is attributed to the job that failed.
+ * Thread safe, the callback runs on whichever thread finished the job, one call at a time.
+ */
+class CompletionLog
+{
+public:
+    using Callback = std::function<void(const JobOutcome&)>;
+
+    // Set before any job can finish
+    void onComplete(Callback callback);
+
+    void record(JobOutcome outcome);
+
+    // Outcomes so far, in completion order
+    std::vector<JobOutcome> outcomes() const;
+
+    size_t count() const;
+    size_t failures() const;
+
+    // Comma separated names of failed jobs, empty if none failed
+    std::string failedNames() const;
+
+private:
+    mutable std::mutex lock;
+    Callback callback;
+    std::vector<JobOutcome> finished;
+    size_t failedCount = 0;
+};
@@ -0,0 +1,180 @@
+#include "ConsoleCapture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    const char HEADER[] = "PMCAP1\n";
+    const size_t HEADER_SIZE = sizeof(HEADER) - 1;
+
+    struct Record {
+        std::string output;
+        int exitCode;
+        uint32_t latencyMicros;
+    };
+
+    // Responses to one command line, in recorded order
+    struct Responses {
+        std::vector<Record> records;
+        size_t next = 0;
+    };
+
+    std::mutex captureLock;
+    std::ofstream recordFile;
+    std::chrono::steady_clock::time_point recordStart;
+    bool recording = false;
+
+    std::unordered_map<std::string, Responses> replayTable;
+    bool replaying = false;
+    bool replayRealTime = false;
+
+    void putU32(char* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) p[i] = (char)(v >> (8 * i));
+    }
+
+    void putU64(char* p, uint64_t v) {
+        for (int i = 0; i < 8; ++i) p[i] = (char)(v >> (8 * i));
+    }
+
+    uint32_t getU32(const char* p) {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)(unsigned char)p[i] << (8 * i);
+        return v;
+    }
+}
+
+namespace Capture {
+
+bool startRecording(const std::string& path) {
+    std::lock_guard<std::mutex> guard(captureLock);
+
+    // Only write the header if the file is new
+    std::ifstream existing(path, std::ios::binary | std::ios::ate);
+    bool isNew = !existing || existing.tellg() == 0;
+    existing.close();
+
+    recordFile.open(path, std::ios::binary | std::ios::app);
+    if (!recordFile) return false;
+    if (isNew) recordFile.write(HEADER, HEADER_SIZE);
+
+    recordStart = std::chrono::steady_clock::now();
+    recording = true;
+    return true;
+}
+
+bool startReplay(const std::string& path, const bool& realTime) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.compare(0, HEADER_SIZE, HEADER) != 0) return false;
+
+    std::lock_guard<std::mutex> guard(captureLock);
+    replayTable.clear();
+
+    // A truncated last record (e.g. from a crash mid-write) is ignored
+    size_t pos = HEADER_SIZE;
+    const size_t fixedSize = 4 + 4 + 4 + 4 + 8;
+    while (pos + fixedSize <= data.size()) {
+        const char* p = data.data() + pos;
+        uint32_t commandBytes = getU32(p), outputBytes = getU32(p + 4);
+        if (pos + fixedSize + commandBytes + outputBytes > data.size()) break;
+
+        Record record;
+        record.exitCode = (int)getU32(p + 8);
+        record.latencyMicros = getU32(p + 12);
+        std::string command(p + fixedSize, commandBytes);
+        record.output.assign(p + fixedSize + commandBytes, outputBytes);
+        replayTable[command].records.push_back(std::move(record));
+
+        pos += fixedSize + commandBytes + outputBytes;
+    }
+
+    replayRealTime = realTime;
+    replaying = true;
+    return true;
+}
+
+bool startFromEnvironment() {
+    const char* replayPath = getenv("PASSMARK_REPLAY");
+    if (replayPath != NULL && *replayPath != '\0') {
+        const char* timing = getenv("PASSMARK_REPLAY_TIMING");
+        return startReplay(replayPath, timing != NULL && strcmp(timing, "1") == 0);
+    }
+
+    const char* recordPath = getenv("PASSMARK_RECORD");
+    if (recordPath != NULL && *recordPath != '\0') return startRecording(recordPath);
+
+    return true;
+}
+
+void stop() {
+    std::lock_guard<std::mutex> guard(captureLock);
+    if (recordFile.is_open()) recordFile.close();
+    recording = false;
+    replaying = false;
+    replayTable.clear();
+}
+
+bool isRecording() { return recording; }
+
+bool isReplaying() { return replaying; }
+
+bool isRealTime() { return replaying && replayRealTime; }
+
+void record(std::string_view command, std::string_view output, const int& exitCode, const uint32_t& latencyMicros) {
+    if (!recording) return;
+
+    // Build fixed part outside the lock
+    char fixed[24];
+    putU32(fixed, (uint32_t)command.size());
+    putU32(fixed + 4, (uint32_t)output.size());
+    putU32(fixed + 8, (uint32_t)exitCode);
+    putU32(fixed + 12, latencyMicros);
+
+    std::lock_guard<std::mutex> guard(captureLock);
+    if (!recording) return;
+
+    uint64_t offset = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recordStart).count();
+    putU64(fixed + 16, offset);
+
+    // Flush per record so a crash loses at most the command in flight
+    recordFile.write(fixed, sizeof(fixed));
+    recordFile.write(command.data(), command.size());
+    recordFile.write(output.data(), output.size());
+    recordFile.flush();
+}
+
+bool replay(const std::string& command, std::string_view& output, uint32_t* delayMicros) {
+    uint32_t latency;
+    {
+        std::lock_guard<std::mutex> guard(captureLock);
+        auto it = replayTable.find(command);
+        if (it == replayTable.end() || it->second.records.empty()) return false;
+
+        Responses& responses = it->second;
+        const Record& record = responses.records[std::min(responses.next, responses.records.size() - 1)];
+        if (responses.next < responses.records.size()) ++responses.next;
+
+        // Records are never moved once loaded, so the view outlives the lock
+        output = record.output;
+        latency = record.latencyMicros;
+    }
+
+    if (!replayRealTime) latency = 0;
+    if (delayMicros != nullptr) *delayMicros = latency;
+    else if (latency > 0) std::this_thread::sleep_for(std::chrono::microseconds(latency));
+    return true;
+}
+
+}
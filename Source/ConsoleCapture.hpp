@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Record and replay of raw console traffic.
+ * In record mode every console command is appended to a capture file with its raw output, exit code
+ * and latency. In replay mode runCommand() serves those responses back instead of starting a console,
+ * so a recorded session's control logic can be re-run offline, either at full speed or with the
+ * recorded timing.
+ *
+ * Capture file layout, all integers little-endian:
+ *     "PMCAP1\n"
+ *     repeated: u32 commandBytes, u32 outputBytes, i32 exitCode, u32 latencyMicros, u64 offsetMicros,
+ *               command bytes, output bytes
+ * offsetMicros is the time since recording started. Records of different testers interleave in the
+ * order their commands finished.
+ */
+namespace Capture {
+    // Start appending to 'path'. A new file gets a header, an existing capture is extended
+    bool startRecording(const std::string& path);
+
+    // Load 'path' for replay. With realTime set, each response is delayed by its recorded latency
+    bool startReplay(const std::string& path, const bool& realTime);
+
+    // Read PASSMARK_RECORD / PASSMARK_REPLAY (and PASSMARK_REPLAY_TIMING=1) and start the matching mode.
+    // Returns false if a capture file was named but couldn't be opened
+    bool startFromEnvironment();
+
+    // Close capture file and leave record/replay mode
+    void stop();
+
+    bool isRecording();
+    bool isReplaying();
+
+    // Replaying with the recorded timing, see startReplay()
+    bool isRealTime();
+
+    // Append one command to the capture file. Thread safe
+    void record(std::string_view command, std::string_view output, const int& exitCode, const uint32_t& latencyMicros);
+
+    // Serve the next recorded response to 'command'. Responses to the same command come back in recorded
+    // order, the last one repeats once they run out. Returns false if the command was never recorded.
+    // With 'delayMicros' set the recorded latency (0 unless replaying in real time) is handed back
+    // for the caller to wait out instead of sleeping here
+    bool replay(const std::string& command, std::string_view& output, uint32_t* delayMicros = nullptr);
+}
@@ -0,0 +1,405 @@
+#include "ConsoleSession.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace {
+    // Shell dialect of the worker
+#ifdef _WIN32
+    const char* const NO_INPUT = " < NUL";
+    const char* const EXIT_CODE = " %ERRORLEVEL%";
+    const char* const LINE_END = "\r\n";
+    const char* const NO_OP = "rem";
+#else
+    const char* const NO_INPUT = " < /dev/null";
+    const char* const EXIT_CODE = " $?";
+    const char* const LINE_END = "\n";
+    const char* const NO_OP = ":";
+#endif
+}
+
+ConsoleSession::ConsoleSession() :
+#ifdef _WIN32
+    hProcess(NULL), hInput(NULL), hOutput(NULL), hReadEvent(NULL), boundPort(NULL),
+#else
+    pid(0), input(-1), output(-1),
+#endif
+    alive(false), sequence(0), completed(0) {}
+
+ConsoleSession::~ConsoleSession() {
+    this->stop();
+}
+
+#ifdef _WIN32
+
+bool ConsoleSession::start() {
+    if (alive) return true;
+
+    HANDLE hChildIn, hChildOut;
+    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    // Output is a named pipe so a reactor can read it overlapped, the way runProcess() reads a console
+    static std::atomic<unsigned long> pipeSerial{0};
+    std::string name = "\\\\.\\pipe\\passmark-session-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(++pipeSerial);
+    hOutput = CreateNamedPipeA(name.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                               PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 4096, 4096, 0, NULL);
+    if (hOutput == INVALID_HANDLE_VALUE) {
+        hOutput = NULL;
+        return false;
+    }
+    hChildOut = CreateFileA(name.c_str(), GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    hReadEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (hChildOut == INVALID_HANDLE_VALUE || hReadEvent == NULL || !CreatePipe(&hChildIn, &hInput, &sa, 0)) {
+        if (hChildOut != INVALID_HANDLE_VALUE) CloseHandle(hChildOut);
+        if (hReadEvent != NULL) CloseHandle(hReadEvent);
+        CloseHandle(hOutput);
+        hOutput = hReadEvent = hInput = NULL;
+        return false;
+    }
+
+    // Ensure worker doesn't inherit our end of the input pipe
+    SetHandleInformation(hInput, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    si.hStdInput = hChildIn;
+    si.hStdOutput = hChildOut;
+    si.hStdError = hChildOut;
+
+    // /Q turns echo off so no prompt or command echo is mixed into the output, /D skips AutoRun
+    PROCESS_INFORMATION pi = {};
+    std::string cmdLine = "cmd.exe /Q /D /K";
+    // Suspended until it has joined the tree, so every console it launches can be killed with it
+    BOOL created = CreateProcessA(NULL, &cmdLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi);
+
+    // Worker owns its ends of the pipes now
+    CloseHandle(hChildIn);
+    CloseHandle(hChildOut);
+
+    if (!created) {
+        CloseHandle(hInput);
+        CloseHandle(hOutput);
+        CloseHandle(hReadEvent);
+        hInput = hOutput = hReadEvent = NULL;
+        return false;
+    }
+
+    tree.adopt(pi.hProcess);
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+    hProcess = pi.hProcess;
+    alive = true;
+
+    // Flush any start-up banner before the first real command
+    std::vector<std::string> banner;
+    if (this->transact({NO_OP}, banner)) return true;
+    this->stop();
+    return false;
+}
+
+void ConsoleSession::stop() {
+    if (hInput != NULL) {
+        DWORD bytesWritten;
+        WriteFile(hInput, "exit\r\n", 6, &bytesWritten, NULL);
+        CloseHandle(hInput);
+        hInput = NULL;
+    }
+
+    if (hProcess != NULL) {
+        // Give the worker a moment to exit on its own before forcing it
+        if (WaitForSingleObject(hProcess, 1000) == WAIT_TIMEOUT) TerminateProcess(hProcess, 1);
+        CloseHandle(hProcess);
+        hProcess = NULL;
+    }
+
+    if (hOutput != NULL) {
+        CloseHandle(hOutput);
+        CloseHandle(hReadEvent);
+        hOutput = hReadEvent = boundPort = NULL;
+    }
+
+    pending.clear();
+    alive = false;
+}
+
+bool ConsoleSession::isAlive() const {
+    return alive && WaitForSingleObject(hProcess, 0) == WAIT_TIMEOUT;
+}
+
+bool ConsoleSession::bindTo(HANDLE port) {
+    if (boundPort == NULL && hOutput != NULL && CreateIoCompletionPort(hOutput, port, 0, 0) != NULL) boundPort = port;
+    return boundPort == port;
+}
+
+bool ConsoleSession::send(const std::string& request) {
+    DWORD bytesWritten;
+    return WriteFile(hInput, request.data(), (DWORD)request.size(), &bytesWritten, NULL) != 0;
+}
+
+bool ConsoleSession::receive() {
+    char buffer[4096];
+    DWORD bytesRead = 0;
+
+    // Setting the event's low bit keeps the completion off any port the pipe is bound to
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = (HANDLE)((ULONG_PTR)hReadEvent | 1);
+    if (!ReadFile(hOutput, buffer, sizeof(buffer), NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) return false;
+    if (!GetOverlappedResult(hOutput, &overlapped, &bytesRead, TRUE) || bytesRead == 0) return false;
+    pending.append(buffer, bytesRead);
+    return true;
+}
+
+#else
+
+bool ConsoleSession::start() {
+    if (alive) return true;
+
+    // stdin is a socket so a write to a dead worker fails instead of raising SIGPIPE. Our ends must not leak into
+    // other children
+    int in[2], out[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in) != 0) return false;
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[1], 0);
+    posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, out[1], 2);
+
+    // Worker leads its own process group, so every console it launches can be killed with it
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    char shell[] = "/bin/sh";
+    char* args[] = {shell, nullptr};
+    int err = posix_spawn(&pid, shell, &actions, &attr, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    // Worker owns its ends of the pipes now
+    close(in[1]);
+    close(out[1]);
+
+    if (err != 0) {
+        close(in[0]);
+        close(out[0]);
+        pid = 0;
+        return false;
+    }
+
+    // Our end is non-blocking so a reactor can wait on it too
+    fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+    tree.adopt(pid);
+    input = in[0];
+    output = out[0];
+    alive = true;
+
+    std::vector<std::string> banner;
+    if (this->transact({NO_OP}, banner)) return true;
+    this->stop();
+    return false;
+}
+
+void ConsoleSession::stop() {
+    if (input >= 0) {
+        this->send("exit\n");
+        close(input);
+        input = -1;
+    }
+
+    if (pid > 0) {
+        // Give the worker a moment to exit on its own before forcing it
+        bool exited = false;
+        for (int i = 0; i < 100 && !exited; ++i) {
+            exited = waitpid(pid, nullptr, WNOHANG) == pid;
+            if (!exited) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        tree.kill(); // Worker, if still there, and any console it left behind
+        if (!exited) while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+        pid = 0;
+    }
+
+    if (output >= 0) {
+        close(output);
+        output = -1;
+    }
+
+    pending.clear();
+    alive = false;
+}
+
+bool ConsoleSession::isAlive() const {
+    // WNOWAIT leaves an exited worker for stop() to reap
+    siginfo_t info = {};
+    return alive && waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0;
+}
+
+bool ConsoleSession::send(const std::string& request) {
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = ::send(input, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) sent += (size_t)n;
+        else if (n < 0 && errno == EINTR) continue;
+        else return false;
+    }
+    return true;
+}
+
+bool ConsoleSession::receive() {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(output, buffer, sizeof(buffer));
+        if (n > 0) {
+            pending.append(buffer, (size_t)n);
+            return true;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            pollfd ready = {output, POLLIN, 0};
+            poll(&ready, 1, -1);
+            continue;
+        }
+        return false;
+    }
+}
+
+#endif
+
+bool ConsoleSession::run(const std::string& command, std::string_view& output, const std::chrono::milliseconds& timeout, const Cancel::Token& token) {
+    completed = 0;
+    if (!this->isAlive()) return false;
+
+    // Console must not read from the worker's stdin or it would swallow the end marker
+    if (!this->transactWithin({command + NO_INPUT}, lastOutput, timeout, token)) return false;
+    output = lastOutput[0];
+
+    return true;
+}
+
+bool ConsoleSession::runBatch(const std::vector<std::string>& commands, std::vector<std::string>& outputs, const std::chrono::milliseconds& timeout,
+                              const Cancel::Token& token) {
+    completed = 0;
+    if (!this->isAlive()) return false;
+
+    std::vector<std::string> requests;
+    for (const std::string& command : commands) requests.push_back(command + NO_INPUT);
+    return this->transactWithin(requests, outputs, timeout, token);
+}
+
+bool ConsoleSession::begin(const std::vector<std::string>& commands) {
+    completed = 0;
+    if (!this->isAlive()) return false;
+
+    std::vector<std::string> requests;
+    for (const std::string& command : commands) requests.push_back(command + NO_INPUT);
+    return this->request(requests);
+}
+
+bool ConsoleSession::deliver(const char* data, const size_t& size, std::vector<std::string>& outputs) {
+    pending.append(data, size);
+    return this->collect(outputs);
+}
+
+bool ConsoleSession::conclude(const bool& done, const bool& timedOut, const std::chrono::milliseconds& timeout, const Cancel::Token& token) {
+    if (token.cancelled()) {
+        this->stop();
+        throw JobCancelled("Command cancelled.");
+    }
+    if (timedOut) {
+        this->stop(); // Next command starts a fresh worker or spawns directly
+        throw Spawn::Timeout("Console worker timed out after " + std::to_string(timeout.count()) + "ms");
+    }
+    if (!done) this->stop(); // Worker exited or pipe broke
+    return done;
+}
+
+bool ConsoleSession::transactWithin(const std::vector<std::string>& commands, std::vector<std::string>& outputs, const std::chrono::milliseconds& timeout,
+                                    const Cancel::Token& token) {
+    token.throwIfCancelled("Command cancelled.");
+
+    // Killing the tree breaks the output pipe, so a read stuck on a wedged console returns
+    bool done, timedOut;
+    {
+        Spawn::Deadline deadline(timeout, [this]() { tree.kill(); });
+        Cancel::Registration onCancel = token.onCancel([this]() { tree.kill(); });
+        done = this->transact(commands, outputs);
+        timedOut = deadline.expired();
+    }
+    return this->conclude(done, timedOut, timeout, token);
+}
+
+bool ConsoleSession::request(const std::vector<std::string>& commands) {
+    completed = 0;
+
+    // Each command is followed by a unique marker echoed by the worker once the command has finished
+    markers.clear();
+    std::string request;
+    for (const std::string& command : commands) {
+        markers.push_back("__PASSMARK_END_" + std::to_string(++sequence) + "__");
+        request += command + LINE_END + "echo " + markers.back() + EXIT_CODE + LINE_END;
+    }
+    exitCodes.assign(commands.size(), -1);
+
+    // Whole batch goes out in one write
+    if (this->send(request)) return true;
+    this->stop();
+    return false;
+}
+
+bool ConsoleSession::collect(std::vector<std::string>& outputs) {
+    outputs.resize(markers.size());
+    while (completed < markers.size()) {
+        // Wait for the whole marker line
+        const std::string& marker = markers[completed];
+        size_t markerPos = pending.find(marker);
+        if (markerPos == std::string::npos) return false;
+        size_t lineEnd = pending.find('\n', markerPos);
+        if (lineEnd == std::string::npos) return false;
+
+        outputs[completed].assign(pending, 0, markerPos);
+
+        // Exit code follows the marker
+        size_t codePos = markerPos + marker.size();
+        exitCodes[completed] = std::atoi(pending.substr(codePos, lineEnd - codePos).c_str());
+
+        // Drop marker line, keep anything after it for the next command
+        pending.erase(0, lineEnd + 1);
+        ++completed;
+    }
+    return true;
+}
+
+bool ConsoleSession::transact(const std::vector<std::string>& commands, std::vector<std::string>& outputs) {
+    if (!this->request(commands)) return false;
+
+    while (!this->collect(outputs)) {
+        if (!this->receive()) return false; // Worker exited or pipe broke, conclude() stops it
+    }
+    return true;
+}
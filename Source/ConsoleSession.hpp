@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#endif
+
+#include "CancelToken.hpp"
+#include "ProcessSpawn.hpp"
+
+/**
+ * @brief Long-lived command interpreter used to run console queries for one tester.
+ * The Passmark consoles are one-shot programs, so the worker is a resident shell (cmd.exe on
+ * Windows, /bin/sh elsewhere) that launches the console per query. This removes the shell start-up and pipe setup that
+ * runCommand() otherwise pays on every call.
+ */
+class ConsoleSession
+{
+public:
+    ConsoleSession();
+    ~ConsoleSession();
+
+    // Disable copying, the session owns process and pipe handles
+    ConsoleSession(const ConsoleSession&) = delete;
+    ConsoleSession& operator=(const ConsoleSession&) = delete;
+
+    // Launch the worker. Returns false if the worker could not be started
+    bool start();
+
+    // Terminate the worker and release its handles
+    void stop();
+
+    // Return true while the worker is able to accept commands
+    bool isAlive() const;
+
+    // Run one command line through the worker. Returns false if the worker died, in which case
+    // the caller should fall back to spawning the command directly. 'output' is valid until the next run().
+    // Past a non-zero 'timeout' the worker and everything it started are killed and Spawn::Timeout is thrown.
+    // Cancelling 'token' kills them the same way and throws JobCancelled
+    bool run(const std::string& command, std::string_view& output, const std::chrono::milliseconds& timeout = std::chrono::milliseconds(0),
+             const Cancel::Token& token = Cancel::Token());
+
+    // Run several command lines in one round trip to the worker, one output per command. 'timeout' covers the batch
+    bool runBatch(const std::vector<std::string>& commands, std::vector<std::string>& outputs,
+                  const std::chrono::milliseconds& timeout = std::chrono::milliseconds(0), const Cancel::Token& token = Cancel::Token());
+
+    // Exit codes of the commands sent by the last run() or runBatch()
+    const std::vector<int>& lastExitCodes() const { return exitCodes; }
+
+    // Commands of the last run() or runBatch() that finished, in order. If the worker died part way through a
+    // batch, only these have outputs and exit codes; anything after them may or may not have run
+    size_t lastCompleted() const { return completed; }
+
+    // runBatch() in pieces, for an event loop that reads outputPipe() itself. begin() sends the commands, then every
+    // chunk read from the pipe goes to deliver(), which returns true once all outputs are in. A read that comes back
+    // empty means the worker died: pass done = false to conclude(), which also handles a timeout or cancel
+    bool begin(const std::vector<std::string>& commands);
+    bool deliver(const char* data, const size_t& size, std::vector<std::string>& outputs);
+
+    // Stop the worker unless the transaction 'done' cleanly. Throws JobCancelled or Spawn::Timeout as runBatch() does
+    bool conclude(const bool& done, const bool& timedOut, const std::chrono::milliseconds& timeout, const Cancel::Token& token);
+
+    // Kill the worker and everything it started, which closes the output pipe. Safe from any thread
+    void kill() { tree.kill(); }
+
+#ifdef _WIN32
+    // Overlapped read end of the worker's output
+    HANDLE outputPipe() const { return hOutput; }
+
+    // Post reads of outputPipe() to 'port'. A pipe binds to one port for good, so false for any other
+    bool bindTo(HANDLE port);
+#else
+    // Non-blocking read end of the worker's output
+    int outputPipe() const { return output; }
+#endif
+
+private:
+#ifdef _WIN32
+    HANDLE hProcess;    // Worker process
+    HANDLE hInput;      // Write end of worker stdin
+    HANDLE hOutput;     // Read end of worker stdout/stderr, overlapped
+    HANDLE hReadEvent;  // Signals a blocking read on hOutput
+    HANDLE boundPort;   // Completion port hOutput is bound to, if any
+#else
+    pid_t pid;          // Worker process
+    int input;          // Our end of the worker's stdin socket
+    int output;         // Read end of worker stdout/stderr, non-blocking
+#endif
+    bool alive;
+    Spawn::ProcessTree tree; // Worker and the consoles it launches
+
+    unsigned long sequence;         // Used to build a unique end-of-command marker
+    std::string pending;            // Bytes read past the last marker
+    std::vector<std::string> markers; // End-of-command markers of the transaction in flight
+    std::vector<std::string> lastOutput; // Output of the last command, reused between runs
+    std::vector<int> exitCodes;
+    size_t completed;               // Commands of the last transaction whose end marker was seen
+
+    // Write the whole request to the worker's stdin. False if the worker is gone
+    bool send(const std::string& request);
+
+    // Append whatever output the worker has next to 'pending', waiting for some. False once the pipe is closed
+    bool receive();
+
+    // Write commands to worker in one go, each followed by its end-of-command marker
+    bool request(const std::vector<std::string>& commands);
+
+    // Move every output whose marker has arrived from 'pending' to 'outputs'. True once all are in
+    bool collect(std::vector<std::string>& outputs);
+
+    // Write commands to worker in one go and collect each output up to its end-of-command marker
+    bool transact(const std::vector<std::string>& commands, std::vector<std::string>& outputs);
+
+    // transact() under a deadline and a cancellation token. Throws Spawn::Timeout or JobCancelled once the worker has been killed
+    bool transactWithin(const std::vector<std::string>& commands, std::vector<std::string>& outputs, const std::chrono::milliseconds& timeout,
+                        const Cancel::Token& token);
+};
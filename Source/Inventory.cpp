@@ -0,0 +1,89 @@
+#include "Inventory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace Inventory {
+
+std::string defaultPath() {
+    const char* path = getenv("PASSMARK_INVENTORY");
+    return (path != nullptr && *path != '\0') ? path : "passmark_inventory.txt";
+}
+
+std::vector<Entry> load(const std::string& path) {
+    std::vector<Entry> entries;
+    std::ifstream file(path);
+    std::string line;
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::stringstream ss(line);
+        Entry entry;
+        std::string lastSeen;
+        if (!getline(ss, entry.serialNumber, '\t') || !getline(ss, entry.type, '\t') || !getline(ss, lastSeen)) continue;
+        if (entry.serialNumber.empty() || (entry.type != "PM240" && entry.type != "PM125")) continue;
+
+        entry.lastSeen = atoll(lastSeen.c_str());
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+bool save(const std::string& path, const std::vector<Entry>& entries) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file) return false;
+        for (const Entry& e : entries) file << e.serialNumber << '\t' << e.type << '\t' << e.lastSeen << '\n';
+        if (!file.flush()) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec); // Replaces an existing cache
+    return !ec;
+}
+
+std::vector<Entry> merge(const std::vector<Entry>& cached, const std::vector<Entry>& found, const long long& now) {
+    std::vector<Entry> merged;
+    for (const Entry& c : cached) {
+        if (now - c.lastSeen < FORGET_AFTER) merged.push_back(c);
+    }
+
+    for (const Entry& f : found) {
+        bool known = false;
+        for (Entry& m : merged) {
+            if (m.serialNumber != f.serialNumber) continue;
+            m.type = f.type;
+            m.lastSeen = now;
+            known = true;
+            break;
+        }
+
+        if (!known) {
+            merged.push_back(f);
+            merged.back().lastSeen = now;
+        }
+    }
+
+    return merged;
+}
+
+bool missedLastPass(const std::vector<Entry>& entries, const Entry& entry) {
+    long long newest = 0;
+    for (const Entry& e : entries) newest = std::max(newest, e.lastSeen);
+    return entry.lastSeen < newest;
+}
+
+long long now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief On-disk cache of known testers, so startup doesn't wait on discovery.
+ * One tester per line: "SN<TAB>type<TAB>last seen (Unix seconds)".
+ */
+namespace Inventory {
+    struct Entry {
+        std::string serialNumber;
+        std::string type;           // "PM240" or "PM125"
+        long long lastSeen = 0;     // Unix seconds
+    };
+
+    // PASSMARK_INVENTORY if set, otherwise "passmark_inventory.txt" in the working directory
+    std::string defaultPath();
+
+    // Read the cache. Empty if the file is missing, malformed lines are skipped
+    std::vector<Entry> load(const std::string& path);
+
+    // Replace the cache. Written to a temporary file and renamed, so a crash never leaves it half written
+    bool save(const std::string& path, const std::vector<Entry>& entries);
+
+    // Testers missing from discovery this long are dropped from the cache
+    const long long FORGET_AFTER = 30LL * 24 * 3600;
+
+    // Fold a discovery pass into the cache. Found testers get 'now' as last seen and missing ones keep
+    // their old time, until they pass FORGET_AFTER. Order is kept, new testers are appended
+    std::vector<Entry> merge(const std::vector<Entry>& cached, const std::vector<Entry>& found, const long long& now);
+
+    // True if the discovery pass that last wrote 'entries' didn't find 'entry'. Every tester a pass finds gets
+    // the same time, so those behind the newest time were missing
+    bool missedLastPass(const std::vector<Entry>& entries, const Entry& entry);
+
+    // Current time in Unix seconds
+    long long now();
+}
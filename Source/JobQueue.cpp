@@ -0,0 +1,225 @@
+#include "JobQueue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+    // Key=value pairs in plan syntax, so TestPlan validates the shared keys
+    std::string toPlanSection(const std::string& tokens, std::string& id, std::string& kind, std::string& state, std::string& sn, std::string& error) {
+        std::string section = "[tester any]\n";
+        std::stringstream ss(tokens);
+        std::string token;
+        while (ss >> token) {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos || eq == 0) throw std::runtime_error("Expected key=value, got " + token);
+            std::string key = token.substr(0, eq), value = token.substr(eq + 1);
+
+            if (key == "id") id = value;
+            else if (key == "kind") kind = value;
+            else if (key == "state") state = value;
+            else if (key == "tester") sn = value;
+            else if (key == "error") error = value;
+            else section += key + " = " + value + "\n";
+        }
+        return section;
+    }
+
+    // Errors are stored as one token with no comment marker
+    std::string encode(std::string text) {
+        for (char& c : text) {
+            if (c == ' ' || c == '\t' || c == '#' || c == '\n') c = '_';
+        }
+        return text;
+    }
+
+    // Id for a line that has none, from its text and the number of identical id-less lines above it
+    std::string derivedId(const std::string& line, const int& occurrence) {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (char c : line) hash = (hash ^ (unsigned char)c) * 16777619u;
+
+        char id[24];
+        snprintf(id, sizeof(id), "J%08x", (unsigned)hash);
+        return (occurrence == 0) ? id : std::string(id) + "-" + std::to_string(occurrence + 1);
+    }
+
+    // What an earlier run saved for one job
+    struct SavedState {
+        std::string state, tester, error;
+    };
+
+    // Read the state file, keyed by job id. Missing file is an empty map, unreadable lines are skipped
+    std::map<std::string, SavedState> loadStates(const std::string& path) {
+        std::map<std::string, SavedState> states;
+        std::ifstream file(path);
+        std::string line;
+        while (getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            std::string id;
+            SavedState saved;
+            std::stringstream ss(line);
+            std::string token;
+            while (ss >> token) {
+                size_t eq = token.find('=');
+                if (eq == std::string::npos) continue;
+                std::string key = token.substr(0, eq), value = token.substr(eq + 1);
+                if (key == "id") id = value;
+                else if (key == "state") saved.state = value;
+                else if (key == "tester") saved.tester = value;
+                else if (key == "error") saved.error = value;
+            }
+            if (!id.empty()) states[id] = saved;
+        }
+        return states;
+    }
+
+    // A job running when its state was written belonged to a process that is gone
+    DutJob::State parseState(const std::string& state) {
+        if (state == "passed") return DutJob::State::Passed;
+        if (state == "failed") return DutJob::State::Failed;
+        return DutJob::State::Pending;
+    }
+}
+
+const char* DutJob::kindStr() const {
+    return (kind == Kind::Stress) ? "stress" : "sweep";
+}
+
+const char* DutJob::stateStr() const {
+    const char* names[] = {"pending", "running", "passed", "failed"};
+    return names[(int)state];
+}
+
+/**
+ * JobQueue member function definitions
+ */
+JobQueue::JobQueue(const std::string& path) : filePath(path), stateFilePath(path + ".state") {}
+
+void JobQueue::reload() {
+    std::ifstream file(filePath);
+    if (!file) throw std::runtime_error("Could not open job queue " + filePath);
+
+    std::map<std::string, SavedState> saved;
+    if (!stateRestored) saved = loadStates(stateFilePath);
+
+    std::vector<std::string> seen;
+    std::map<std::string, int> idless; // Id-less lines read so far, by text
+    std::string raw;
+    int lineNum = 0;
+    while (getline(file, raw)) {
+        ++lineNum;
+        std::string line = raw.substr(0, raw.find('#'));
+        size_t last = line.find_last_not_of(" \t\r");
+        if (last == std::string::npos) continue;
+        line.erase(last + 1);
+
+        DutJob job;
+        std::string kind = "stress", state = "pending";
+        try {
+            std::istringstream section(toPlanSection(line, job.id, kind, state, job.tester, job.error));
+            job.rule = TestPlan::parse(section, "").testers.front();
+        } catch (const std::runtime_error& e) {
+            // Swap the section's position for the queue line
+            std::string problem = e.what();
+            size_t cut = problem.find(": ");
+            throw std::runtime_error(filePath + ":" + std::to_string(lineNum) + ": " + ((cut == std::string::npos) ? problem : problem.substr(cut + 2)));
+        }
+
+        if (kind == "stress") job.kind = DutJob::Kind::Stress;
+        else if (kind == "sweep") job.kind = DutJob::Kind::Sweep;
+        else throw std::runtime_error(filePath + ":" + std::to_string(lineNum) + ": kind must be stress or sweep");
+
+        if (job.id.empty()) job.id = derivedId(line, idless[line]++);
+        seen.push_back(job.id);
+
+        // The queue in memory is newer than either file for every job it already has
+        if (this->find(job.id) != nullptr) continue;
+
+        auto restored = saved.find(job.id);
+        if (restored != saved.end()) {
+            state = restored->second.state;
+            job.tester = restored->second.tester;
+            job.error = restored->second.error;
+        }
+        job.state = parseState(state);
+        queue.push_back(job);
+        dirty = true;
+    }
+    stateRestored = true;
+
+    // Pending jobs deleted from the file are withdrawn
+    size_t before = queue.size();
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const DutJob& j) {
+        return j.state == DutJob::State::Pending && std::find(seen.begin(), seen.end(), j.id) == seen.end();
+    }), queue.end());
+    if (queue.size() != before) dirty = true;
+}
+
+bool JobQueue::save() {
+    if (!dirty) return true;
+
+    std::string tempPath = stateFilePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file) return false;
+
+        file << "# Passmark job state for " << filePath << ", written by the dispatcher. Add jobs to the queue file, not here\n";
+        for (const DutJob& j : queue) {
+            file << "id=" << j.id << " kind=" << j.kindStr() << " state=" << j.stateStr();
+            if (!j.tester.empty()) file << " tester=" << j.tester;
+            if (!j.error.empty()) file << " error=" << encode(j.error);
+            file << "\n";
+        }
+        if (!file.flush()) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, stateFilePath, ec);
+    if (!ec) dirty = false;
+    return !ec;
+}
+
+DutJob* JobQueue::find(const std::string& id) {
+    for (DutJob& j : queue) {
+        if (j.id == id) return &j;
+    }
+    return nullptr;
+}
+
+DutJob* JobQueue::next(const std::string& testerType) {
+    for (DutJob& j : queue) {
+        if (j.state == DutJob::State::Pending && j.runsOn(testerType)) return &j;
+    }
+    return nullptr;
+}
+
+void JobQueue::start(DutJob& job, const std::string& sn) {
+    job.state = DutJob::State::Running;
+    job.tester = sn;
+    job.error.clear();
+    dirty = true;
+}
+
+void JobQueue::finish(const std::string& id, const DutJob::State& state, const std::string& error) {
+    DutJob* job = this->find(id);
+    if (job == nullptr) return;
+    job->state = state;
+    job->error = error;
+    dirty = true;
+}
+
+void JobQueue::requeue(const std::string& id) {
+    this->finish(id, DutJob::State::Pending);
+}
+
+size_t JobQueue::count(const DutJob::State& state) const {
+    return std::count_if(queue.begin(), queue.end(), [&](const DutJob& j) { return j.state == state; });
+}
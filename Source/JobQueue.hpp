@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "TestPlan.hpp"
+
+// One DUT test waiting for, or given to, a tester
+struct DutJob {
+    enum class Kind { Stress, Sweep };
+    enum class State { Pending, Running, Passed, Failed };
+
+    std::string id;
+    Kind kind = Kind::Stress;
+    TesterPlan rule;            // Tester type filter, profile rule, load and duration. Serial number unused
+    State state = State::Pending;
+    std::string tester;         // Serial number of the tester that last ran it
+    std::string error;          // Why it failed
+
+    // True if a tester of 'testerType' can run this job
+    bool runsOn(const std::string& testerType) const { return rule.type.empty() || rule.type == testerType; }
+
+    const char* kindStr() const;
+    const char* stateStr() const;
+};
+
+/**
+ * @brief DUT jobs kept in a file, so the queue outlives the process and can be topped up while it runs.
+ * One job per line as key=value pairs, '#' starts a comment:
+ *
+ *     id=J1 kind=stress type=PM240 profiles=max duration=60 load=2000
+ *     id=J2 kind=sweep profiles=all min_voltage=9000
+ *
+ * kind is stress or sweep, the other keys are as in a test plan's [tester any] section. A line without an
+ * id gets one from its text, so it names the same job on every read. The queue file belongs to whoever adds
+ * jobs and is never written here. The dispatcher keeps each job's state, tester and error in "<queue>.state"
+ * instead, so a line appended while it saves can't be lost. Jobs left running by a crashed process go back
+ * to pending. Not thread safe, owned by the dispatcher.
+ */
+class JobQueue
+{
+public:
+    explicit JobQueue(const std::string& path);
+
+    // Pick up jobs added to the file since the last read, and drop pending jobs removed from it. The first read also
+    // restores states saved by an earlier run. Throws on a malformed line
+    void reload();
+
+    // Write every job's state to the state file. Returns false if it couldn't be replaced
+    bool save();
+
+    // First pending job a tester of 'testerType' can run, or nullptr
+    DutJob* next(const std::string& testerType);
+
+    void start(DutJob& job, const std::string& sn);
+    void finish(const std::string& id, const DutJob::State& state, const std::string& error = "");
+
+    // Put a job back in the queue, e.g. its tester was unplugged
+    void requeue(const std::string& id);
+
+    size_t count(const DutJob::State& state) const;
+    const std::vector<DutJob>& jobs() const { return queue; }
+    const std::string& path() const { return filePath; }
+    const std::string& statePath() const { return stateFilePath; }
+
+private:
+    std::string filePath;
+    std::string stateFilePath;
+    std::vector<DutJob> queue;
+    bool dirty = false;
+    bool stateRestored = false;
+
+    DutJob* find(const std::string& id);
+};
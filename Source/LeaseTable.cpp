@@ -0,0 +1,448 @@
+#include "LeaseTable.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[8] = {'P', 'M', 'L', 'E', 'A', 'S', 'E', '\0'};
+    const uint32_t VERSION = 1;
+    const size_t MAX_LEASES = 64;
+    const size_t MAX_WAITERS = 64;
+    const std::chrono::seconds TTL(60);             // A lease nobody renews for this long is reclaimed
+    const std::chrono::seconds RENEW_PERIOD(15);
+    const std::chrono::milliseconds POLL(100);      // Queue re-check while waiting
+
+    // Fixed layout, shared by every process on the machine. An entry with pid 0 is free
+    struct Slot {
+        char serial[32];
+        uint32_t pid;
+        uint32_t reserved;
+        uint64_t pidStart;  // Process start time, so a reused PID isn't mistaken for the holder
+        int64_t expiry;     // ms since Unix epoch
+        char job[64];
+    };
+
+    struct Waiter {
+        char serial[32];
+        uint32_t pid;
+        uint32_t reserved;
+        uint64_t pidStart;
+        uint64_t ticket;    // Lower tickets go first
+        int64_t expiry;
+    };
+
+    struct Table {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t nextTicket;
+        Slot leases[MAX_LEASES];
+        Waiter waiters[MAX_WAITERS];
+    };
+
+    int64_t epochMillis(const std::chrono::system_clock::time_point& t = std::chrono::system_clock::now()) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+    }
+
+    int64_t expiryFromNow() {
+        return epochMillis(std::chrono::system_clock::now() + TTL);
+    }
+
+    // Copy into a fixed field, always terminated
+    void copyField(char* dst, const size_t& size, const std::string& src) {
+        size_t n = std::min(size - 1, src.size());
+        memcpy(dst, src.data(), n);
+        memset(dst + n, 0, size - n);
+    }
+
+    std::string field(const char* src, const size_t& size) {
+        return std::string(src, strnlen(src, size));
+    }
+
+    bool is(const char* serial, const std::string& sn) {
+        return field(serial, 32) == sn;
+    }
+
+#ifdef _WIN32
+    uint32_t selfPid() { return GetCurrentProcessId(); }
+
+    uint64_t processStart(const uint32_t& pid) {
+        HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (h == NULL) return 0;
+        FILETIME created, exited, kernel, user;
+        uint64_t start = 0;
+        if (GetProcessTimes(h, &created, &exited, &kernel, &user)) start = ((uint64_t)created.dwHighDateTime << 32) | created.dwLowDateTime;
+        CloseHandle(h);
+        return start;
+    }
+
+    bool processAlive(const uint32_t& pid, const uint64_t& start) {
+        HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (h == NULL) return GetLastError() == ERROR_ACCESS_DENIED; // Exists, but belongs to someone else
+        DWORD code = 0;
+        bool alive = GetExitCodeProcess(h, &code) && code == STILL_ACTIVE;
+        CloseHandle(h);
+        return alive && (start == 0 || processStart(pid) == start);
+    }
+
+    std::string processName() {
+        char path[MAX_PATH] = {};
+        DWORD n = GetModuleFileNameA(NULL, path, MAX_PATH);
+        std::string name(path, n);
+        size_t slash = name.find_last_of("\\/");
+        return (slash == std::string::npos) ? name : name.substr(slash + 1);
+    }
+#else
+    uint32_t selfPid() { return (uint32_t)getpid(); }
+
+    // Field 22 of /proc/<pid>/stat, clock ticks since boot
+    uint64_t processStart(const uint32_t& pid) {
+        std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+        std::string line;
+        if (!getline(stat, line)) return 0;
+        size_t pos = line.rfind(')'); // Process name may contain spaces
+        if (pos == std::string::npos) return 0;
+        for (int i = 0; i < 20; ++i) {
+            pos = line.find(' ', pos + 1);
+            if (pos == std::string::npos) return 0;
+        }
+        return strtoull(line.c_str() + pos + 1, nullptr, 10);
+    }
+
+    bool processAlive(const uint32_t& pid, const uint64_t& start) {
+        bool alive = kill((pid_t)pid, 0) == 0 || errno == EPERM;
+        return alive && (start == 0 || processStart(pid) == start);
+    }
+
+    std::string processName() {
+        std::ifstream comm("/proc/self/comm");
+        std::string name;
+        getline(comm, name);
+        return name;
+    }
+#endif
+
+    /**
+     * The mapped table and this process's side of it. Every access to the table goes through Guard, which holds
+     * a machine-wide lock that the OS releases if its holder dies
+     */
+    class Shared
+    {
+    public:
+        Table* table = nullptr;
+        const uint32_t pid = selfPid();
+        const uint64_t pidStart = processStart(selfPid());
+
+        struct Guard {
+            Shared& s;
+            explicit Guard(Shared& shared) : s(shared) { s.lock(); }
+            ~Guard() { s.unlock(); }
+        };
+
+        Shared() {
+#ifdef _WIN32
+            // Global names cover every session but need a privilege to create the mapping. Fall back to this session
+            for (const char* scope : {"Global\\", "Local\\"}) {
+                hLock = CreateMutexA(NULL, FALSE, (std::string(scope) + "Passmark_LeaseLock").c_str());
+                hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(Table), (std::string(scope) + "Passmark_Leases").c_str());
+                if (hLock != NULL && hMapping != NULL) break;
+                this->close();
+            }
+            if (hMapping != NULL) table = static_cast<Table*>(MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Table)));
+#else
+            fd = shm_open("/passmark_leases", O_RDWR | O_CREAT, 0666);
+            if (fd >= 0) {
+                struct stat st;
+                bool sized = fstat(fd, &st) == 0 && ((size_t)st.st_size >= sizeof(Table) || ftruncate(fd, sizeof(Table)) == 0);
+                void* p = (sized) ? mmap(nullptr, sizeof(Table), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+                if (p != MAP_FAILED) table = static_cast<Table*>(p);
+            }
+#endif
+            if (table == nullptr) {
+                this->close();
+                return;
+            }
+
+            // A new mapping is zeroed. One from an incompatible build is reset
+            Guard g(*this);
+            if (memcmp(table->magic, MAGIC, sizeof(MAGIC)) != 0 || table->version != VERSION) {
+                memset(table, 0, sizeof(Table));
+                memcpy(table->magic, MAGIC, sizeof(MAGIC));
+                table->version = VERSION;
+            }
+        }
+
+        ~Shared() {
+            {
+                std::lock_guard<std::mutex> guard(heldLock);
+                stopping = true;
+            }
+            wake.notify_all();
+            if (renewer.joinable()) renewer.join();
+            this->close();
+        }
+
+        // Clear leases and queue places whose process has gone or stopped renewing. Call under Guard
+        void reap() {
+            int64_t now = epochMillis();
+            for (Slot& s : table->leases) {
+                if (s.pid != 0 && s.pid != pid && (s.expiry < now || !processAlive(s.pid, s.pidStart))) memset(&s, 0, sizeof(Slot));
+            }
+            for (Waiter& w : table->waiters) {
+                if (w.pid != 0 && w.pid != pid && (w.expiry < now || !processAlive(w.pid, w.pidStart))) memset(&w, 0, sizeof(Waiter));
+            }
+        }
+
+        Slot* lease(const std::string& sn) {
+            for (Slot& s : table->leases) {
+                if (s.pid != 0 && is(s.serial, sn)) return &s;
+            }
+            return nullptr;
+        }
+
+        // Keep leases this process holds from expiring while it runs
+        void hold(const std::string& sn) {
+            std::lock_guard<std::mutex> guard(heldLock);
+            held.push_back(sn);
+            if (!renewer.joinable()) renewer = std::thread(&Shared::renewLoop, this);
+        }
+
+        void drop(const std::string& sn) {
+            std::lock_guard<std::mutex> guard(heldLock);
+            held.erase(std::remove(held.begin(), held.end(), sn), held.end());
+        }
+
+    private:
+#ifdef _WIN32
+        HANDLE hLock = NULL;
+        HANDLE hMapping = NULL;
+#else
+        int fd = -1;
+#endif
+        std::mutex heldLock;                // Guards 'held' and 'stopping'
+        std::vector<std::string> held;
+        bool stopping = false;
+        std::condition_variable wake;
+        std::thread renewer;
+
+        void lock() {
+#ifdef _WIN32
+            WaitForSingleObject(hLock, INFINITE); // WAIT_ABANDONED: holder died mid-update, reap() tidies up after it
+#else
+            flock(fd, LOCK_EX);
+#endif
+        }
+
+        void unlock() {
+#ifdef _WIN32
+            ReleaseMutex(hLock);
+#else
+            flock(fd, LOCK_UN);
+#endif
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (table != nullptr) UnmapViewOfFile(table);
+            if (hMapping != NULL) CloseHandle(hMapping);
+            if (hLock != NULL) CloseHandle(hLock);
+            hMapping = NULL;
+            hLock = NULL;
+#else
+            if (table != nullptr) munmap(table, sizeof(Table));
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+            table = nullptr;
+        }
+
+        void renewLoop() {
+            std::unique_lock<std::mutex> heldGuard(heldLock);
+            while (!stopping) {
+                wake.wait_for(heldGuard, RENEW_PERIOD);
+                if (stopping) break;
+
+                std::vector<std::string> mine = held;
+                heldGuard.unlock();
+                {
+                    Guard g(*this);
+                    for (const std::string& sn : mine) {
+                        Slot* s = this->lease(sn);
+                        if (s != nullptr && s->pid == pid) s->expiry = expiryFromNow();
+                    }
+                }
+                heldGuard.lock();
+            }
+        }
+    };
+
+    Shared& shared() {
+        static Shared instance; // Mapped on first use, renewer joined at exit
+        return instance;
+    }
+}
+
+namespace Lease {
+
+bool available() {
+    return shared().table != nullptr;
+}
+
+bool acquire(const std::string& sn, const std::chrono::milliseconds& wait, const std::string& job) {
+    Shared& s = shared();
+    if (s.table == nullptr) return false;
+
+    auto deadline = std::chrono::steady_clock::now() + wait;
+    uint64_t ticket = 0; // Place in the queue once this process has to wait
+
+    auto leave = [&]() {
+        for (Waiter& w : s.table->waiters) {
+            if (w.pid == s.pid && w.ticket == ticket) memset(&w, 0, sizeof(Waiter));
+        }
+    };
+
+    while (true) {
+        {
+            Shared::Guard g(s);
+            s.reap();
+            Table& t = *s.table;
+            Slot* current = s.lease(sn);
+
+            // Earlier claimants go first
+            bool first = true;
+            for (const Waiter& w : t.waiters) {
+                if (w.pid != 0 && is(w.serial, sn) && (ticket == 0 || w.ticket < ticket)) first = false;
+            }
+
+            if (current == nullptr && first) {
+                for (Slot& free : t.leases) {
+                    if (free.pid != 0) continue;
+                    copyField(free.serial, sizeof(free.serial), sn);
+                    copyField(free.job, sizeof(free.job), job.empty() ? processName() : job);
+                    free.pid = s.pid;
+                    free.pidStart = s.pidStart;
+                    free.expiry = expiryFromNow();
+                    if (ticket != 0) leave();
+                    s.hold(sn);
+                    return true;
+                }
+                // Table full, wait for a lease to be given up
+            }
+
+            if (std::chrono::steady_clock::now() >= deadline) {
+                if (ticket != 0) leave();
+                return false;
+            }
+
+            // Join the queue, or show that this process is still waiting
+            Waiter* mine = nullptr;
+            for (Waiter& w : t.waiters) {
+                if ((ticket != 0 && w.pid == s.pid && w.ticket == ticket) || (ticket == 0 && w.pid == 0 && mine == nullptr)) mine = &w;
+            }
+            if (mine == nullptr) return false; // Queue full
+            if (ticket == 0) {
+                ticket = ++t.nextTicket;
+                copyField(mine->serial, sizeof(mine->serial), sn);
+                mine->pid = s.pid;
+                mine->pidStart = s.pidStart;
+                mine->ticket = ticket;
+            }
+            mine->expiry = expiryFromNow();
+        }
+
+        auto left = deadline - std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(POLL, std::max<std::chrono::steady_clock::duration>(left, std::chrono::milliseconds(1))));
+    }
+}
+
+void release(const std::string& sn) {
+    Shared& s = shared();
+    if (s.table == nullptr) return;
+
+    s.drop(sn);
+    Shared::Guard g(s);
+    Slot* lease = s.lease(sn);
+    if (lease != nullptr && lease->pid == s.pid) memset(lease, 0, sizeof(Slot));
+}
+
+void describe(const std::string& sn, const std::string& job) {
+    Shared& s = shared();
+    if (s.table == nullptr) return;
+
+    Shared::Guard g(s);
+    Slot* lease = s.lease(sn);
+    if (lease != nullptr && lease->pid == s.pid) copyField(lease->job, sizeof(lease->job), job);
+}
+
+std::vector<Holder> holders() {
+    Shared& s = shared();
+    std::vector<Holder> list;
+    if (s.table == nullptr) return list;
+
+    Shared::Guard g(s);
+    s.reap();
+    for (const Slot& slot : s.table->leases) {
+        if (slot.pid == 0) continue;
+
+        Holder h;
+        h.serialNumber = field(slot.serial, sizeof(slot.serial));
+        h.pid = slot.pid;
+        h.job = field(slot.job, sizeof(slot.job));
+        h.expiry = std::chrono::system_clock::time_point(std::chrono::milliseconds(slot.expiry));
+
+        std::vector<const Waiter*> queue;
+        for (const Waiter& w : s.table->waiters) {
+            if (w.pid != 0 && is(w.serial, h.serialNumber)) queue.push_back(&w);
+        }
+        std::sort(queue.begin(), queue.end(), [](const Waiter* a, const Waiter* b) { return a->ticket < b->ticket; });
+        for (const Waiter* w : queue) h.waiting.push_back(w->pid);
+
+        list.push_back(h);
+    }
+    return list;
+}
+
+bool heldByOther(const std::string& sn, Holder& holder) {
+    for (const Holder& h : holders()) {
+        if (h.serialNumber == sn && h.pid != shared().pid) {
+            holder = h;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string describeHolder(const Holder& holder) {
+    std::string text = "PID " + std::to_string(holder.pid);
+    if (!holder.job.empty()) text += " (" + holder.job + ")";
+    if (!holder.waiting.empty()) text += ", " + std::to_string(holder.waiting.size()) + " waiting";
+    return text;
+}
+
+std::chrono::milliseconds defaultWait() {
+    const char* wait = getenv("PASSMARK_LEASE_WAIT");
+    return std::chrono::seconds((wait != nullptr && atoi(wait) > 0) ? atoi(wait) : 0);
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Tester leases shared by every Passmark tool on the machine.
+ * A fixed table in named shared memory records who holds each tester: owner PID, a job description and when
+ * the lease runs out. Processes that want a busy tester queue behind it in ticket order. Leases and queue
+ * places held by processes that have exited, or that stopped renewing, are reclaimed by the next process to
+ * look. Leases held by this process are renewed by a background thread.
+ */
+namespace Lease {
+    struct Holder {
+        std::string serialNumber;
+        uint32_t pid = 0;
+        std::string job;
+        std::chrono::system_clock::time_point expiry;
+        std::vector<uint32_t> waiting;  // PIDs queued for the tester, first in line first
+    };
+
+    // False if the shared table couldn't be opened. Callers then fall back to their own locking
+    bool available();
+
+    // Take the lease on 'sn', queueing up to 'wait' behind earlier claimants. 'job' describes the work, the process
+    // name if empty. Returns false if it's still held when the wait runs out
+    bool acquire(const std::string& sn, const std::chrono::milliseconds& wait, const std::string& job = "");
+
+    // Give up a lease held by this process
+    void release(const std::string& sn);
+
+    // Change the job shown for a lease held by this process
+    void describe(const std::string& sn, const std::string& job);
+
+    // Every lease in the table, after reclaiming dead ones
+    std::vector<Holder> holders();
+
+    // Lease on 'sn' held by another process, if any
+    bool heldByOther(const std::string& sn, Holder& holder);
+
+    // "PID 1234 (batstress.exe J3)", for messages
+    std::string describeHolder(const Holder& holder);
+
+    // PASSMARK_LEASE_WAIT seconds to queue for a busy tester, 0 by default
+    std::chrono::milliseconds defaultWait();
+}
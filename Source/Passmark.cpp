@@ -1,4 +1,7 @@
 #include "Passmark.hpp"
+#include "AsyncLog.hpp"
+#include "Inventory.hpp"
+#include "LeaseTable.hpp"
 
 #include <string>
 #include <sstream>
@@ -8,6 +11,11 @@
 #include <Windows.h>
 #include <atomic>
 #include <utility>
+#include <chrono>
+#include <iomanip>
+#include <future>
+#include <algorithm>
+#include <cstdlib>
 
 bool is_numeric(const std::string& numStr) {
     for (char c : numStr) {
@@ -31,9 +39,100 @@ std::string getNumStr(const std::string& inputStr, const size_t& startPos) {
     return NumStr;
 }
 
+namespace {
+    // Background reconcile of the inventory cache. Held here so it can finish while testing starts, see stopDiscovery()
+    std::future<testerList> reconcileJob;
+
+    // Cancels the discovery behind reconcileJob. Ctrl+C cancels it too
+    Cancel::Token discoveryToken = Cancel::global().child();
+
+    // Run discovery and fold the result into the cache
+    testerList reconcileInventory(const std::string& path, const std::vector<Inventory::Entry>& cached, const bool& toConsole) {
+        testerList found = findTesters(toConsole, discoveryToken);
+
+        std::vector<Inventory::Entry> entries;
+        for (size_t i = 0; i < found.testers.size(); ++i) entries.push_back({found.testers[i], found.type[i], 0});
+        if (!Inventory::save(path, Inventory::merge(cached, entries, Inventory::now()))) {
+            Log::submit(7, true, "WARNING: Could not write tester inventory " + path);
+        }
+
+        return found;
+    }
+}
+
+namespace {
+    // " - in use by PID 1234 (usbvalidator.exe)" if another process holds the tester
+    std::string inUse(const std::string& sn) {
+        Lease::Holder holder;
+        return Lease::heldByOther(sn, holder) ? " - in use by " + Lease::describeHolder(holder) : "";
+    }
+
+    // Testers to choose from: the cached inventory, reconciled in the background, or a live discovery without a cache
+    testerList knownTesters() {
+        std::string inventoryPath = Inventory::defaultPath();
+        std::vector<Inventory::Entry> cached = Inventory::load(inventoryPath);
+        if (cached.empty()) return reconcileInventory(inventoryPath, cached, true);
+
+        testerList list;
+        std::cout << "Known testers (checking for changes in the background):\n";
+        for (const Inventory::Entry& e : cached) {
+            list.testers.push_back(e.serialNumber);
+            list.type.push_back(e.type);
+            std::cout << "(" << list.testers.size() << ") " << e.serialNumber << " [" << e.type << "]" << inUse(e.serialNumber)
+                      << (Inventory::missedLastPass(cached, e) ? " - not found by the last discovery" : "") << std::endl;
+        }
+        reconcileJob = std::async(std::launch::async, reconcileInventory, inventoryPath, cached, false);
+        return list;
+    }
+
+    // Result of the background discovery if it has already finished, or once it finishes with 'wait' set. 'live' is
+    // left alone if there's no result
+    bool finishedDiscovery(testerList& live, const bool& wait = false) {
+        if (!reconcileJob.valid()) return false;
+        if (!wait && reconcileJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        try {
+            live = reconcileJob.get();
+        } catch (const std::runtime_error&) { // Nothing connected
+            live = testerList();
+        }
+        return true;
+    }
+
+    // Claim a tester for this process and start its console worker. Waits PASSMARK_LEASE_WAIT for a tester another
+    // process holds, then throws
+    tester claimTester(const std::string& sn, const std::string& type) {
+        tester placeHolder;
+        std::chrono::milliseconds wait = Lease::defaultWait();
+        Lease::Holder holder;
+        if (wait.count() > 0 && Lease::heldByOther(sn, holder)) {
+            std::cout << sn << " is in use by " << Lease::describeHolder(holder) << ". Waiting up to "
+                      << std::chrono::duration_cast<std::chrono::seconds>(wait).count() << "s..." << std::endl;
+        }
+
+        if (!placeHolder.tryClaim(sn, wait)) {
+            throw std::runtime_error(sn + " is in use" + (Lease::heldByOther(sn, holder) ? " by " + Lease::describeHolder(holder) : "") + ".");
+        }
+
+        placeHolder.assignType(type);
+        if (!placeHolder.startSession()) Log::submit(7, true, "WARNING: No console worker for " + placeHolder.serialNumber + ", spawning per command");
+        return placeHolder;
+    }
+}
+
+void stopDiscovery() {
+    discoveryToken.cancel();
+    if (!reconcileJob.valid()) return;
+
+    try {
+        reconcileJob.get();
+    } catch (const std::exception&) {} // Cancelled, or nothing connected
+}
+
 std::vector<tester> getTesters() {
-    // Find available Passmark testers
-    testerList list = findTesters();
+    // Offer the cached inventory straight away and reconcile it with a live discovery in the background.
+    // Without a cache, discover first
+    testerList list = knownTesters();
 
     // User selects tester(s)
     std::cout << "Enter tester(s) to be used. For multiple testers, separate tester numbers with commas. Do not use spaces.\n\nSelection:\t";
@@ -42,25 +141,87 @@ std::vector<tester> getTesters() {
     std::cout << std::endl;
     if (selection.empty()) throw std::runtime_error("No tester(s) selected.");
 
+    // If the background discovery has already finished, selected testers must still be connected
+    testerList live;
+    bool checked = finishedDiscovery(live);
+
     // Initialize tester objects
     std::vector<tester> validTesters;
     std::stringstream ss(selection);
     std::string field;
     while (getline(ss, field, ',')) { // Check user selection is valid and store information to tester object vector
-        tester placeHolder;
         if (!is_numeric(field)) throw std::runtime_error("Tester selection must be an interger!");
         int testerIdx = std::stoi(field) - 1;
+        if (testerIdx < 0 || testerIdx >= (int)list.testers.size()) throw std::runtime_error("Tester selection is out of range!");
+        if (checked && std::find(live.testers.begin(), live.testers.end(), list.testers[testerIdx]) == live.testers.end()) {
+            throw std::runtime_error(list.testers[testerIdx] + " is not connected.");
+        }
 
-        // Check if tester is in use
-        if (placeHolder.tryClaim(list.testers[testerIdx])) {
-            placeHolder.assignType(list.type[testerIdx]);
-            validTesters.push_back(std::move(placeHolder)); 
-        } else throw std::runtime_error(list.testers[testerIdx] + " is in use.");
+        validTesters.push_back(claimTester(list.testers[testerIdx], list.type[testerIdx]));
     }
 
     return validTesters;
 }
 
+std::vector<tester> getPlannedTesters(const TestPlan& plan, std::vector<TesterPlan>& assigned) {
+    testerList list = knownTesters();
+
+    // "any" rules take testers in list order, so offer the ones no other process holds first
+    auto resolve = [&plan](const testerList& candidates) {
+        testerList ordered;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t i = 0; i < candidates.testers.size(); ++i) {
+                if (inUse(candidates.testers[i]).empty() != (pass == 0)) continue;
+                ordered.testers.push_back(candidates.testers[i]);
+                ordered.type.push_back(candidates.type[i]);
+            }
+        }
+        return plan.resolve(ordered.testers, ordered.type);
+    };
+
+    // Resolve against the cache, or the live view if discovery has already finished. Only a plan the cache can't
+    // satisfy waits for discovery, since the testers it names may have been connected since the cache was written
+    testerList live;
+    bool checked = finishedDiscovery(live);
+    try {
+        assigned = resolve((checked) ? live : list);
+    } catch (const std::runtime_error&) {
+        if (checked || !finishedDiscovery(live, true)) throw;
+        assigned = resolve(live);
+    }
+
+    std::vector<tester> validTesters;
+    for (const TesterPlan& t : assigned) {
+        std::cout << "Plan: " << t.serialNumber << " [" << t.type << "] profiles " << t.profiles << ", " << t.durationMinutes << "min" << std::endl;
+        validTesters.push_back(claimTester(t.serialNumber, t.type));
+    }
+
+    return validTesters;
+}
+
+std::string planPath(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--plan") return argv[i + 1];
+    }
+
+    const char* path = getenv("PASSMARK_PLAN");
+    return (path != nullptr) ? path : "";
+}
+
+void reportOutcome(const JobOutcome& outcome) {
+    using namespace std::chrono;
+    long long total = duration_cast<seconds>(outcome.elapsed).count();
+
+    // Format elapsed time as h:mm:ss
+    std::ostringstream line;
+    line << "(" << outcome.name << ") Test " << outcome.statusStr() << " after "
+         << total / 3600 << ":" << std::setfill('0') << std::setw(2) << (total / 60) % 60 << ":" << std::setw(2) << total % 60;
+    if (!outcome.error.empty()) line << ": " << outcome.error;
+
+    // Through the log so it lands after the tester's own lines
+    Log::submit(7, outcome.status == JobOutcome::Status::Failed, line.view());
+}
+
 std::atomic<bool> g_abortRequested(false);
 
 const char* CtrlCAbort::what() const noexcept {
@@ -75,7 +236,8 @@ BOOL WINAPI CtrlHandler(DWORD ctrlType) {
         case CTRL_BREAK_EVENT:
         case CTRL_CLOSE_EVENT:
             g_abortRequested.store(true, std::memory_order_relaxed);
-            // Do NOT throw here, just set the flag
+            // Kills every console command still running and wakes every tester's waits. Do NOT throw here
+            Cancel::global().cancel();
             return TRUE;
 
         default:
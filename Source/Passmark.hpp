@@ -2,7 +2,8 @@
 
 // Project headers
 #include "tester.hpp"
-#include "ThreadBridge.hpp"
+#include "Scheduler.hpp"
+#include "TestPlan.hpp"
 
 // Standard headers
 #include <vector>
@@ -21,6 +22,27 @@ std::string getNumStr(const std::string& inputStr, const size_t& startPos);
 // Check which testers are available and claim
 std::vector<tester> getTesters();
 
+// Claim the testers a plan asks for, without prompting. 'assigned' gets each claimed tester's plan, in the same order
+std::vector<tester> getPlannedTesters(const TestPlan& plan, std::vector<TesterPlan>& assigned);
+
+// Cancel the background inventory discovery started by getTesters() or getPlannedTesters(), and wait for it to end
+void stopDiscovery();
+
+// Calls stopDiscovery() on scope exit, so main() doesn't return while discovery is still polling
+struct DiscoveryScope {
+    DiscoveryScope() = default;
+    ~DiscoveryScope() { stopDiscovery(); }
+
+    DiscoveryScope(const DiscoveryScope&) = delete;
+    DiscoveryScope& operator=(const DiscoveryScope&) = delete;
+};
+
+// Plan file from "--plan <file>" on the command line, or PASSMARK_PLAN. Empty for interactive mode
+std::string planPath(int argc, char* argv[]);
+
+// Print one tester job's outcome as it finishes, e.g. "(SN) Test FAILED after 0:12:03: DUT unresponsive."
+void reportOutcome(const JobOutcome& outcome);
+
 extern std::atomic<bool> g_abortRequested;
 
 struct CtrlCAbort : public std::exception {
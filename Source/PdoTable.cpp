@@ -0,0 +1,169 @@
+#include "PdoTable.hpp"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    // Parse digits at 'pos', advancing past them. Returns 0 if there are none
+    int parseInt(std::string_view s, size_t& pos) {
+        int value = 0;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') value = value * 10 + (s[pos++] - '0');
+        return value;
+    }
+
+    // FNV-1a, folded over each field in turn
+    uint64_t fnv1a(uint64_t h, const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+    uint64_t hashPdo(const Pdo& pdo) {
+        uint64_t h = FNV_OFFSET;
+        h = fnv1a(h, &pdo.index, sizeof(pdo.index));
+        h = fnv1a(h, pdo.typeName.data(), pdo.typeName.size());
+        h = fnv1a(h, &pdo.minVoltage, sizeof(pdo.minVoltage));
+        h = fnv1a(h, &pdo.maxVoltage, sizeof(pdo.maxVoltage));
+        h = fnv1a(h, &pdo.maxCurrent, sizeof(pdo.maxCurrent));
+        return h;
+    }
+
+    PdoType typeFromName(std::string_view name) {
+        if (name == "PD-FIXED" || name == "FIXED") return PdoType::Fixed;
+        if (name == "PD-BATTERY" || name == "BATTERY") return PdoType::Battery;
+        if (name == "PD-VARIABLE" || name == "VARIABLE") return PdoType::Variable;
+        if (name == "PD-PPS") return PdoType::PPS;
+        if (name == "PD-APDO") return PdoType::APDO;
+        if (name == "PD-AVS" || name == "PD-EPR-AVS") return PdoType::AVS;
+        if (name == "QC2") return PdoType::QC2;
+        if (name == "QC3") return PdoType::QC3;
+        return PdoType::Unknown;
+    }
+
+    // Parse one "-p" line. Returns false if the line isn't a profile
+    bool parseLine(std::string_view line, Pdo& pdo) {
+        size_t pos = line.find("INDEX:");
+        if (pos == std::string_view::npos) return false;
+        pos += 6;
+        pdo.index = parseInt(line, pos);
+        if (pdo.index <= 0) return false;
+
+        // TYPE runs up to the next ','
+        size_t tPos = line.find("TYPE:", pos);
+        if (tPos != std::string_view::npos) {
+            tPos += 5;
+            size_t tEnd = line.find(',', tPos);
+            if (tEnd == std::string_view::npos) tEnd = line.size();
+            pdo.typeName = std::string(line.substr(tPos, tEnd - tPos));
+            pos = tEnd;
+        }
+        pdo.type = typeFromName(pdo.typeName);
+        pdo.isVariableVoltage = std::find(VariableVoltageTypes.begin(), VariableVoltageTypes.end(), pdo.typeName) != VariableVoltageTypes.end();
+
+        // Voltage is "V:5000mV" or a range "V:3300-21000mV"
+        size_t vPos = line.find("V:", pos);
+        if (vPos != std::string_view::npos) {
+            vPos += 2;
+            pdo.minVoltage = pdo.maxVoltage = parseInt(line, vPos);
+            if (vPos < line.size() && line[vPos] == '-') {
+                ++vPos;
+                pdo.maxVoltage = parseInt(line, vPos);
+            }
+            pos = vPos;
+        }
+
+        size_t iPos = line.find("I:", pos);
+        if (iPos != std::string_view::npos) {
+            iPos += 2;
+            pdo.maxCurrent = parseInt(line, iPos);
+        }
+
+        pdo.maxPower = (int)((long long)pdo.maxVoltage * pdo.maxCurrent / 1000);
+        pdo.line = std::string(line);
+        pdo.contentHash = hashPdo(pdo);
+        return true;
+    }
+}
+
+PdoTable PdoTable::parse(std::string_view output) {
+    PdoTable table;
+
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string_view::npos) end = output.size();
+
+        // Trim trailing '\r' and spaces
+        size_t last = end;
+        while (last > start && (output[last - 1] == '\r' || output[last - 1] == ' ')) --last;
+
+        Pdo pdo;
+        if (parseLine(output.substr(start, last - start), pdo)) table.pdos.push_back(std::move(pdo));
+        start = end + 1;
+    }
+
+    // Index lookup, power ordering and table hash
+    table.contentHash = FNV_OFFSET;
+    for (size_t i = 0; i < table.pdos.size(); ++i) {
+        table.contentHash = fnv1a(table.contentHash, &table.pdos[i].contentHash, sizeof(uint64_t));
+        int index = table.pdos[i].index;
+        if ((int)table.slotByIndex.size() <= index) table.slotByIndex.resize(index + 1, -1);
+        table.slotByIndex[index] = (int)i;
+        table.byPower.push_back((int)i);
+
+        if (table.bestPower < 0 || table.pdos[i].maxPower > table.pdos[table.bestPower].maxPower) table.bestPower = (int)i;
+    }
+    std::stable_sort(table.byPower.begin(), table.byPower.end(), [&table](int a, int b) {
+        return table.pdos[a].maxPower < table.pdos[b].maxPower;
+    });
+
+    return table;
+}
+
+const Pdo* PdoTable::find(int index) const {
+    if (index < 0 || index >= (int)slotByIndex.size() || slotByIndex[index] < 0) return nullptr;
+    return &pdos[slotByIndex[index]];
+}
+
+const Pdo* PdoTable::find(std::string_view index) const {
+    size_t pos = 0;
+    int value = parseInt(index, pos);
+    return (pos == 0 || pos != index.size()) ? nullptr : this->find(value);
+}
+
+std::vector<PdoChange> PdoTable::diff(const PdoTable& newer) const {
+    std::vector<PdoChange> changes;
+    if (this->hash() == newer.hash() && this->size() == newer.size()) return changes;
+
+    int last = (int)std::max(this->slotByIndex.size(), newer.slotByIndex.size());
+    for (int index = 1; index < last; ++index) {
+        const Pdo* a = this->find(index);
+        const Pdo* b = newer.find(index);
+        if (a == nullptr && b == nullptr) continue;
+
+        if (a == nullptr) changes.push_back(PdoChange{PdoChange::Kind::Added, index, Pdo(), *b});
+        else if (b == nullptr) changes.push_back(PdoChange{PdoChange::Kind::Removed, index, *a, Pdo()});
+        else if (a->contentHash != b->contentHash) changes.push_back(PdoChange{PdoChange::Kind::Changed, index, *a, *b});
+    }
+
+    return changes;
+}
+
+const Pdo* PdoTable::bestFit(int voltage, int current) const {
+    for (int i : byPower) {
+        const Pdo& pdo = pdos[i];
+        if (voltage >= pdo.minVoltage && voltage <= pdo.maxVoltage && current <= pdo.maxCurrent) return &pdo;
+    }
+
+    return nullptr;
+}
+
+// Modify this string to add additional types
+std::vector<std::string> VariableVoltageTypes{"PD-APDO", "PD-PPS", "QC2", "QC3"};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Profile TYPE strings treated as variable voltage. Modify PdoTable.cpp to add additional types
+extern std::vector<std::string> VariableVoltageTypes;
+
+enum class PdoType { Fixed, Battery, Variable, PPS, APDO, AVS, QC2, QC3, Unknown };
+
+// One advertised profile, parsed from a "-p" line such as "INDEX:2, TYPE:PD-PPS, V:3300-21000mV, I:3000mA"
+struct Pdo {
+    int index = 0;                  // 1-based, as used by "-v"
+    PdoType type = PdoType::Unknown;
+    std::string typeName;           // TYPE field as printed by the console
+    bool isVariableVoltage = false; // TYPE is listed in VariableVoltageTypes
+    int minVoltage = 0;             // mV, equals maxVoltage for fixed profiles
+    int maxVoltage = 0;             // mV
+    int maxCurrent = 0;             // mA
+    int maxPower = 0;               // mW at maxVoltage and maxCurrent
+    std::string line;               // Raw console line, for display
+    uint64_t contentHash = 0;       // Hash of the parsed fields above, excluding the raw line
+};
+
+// Difference between two advertisements of the same DUT
+struct PdoChange {
+    enum class Kind { Added, Removed, Changed };
+
+    Kind kind;
+    int index;      // Profile index affected
+    Pdo before;     // Empty for Added
+    Pdo after;      // Empty for Removed
+};
+
+/**
+ * @brief Profiles advertised by a DUT, parsed once per "-p" response.
+ * Lookup by index is O(1). The highest power profile and a power-ordered list for best-fit queries
+ * are worked out while parsing.
+ */
+class PdoTable
+{
+public:
+    // Parse raw "-p" console output. Lines without "INDEX:" are ignored
+    static PdoTable parse(std::string_view output);
+
+    bool empty() const { return pdos.empty(); }
+    size_t size() const { return pdos.size(); }
+    const std::vector<Pdo>& entries() const { return pdos; }
+
+    // Profile with the given 1-based index, or nullptr if not advertised
+    const Pdo* find(int index) const;
+
+    // Same as find(int) for an index given as text, e.g. "2". nullptr if the text isn't a number
+    const Pdo* find(std::string_view index) const;
+
+    // Highest power profile, earliest index wins a tie. nullptr if table is empty
+    const Pdo* maxPower() const { return (bestPower < 0) ? nullptr : &pdos[bestPower]; }
+
+    // Lowest power profile that can deliver 'current' mA at 'voltage' mV, or nullptr if none can
+    const Pdo* bestFit(int voltage, int current) const;
+
+    // Hash of every profile in order. Equal hashes mean the advertisement didn't change
+    uint64_t hash() const { return contentHash; }
+
+    // Profiles added, removed or changed going from this table to 'newer', in index order
+    std::vector<PdoChange> diff(const PdoTable& newer) const;
+
+private:
+    std::vector<Pdo> pdos;          // Console order
+    std::vector<int> slotByIndex;   // Profile index -> position in pdos, -1 if missing
+    std::vector<int> byPower;       // Positions in pdos, lowest power first
+    int bestPower = -1;             // Position of highest power profile
+    uint64_t contentHash = 0;
+};
@@ -0,0 +1,374 @@
+#include "ProcessSpawn.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace Spawn {
+
+struct Watch {
+    std::function<void()> onExpiry;
+    std::atomic<bool> fired{false};
+};
+
+namespace {
+    /**
+     * One thread serves every armed Deadline, soonest first. Callbacks run under the lock, so disarming
+     * waits out a callback in progress and none can start afterwards
+     */
+    class Watchdog
+    {
+    public:
+        Watchdog() : thread(&Watchdog::loop, this) {}
+
+        ~Watchdog() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+        }
+
+        void arm(const std::chrono::steady_clock::time_point& due, const std::shared_ptr<Watch>& watch) {
+            std::lock_guard<std::mutex> guard(lock);
+            armed.emplace(due, watch);
+            wake.notify_all();
+        }
+
+        void disarm(const std::shared_ptr<Watch>& watch) {
+            std::lock_guard<std::mutex> guard(lock);
+            for (auto it = armed.begin(); it != armed.end(); ++it) {
+                if (it->second == watch) {
+                    armed.erase(it);
+                    break;
+                }
+            }
+        }
+
+    private:
+        std::mutex lock;
+        std::condition_variable wake;
+        std::multimap<std::chrono::steady_clock::time_point, std::shared_ptr<Watch>> armed;
+        bool stopping = false;
+        std::thread thread;
+
+        void loop() {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!stopping) {
+                if (armed.empty()) {
+                    wake.wait(guard);
+                    continue;
+                }
+
+                auto first = armed.begin();
+                if (first->first > std::chrono::steady_clock::now()) {
+                    wake.wait_until(guard, first->first);
+                    continue;
+                }
+
+                std::shared_ptr<Watch> watch = first->second;
+                armed.erase(first);
+                watch->fired.store(true);
+                watch->onExpiry();
+            }
+        }
+    };
+
+    Watchdog& watchdog() {
+        static Watchdog instance; // Started on first use, joined at exit
+        return instance;
+    }
+}
+
+Deadline::Deadline(const std::chrono::milliseconds& timeout, std::function<void()> onExpiry) {
+    if (timeout.count() <= 0) return;
+    watch = std::make_shared<Watch>();
+    watch->onExpiry = std::move(onExpiry);
+    watchdog().arm(std::chrono::steady_clock::now() + timeout, watch);
+}
+
+Deadline::~Deadline() {
+    if (watch) watchdog().disarm(watch);
+}
+
+bool Deadline::expired() const {
+    return watch && watch->fired.load();
+}
+
+Runner::Runner(size_t reserveBytes) {
+    buffer.resize(reserveBytes);
+}
+
+char* Runner::reserveTail(size_t chunk) {
+    if (buffer.size() - length < chunk) buffer.resize(std::max(buffer.size() * 2, length + chunk));
+    return &buffer[length];
+}
+
+void appendArgs(std::vector<std::string>& argv, std::string_view args) {
+    size_t start = 0;
+    while (start < args.size()) {
+        size_t end = args.find(' ', start);
+        if (end == std::string_view::npos) end = args.size();
+        if (end > start) argv.emplace_back(args.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+#ifdef _WIN32
+
+ProcessTree::ProcessTree() {
+    job = CreateJobObjectA(NULL, NULL);
+
+    // Nothing in the tree outlives it
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+    limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    if (job != NULL) SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+}
+
+ProcessTree::~ProcessTree() {
+    if (job != NULL) CloseHandle(job);
+}
+
+void ProcessTree::adopt(HANDLE child) {
+    process = child;
+    inJob = job != NULL && AssignProcessToJobObject(job, child);
+}
+
+void ProcessTree::kill() {
+    if (inJob) TerminateJobObject(job, 1);
+    else if (process != NULL) TerminateProcess(process, 1);
+}
+
+std::string buildCommandLine(const std::vector<std::string>& argv) {
+    std::string cmdLine;
+    for (const std::string& arg : argv) {
+        if (!cmdLine.empty()) cmdLine.push_back(' ');
+
+        // Plain arguments go through untouched
+        if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+            cmdLine += arg;
+            continue;
+        }
+
+        // Quote, doubling backslashes that precede a quote so CommandLineToArgv reads it back unchanged
+        cmdLine.push_back('"');
+        size_t backslashes = 0;
+        for (char c : arg) {
+            if (c == '\\') {
+                ++backslashes;
+                continue;
+            }
+            if (c == '"') cmdLine.append(backslashes * 2 + 1, '\\');
+            else cmdLine.append(backslashes, '\\');
+            backslashes = 0;
+            cmdLine.push_back(c);
+        }
+        cmdLine.append(backslashes * 2, '\\');
+        cmdLine.push_back('"');
+    }
+
+    return cmdLine;
+}
+
+Result Runner::run(const std::vector<std::string>& argv, const std::chrono::milliseconds& timeout, const Cancel::Token& token) {
+    if (argv.empty()) throw std::runtime_error("Empty command");
+    token.throwIfCancelled("Command cancelled.");
+
+    HANDLE hRead, hWrite;
+    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    // Create pipe for child process output
+    if (!CreatePipe(&hRead, &hWrite, &sa, 0)) throw std::runtime_error("Failed to create pipe");
+
+    // Ensure program doesn't pass read side of pipe to command
+    SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
+
+    // Redirect stdout and stderr to the same pipe, child gets no stdin
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    si.hStdOutput = hWrite;
+    si.hStdError = hWrite;
+
+    // Launch console directly, no cmd.exe in between. It starts suspended so it joins the tree before it can spawn anything
+    PROCESS_INFORMATION pi = {};
+    std::string cmdLine = buildCommandLine(argv);
+    if (!CreateProcessA(NULL, &cmdLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi)) {
+        CloseHandle(hWrite);
+        CloseHandle(hRead);
+        throw std::runtime_error("Failed to create process");
+    }
+
+    ProcessTree tree;
+    tree.adopt(pi.hProcess);
+    ResumeThread(pi.hThread);
+    CloseHandle(hWrite); // Close the write end of the pipe in the parent process
+    CloseHandle(pi.hThread);
+
+    // Killing the tree closes the pipe, which ends the read loop
+    bool timedOut;
+    {
+        Deadline deadline(timeout, [&tree]() { tree.kill(); });
+        Cancel::Registration onCancel = token.onCancel([&tree]() { tree.kill(); });
+
+        // Read straight into the reusable buffer until the child closes the pipe
+        const DWORD chunk = 4096;
+        DWORD bytesRead;
+        length = 0;
+        while (ReadFile(hRead, this->reserveTail(chunk), chunk, &bytesRead, NULL) && bytesRead > 0) {
+            length += bytesRead;
+        }
+
+        CloseHandle(hRead);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        timedOut = deadline.expired();
+    }
+
+    DWORD exitCode = 0;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    CloseHandle(pi.hProcess);
+    token.throwIfCancelled("Command cancelled.");
+    if (timedOut) throw Timeout("Command timed out after " + std::to_string(timeout.count()) + "ms");
+
+    Result result;
+    result.exitCode = (int)exitCode;
+    result.output = std::string_view(buffer.data(), length);
+    return result;
+}
+
+#else
+
+ProcessTree::ProcessTree() {}
+
+ProcessTree::~ProcessTree() {
+    this->kill(); // Stragglers the child left behind
+}
+
+void ProcessTree::adopt(pid_t pid) {
+    group = pid;
+}
+
+void ProcessTree::kill() {
+    if (group > 0) ::kill(-group, SIGKILL);
+}
+
+std::string buildCommandLine(const std::vector<std::string>& argv) {
+    std::string cmdLine;
+    for (const std::string& arg : argv) {
+        if (!cmdLine.empty()) cmdLine.push_back(' ');
+
+        // Plain arguments go through untouched
+        if (!arg.empty() && arg.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_./,=:+@%") == std::string::npos) {
+            cmdLine += arg;
+            continue;
+        }
+
+        // Single quotes keep everything literal, a quote inside closes them, adds an escaped quote and reopens
+        cmdLine.push_back('\'');
+        for (char c : arg) {
+            if (c == '\'') cmdLine += "'\\''";
+            else cmdLine.push_back(c);
+        }
+        cmdLine.push_back('\'');
+    }
+
+    return cmdLine;
+}
+
+Result Runner::run(const std::vector<std::string>& argv, const std::chrono::milliseconds& timeout, const Cancel::Token& token) {
+    if (argv.empty()) throw std::runtime_error("Empty command");
+    token.throwIfCancelled("Command cancelled.");
+
+    // Create pipe for child process output, parent end must not leak into other children
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) throw std::runtime_error("Failed to create pipe");
+
+    // Redirect stdout and stderr to the same pipe, child stdin reads /dev/null
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 2);
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const std::string& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    // Child leads its own process group, so the whole tree can be killed
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]); // Close the write end of the pipe in the parent process
+
+    if (err != 0) {
+        close(fds[0]);
+        throw std::runtime_error("Failed to create process");
+    }
+
+    ProcessTree tree;
+    tree.adopt(pid);
+
+    // Killing the tree closes the pipe, which ends the read loop
+    int status = 0;
+    bool timedOut;
+    {
+        Deadline deadline(timeout, [&tree]() { tree.kill(); });
+        Cancel::Registration onCancel = token.onCancel([&tree]() { tree.kill(); });
+
+        // Read straight into the reusable buffer until the child closes the pipe
+        const size_t chunk = 4096;
+        length = 0;
+        while (true) {
+            ssize_t n = read(fds[0], this->reserveTail(chunk), chunk);
+            if (n > 0) length += (size_t)n;
+            else if (n < 0 && errno == EINTR) continue;
+            else break;
+        }
+        close(fds[0]);
+
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        timedOut = deadline.expired();
+    }
+    token.throwIfCancelled("Command cancelled.");
+    if (timedOut) throw Timeout("Command timed out after " + std::to_string(timeout.count()) + "ms");
+
+    Result result;
+    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result.output = std::string_view(buffer.data(), length);
+    return result;
+}
+
+#endif
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CancelToken.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#endif
+
+namespace Spawn {
+    // A command ran past its deadline. Everything it started has been killed
+    struct Timeout : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * @brief A child process and everything it starts, killed as one unit.
+     * On Windows the child joins a Job Object while still suspended, so its own children are caught too. On
+     * POSIX the child leads a new process group. Closing the tree kills anything still in it.
+     */
+    class ProcessTree
+    {
+    public:
+        ProcessTree();
+        ~ProcessTree();
+
+        ProcessTree(const ProcessTree&) = delete;
+        ProcessTree& operator=(const ProcessTree&) = delete;
+
+#ifdef _WIN32
+        // Add a child created with CREATE_SUSPENDED, before resuming it. If it can't join the job only the child is killed
+        void adopt(HANDLE process);
+#else
+        // Track a child started as leader of its own process group
+        void adopt(pid_t pid);
+#endif
+
+        // Kill every process in the tree. Safe from any thread
+        void kill();
+
+    private:
+#ifdef _WIN32
+        HANDLE job;
+        HANDLE process = NULL;  // Only used if the child couldn't join the job
+        bool inJob = false;
+#else
+        pid_t group = 0;
+#endif
+    };
+
+    /**
+     * @brief Calls 'onExpiry' from a shared watchdog thread if still armed after 'timeout'. A zero timeout never fires.
+     * Once the destructor returns the callback can no longer run, so it may capture locals that outlive the Deadline.
+     */
+    class Deadline
+    {
+    public:
+        Deadline(const std::chrono::milliseconds& timeout, std::function<void()> onExpiry);
+        ~Deadline();
+
+        Deadline(const Deadline&) = delete;
+        Deadline& operator=(const Deadline&) = delete;
+
+        // True once the callback has run
+        bool expired() const;
+
+    private:
+        std::shared_ptr<struct Watch> watch;
+    };
+
+    /**
+     * @brief Outcome of one child process run.
+     * 'output' points into the Runner's buffer and stays valid until the next run() on the same Runner.
+     */
+    struct Result {
+        int exitCode = -1;
+        std::string_view output;
+    };
+
+    /**
+     * @brief Runs a program directly from an argv vector, without a shell in between.
+     * stdout and stderr share one pipe so a single reader drains both and the child can never block
+     * on a full pipe the parent isn't reading. Output lands in a buffer that is reserved once and
+     * reused across runs.
+     */
+    class Runner
+    {
+    public:
+        explicit Runner(size_t reserveBytes = 4096);
+
+        // Run argv[0] with the remaining arguments and wait for it to exit. Throws Timeout, after killing the
+        // process tree, if it runs longer than a non-zero 'timeout'. Cancelling 'token' kills the tree too and
+        // throws JobCancelled
+        Result run(const std::vector<std::string>& argv, const std::chrono::milliseconds& timeout = std::chrono::milliseconds(0),
+                   const Cancel::Token& token = Cancel::Token());
+
+    private:
+        std::string buffer; // Grows to the largest output seen, never shrinks
+        size_t length = 0;  // Bytes of buffer used by the last run
+
+        // Make room for at least one more read of 'chunk' bytes
+        char* reserveTail(size_t chunk);
+    };
+
+    // Split a console argument string on spaces, e.g. "-l 1000,200" -> {"-l", "1000,200"}
+    void appendArgs(std::vector<std::string>& argv, std::string_view args);
+
+    // Build a command line from argv, quoting where needed: a CreateProcess command line on Windows, a /bin/sh one elsewhere
+    std::string buildCommandLine(const std::vector<std::string>& argv);
+}
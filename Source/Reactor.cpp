@@ -0,0 +1,474 @@
+#include "Reactor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ProcessSpawn.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace Async {
+
+namespace {
+    thread_local Reactor* runningReactor = nullptr;
+
+    // Longest the loop blocks while it has an abort flag to watch
+    const Clock::duration ABORT_POLL = std::chrono::milliseconds(100);
+
+    Reactor& requireReactor() {
+        if (runningReactor == nullptr) throw std::runtime_error("No reactor running on this thread");
+        return *runningReactor;
+    }
+}
+
+// Top-level coroutine owned by the reactor. Starts eagerly and frees itself when done
+struct Reactor::Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/**
+ * Async::Reactor member function definitions
+ */
+Reactor* Reactor::current() { return runningReactor; }
+
+void Reactor::spawn(Task<void> task, const std::string& name) {
+    ++active;
+    this->launch(std::move(task), name);
+}
+
+Reactor::Detached Reactor::launch(Task<void> task, std::string name) {
+    co_await YieldAwaiter{*this}; // Start on the loop, not inside spawn()
+
+    JobOutcome outcome;
+    outcome.name = std::move(name);
+    Clock::time_point started = this->now();
+
+    try {
+        co_await task;
+        outcome.status = (isCancelled) ? JobOutcome::Status::Cancelled : JobOutcome::Status::Passed;
+    } catch (const JobCancelled& e) {
+        outcome.status = JobOutcome::Status::Cancelled;
+        outcome.error = e.what();
+    } catch (const std::exception& e) {
+        outcome.status = JobOutcome::Status::Failed;
+        outcome.error = e.what();
+    } catch (...) {
+        outcome.status = JobOutcome::Status::Failed;
+        outcome.error = "Unknown critical error occurred.";
+    }
+
+    outcome.elapsed = this->now() - started;
+    completed.record(std::move(outcome));
+    --active;
+}
+
+void Reactor::useVirtualClock() {
+    virtualNow = this->now();
+    virtualClock = true;
+}
+
+void Reactor::addTimer(Clock::time_point deadline, std::coroutine_handle<> h, const Cancel::Token& token) {
+    // Runs on whichever thread cancels, so it only flags the timer and wakes the loop
+    Cancel::Registration registration = token.onCancel([this]() {
+        timerCancelled.store(true);
+        this->wake();
+    });
+    timers.push_back(Timer{deadline, timerSeq++, h, token, std::move(registration)});
+    std::push_heap(timers.begin(), timers.end(), std::greater<Timer>());
+}
+
+void Reactor::fireTimers() {
+    // Sleepers whose token was cancelled wake first, wherever they are in the heap
+    if (timerCancelled.exchange(false)) {
+        auto split = std::partition(timers.begin(), timers.end(), [](const Timer& t) { return !t.token.cancelled(); });
+        for (auto it = split; it != timers.end(); ++it) ready.push_back(it->handle);
+        timers.erase(split, timers.end());
+        std::make_heap(timers.begin(), timers.end(), std::greater<Timer>());
+    }
+
+    Clock::time_point now = this->now();
+    while (!timers.empty() && timers.front().deadline <= now) {
+        std::pop_heap(timers.begin(), timers.end(), std::greater<Timer>());
+        ready.push_back(timers.back().handle);
+        timers.pop_back();
+    }
+}
+
+void Reactor::run(const std::atomic<bool>* abortFlag) {
+    Reactor* outer = runningReactor;
+    runningReactor = this;
+
+    while (active > 0) {
+        if (abortFlag != nullptr && !isCancelled && abortFlag->load(std::memory_order_relaxed)) isCancelled = true;
+        this->fireTimers();
+
+        // Resume everything that's runnable. Anything resumed here may queue more work for the next pass
+        size_t count = ready.size();
+        for (size_t i = 0; i < count; ++i) {
+            std::coroutine_handle<> h = ready.front();
+            ready.pop_front();
+            h.resume();
+        }
+        if (active == 0) break;
+
+        // Block on I/O until the next timer is due
+        Clock::duration timeout = Clock::duration::max();
+        if (!ready.empty()) timeout = Clock::duration::zero();
+        else if (virtualClock && !timers.empty()) {
+            // Virtual time only moves while nothing else can happen. Pending I/O is waited for in real time first
+            if (pendingIo == 0) {
+                virtualNow = std::max(virtualNow, timers.front().deadline);
+                timeout = Clock::duration::zero();
+            }
+        } else if (!timers.empty()) timeout = std::max(Clock::duration::zero(), timers.front().deadline - Clock::now());
+        if (abortFlag != nullptr) timeout = std::min(timeout, ABORT_POLL);
+
+        if (timeout == Clock::duration::max() && pendingIo == 0) {
+            runningReactor = outer;
+            throw std::runtime_error("Reactor stalled: coroutines are waiting on nothing");
+        }
+
+        this->waitForIo(timeout);
+    }
+
+    runningReactor = outer;
+}
+
+#ifdef _WIN32
+
+Reactor::Reactor() {
+    port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (port == NULL) throw std::runtime_error("Failed to create I/O completion port");
+}
+
+Reactor::~Reactor() {
+    CloseHandle(port);
+}
+
+void Reactor::wake() {
+    PostQueuedCompletionStatus(port, 0, 0, NULL); // Dequeued like a timeout
+}
+
+void Reactor::waitForIo(Clock::duration timeout) {
+    DWORD waitMs = INFINITE;
+    if (timeout != Clock::duration::max()) {
+        // Round up so a timer isn't polled just before it's due
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+        waitMs = (DWORD)std::min<long long>(ms, INFINITE - 1);
+    }
+
+    DWORD bytes = 0;
+    ULONG_PTR key = 0;
+    OVERLAPPED* overlapped = NULL;
+    BOOL ok = GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, waitMs);
+    if (overlapped == NULL) return; // Timed out
+
+    // Drain one completion per call, the loop comes straight back if more are queued
+    ReadAwaiter* op = reinterpret_cast<ReadAwaiter::Op*>(overlapped)->owner;
+    op->bytesRead = bytes;
+    op->closed = !ok || bytes == 0; // Broken pipe: the child closed its end
+    --pendingIo;
+    ready.push_back(op->waiter);
+}
+
+bool Reactor::ReadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    op.owner = this;
+    waiter = h;
+
+    // Completion is posted to the port even if the read finishes immediately
+    if (!ReadFile(pipe, buffer, capacity, NULL, &op.overlapped) && GetLastError() != ERROR_IO_PENDING) {
+        closed = true;
+        return false;
+    }
+
+    ++reactor.pendingIo;
+    return true;
+}
+
+Task<ProcessResult> runProcess(std::vector<std::string> argv, std::chrono::milliseconds timeout, Cancel::Token token) {
+    if (argv.empty()) throw std::runtime_error("Empty command");
+    token.throwIfCancelled("Command cancelled.");
+    Reactor& reactor = requireReactor();
+
+    // Anonymous pipes can't do overlapped I/O, so the output pipe is a uniquely named one
+    static std::atomic<unsigned long> pipeSerial{0};
+    std::string name = "\\\\.\\pipe\\passmark-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(++pipeSerial);
+
+    HANDLE hRead = CreateNamedPipeA(name.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                    PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 4096, 4096, 0, NULL);
+    if (hRead == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to create pipe");
+
+    // Child's end is inheritable, ours isn't
+    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    HANDLE hWrite = CreateFileA(name.c_str(), GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hWrite == INVALID_HANDLE_VALUE) {
+        CloseHandle(hRead);
+        throw std::runtime_error("Failed to create pipe");
+    }
+
+    if (CreateIoCompletionPort(hRead, reactor.port, 0, 0) == NULL) {
+        CloseHandle(hWrite);
+        CloseHandle(hRead);
+        throw std::runtime_error("Failed to register pipe");
+    }
+
+    // Redirect stdout and stderr to the same pipe
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    si.hStdOutput = hWrite;
+    si.hStdError = hWrite;
+
+    // Started suspended so it joins the tree before it can launch anything
+    PROCESS_INFORMATION pi = {};
+    std::string cmdLine = Spawn::buildCommandLine(argv);
+    if (!CreateProcessA(NULL, &cmdLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi)) {
+        CloseHandle(hWrite);
+        CloseHandle(hRead);
+        throw std::runtime_error("Failed to create process");
+    }
+
+    Spawn::ProcessTree tree;
+    tree.adopt(pi.hProcess);
+    ResumeThread(pi.hThread);
+    CloseHandle(hWrite); // Close the write end of the pipe in the parent process
+    CloseHandle(pi.hThread);
+
+    // The watchdog or a cancel kills the tree, which completes the pending read with a broken pipe
+    Spawn::Deadline deadline(timeout, [&tree]() { tree.kill(); });
+    Cancel::Registration onCancel = token.onCancel([&tree]() { tree.kill(); });
+
+    ProcessResult result;
+    char chunk[4096];
+    while (true) {
+        size_t n = co_await Reactor::ReadAwaiter{reactor, hRead, chunk, sizeof(chunk)};
+        if (n == 0) break;
+        result.output.append(chunk, n);
+    }
+    CloseHandle(hRead);
+
+    // Output closes as the console exits, so this is at most a short wait
+    while (WaitForSingleObject(pi.hProcess, 0) == WAIT_TIMEOUT) co_await sleepFor(std::chrono::milliseconds(1));
+
+    DWORD exitCode = 0;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    CloseHandle(pi.hProcess);
+    token.throwIfCancelled("Command cancelled.");
+    if (deadline.expired()) throw Spawn::Timeout("Command timed out after " + std::to_string(timeout.count()) + "ms");
+
+    result.exitCode = (int)exitCode;
+    co_return result;
+}
+
+#else
+
+Reactor::Reactor() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) throw std::runtime_error("Failed to create epoll instance");
+
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    if (wakeFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) != 0) {
+        if (wakeFd >= 0) close(wakeFd);
+        close(epollFd);
+        throw std::runtime_error("Failed to create reactor wake event");
+    }
+}
+
+Reactor::~Reactor() {
+    close(wakeFd);
+    close(epollFd);
+}
+
+void Reactor::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written; // Counter already non-zero means a wake is pending anyway
+}
+
+void Reactor::waitForIo(Clock::duration timeout) {
+    int waitMs = -1;
+    if (timeout != Clock::duration::max()) {
+        // Round up so a timer isn't polled just before it's due
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+        waitMs = (int)std::min<long long>(ms, 1 << 30);
+    }
+
+    epoll_event events[64];
+    int n = epoll_wait(epollFd, events, 64, waitMs);
+    for (int i = 0; i < n; ++i) {
+        if (events[i].data.ptr == nullptr) { // wake()
+            uint64_t count;
+            ssize_t drained = read(wakeFd, &count, sizeof(count));
+            (void)drained;
+            continue;
+        }
+
+        ReadAwaiter* op = static_cast<ReadAwaiter*>(events[i].data.ptr);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, op->pipe, NULL);
+        --pendingIo;
+        ready.push_back(op->waiter);
+    }
+}
+
+bool Reactor::ReadAwaiter::await_ready() {
+    // Try the read first, only wait on the pipe if it's empty
+    while (true) {
+        ssize_t n = read(pipe, buffer, capacity);
+        if (n >= 0) {
+            bytesRead = n;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+
+        bytesRead = 0; // Treat errors as end of output
+        return true;
+    }
+}
+
+void Reactor::ReadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    waiter = h;
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN; // Hang-up is always reported too
+    ev.data.ptr = this;
+    if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, pipe, &ev) != 0) {
+        bytesRead = 0;
+        reactor.ready.push_back(h);
+        return;
+    }
+    ++reactor.pendingIo;
+}
+
+size_t Reactor::ReadAwaiter::await_resume() {
+    if (bytesRead >= 0) return (size_t)bytesRead;
+
+    // Woken by epoll, the pipe is readable now
+    while (true) {
+        ssize_t n = read(pipe, buffer, capacity);
+        if (n >= 0) return (size_t)n;
+        if (errno != EINTR) return 0;
+    }
+}
+
+Task<ProcessResult> runProcess(std::vector<std::string> argv, std::chrono::milliseconds timeout, Cancel::Token token) {
+    if (argv.empty()) throw std::runtime_error("Empty command");
+    token.throwIfCancelled("Command cancelled.");
+    Reactor& reactor = requireReactor();
+
+    // Create pipe for child process output. Only our end is non-blocking
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) throw std::runtime_error("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    // Redirect stdout and stderr to the same pipe, child stdin reads /dev/null
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 2);
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const std::string& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    // Child leads its own process group, so the whole tree can be killed
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]); // Close the write end of the pipe in the parent process
+
+    if (err != 0) {
+        close(fds[0]);
+        throw std::runtime_error("Failed to create process");
+    }
+
+    // The watchdog or a cancel kills the tree, which closes the pipe and ends the read loop
+    Spawn::ProcessTree tree;
+    tree.adopt(pid);
+    Spawn::Deadline deadline(timeout, [&tree]() { tree.kill(); });
+    Cancel::Registration onCancel = token.onCancel([&tree]() { tree.kill(); });
+
+    ProcessResult result;
+    char chunk[4096];
+    while (true) {
+        size_t n = co_await Reactor::ReadAwaiter{reactor, fds[0], chunk, sizeof(chunk)};
+        if (n == 0) break;
+        result.output.append(chunk, n);
+    }
+    close(fds[0]);
+
+    // Output closes as the console exits, so this is at most a short wait
+    int status = 0;
+    while (true) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid || (done < 0 && errno != EINTR)) break;
+        if (done == 0) co_await sleepFor(std::chrono::milliseconds(1));
+    }
+
+    token.throwIfCancelled("Command cancelled.");
+    if (deadline.expired()) throw Spawn::Timeout("Command timed out after " + std::to_string(timeout.count()) + "ms");
+    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    co_return result;
+}
+
+#endif
+
+Reactor::TimerAwaiter sleepFor(Clock::duration duration, Cancel::Token token) {
+    Reactor& reactor = requireReactor();
+    return Reactor::TimerAwaiter{reactor, reactor.now() + duration, std::move(token)};
+}
+
+Reactor::TimerAwaiter sleepUntil(Clock::time_point deadline, Cancel::Token token) {
+    return Reactor::TimerAwaiter{requireReactor(), deadline, std::move(token)};
+}
+
+Reactor::YieldAwaiter yield() {
+    return Reactor::YieldAwaiter{requireReactor()};
+}
+
+Clock::time_point now() {
+    return (runningReactor != nullptr) ? runningReactor->now() : Clock::now();
+}
+
+bool cancelled() {
+    return runningReactor != nullptr && runningReactor->cancelled();
+}
+
+}
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include "CancelToken.hpp"
+#include "Completion.hpp"
+
+/**
+ * @brief Single-threaded event loop for coroutine tester workflows.
+ * Console processes are spawned with their output pipe registered on the loop (an I/O completion port
+ * on Windows, epoll on Linux), so while one tester waits on its console or a timer the thread moves
+ * on to the next. One Reactor drives any number of tester coroutines on one core.
+ *
+ *     Async::Task<void> poll(AsyncTester t) {
+ *         tester::status s = co_await t.getStatus();
+ *         co_await Async::sleepFor(std::chrono::milliseconds(100));
+ *     }
+ */
+namespace Async {
+    using Clock = std::chrono::steady_clock;
+
+    template<typename T> class Task;
+
+    namespace detail {
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            // Tasks are lazy, they start when first awaited
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            // Hand control straight back to whoever awaited us
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                    std::coroutine_handle<> next = h.promise().continuation;
+                    return (next) ? next : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        template<typename T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object();
+            void return_value(T v) { value = std::move(v); }
+        };
+
+        template<>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object();
+            void return_void() {}
+        };
+    }
+
+    // Coroutine returning T. Awaiting it runs it to completion and rethrows anything it threw
+    template<typename T>
+    class Task
+    {
+    public:
+        using promise_type = detail::Promise<T>;
+
+        explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        ~Task() { if (handle) handle.destroy(); }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        bool await_ready() const noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+            handle.promise().continuation = caller;
+            return handle;
+        }
+
+        T await_resume() {
+            if (handle.promise().error) std::rethrow_exception(handle.promise().error);
+            if constexpr (!std::is_void_v<T>) return std::move(*handle.promise().value);
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    namespace detail {
+        template<typename T>
+        Task<T> Promise<T>::get_return_object() {
+            return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object() {
+            return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+    }
+
+    namespace detail {
+        // Task that starts running on construction, so it makes progress while its owner awaits something else.
+        // Must be awaited before it's destroyed
+        template<typename T>
+        class Started
+        {
+        public:
+            explicit Started(Task<T> t) : task(std::move(t)) { drive(this); }
+
+            Started(const Started&) = delete;
+            Started& operator=(const Started&) = delete;
+
+            bool await_ready() const noexcept { return done; }
+            void await_suspend(std::coroutine_handle<> h) noexcept { waiter = h; }
+            T await_resume() { return task.await_resume(); }
+
+        private:
+            // Frees itself once the task is done
+            struct Driver {
+                struct promise_type {
+                    Driver get_return_object() { return {}; }
+                    std::suspend_never initial_suspend() noexcept { return {}; }
+                    std::suspend_never final_suspend() noexcept { return {}; }
+                    void return_void() {}
+                    void unhandled_exception() { std::terminate(); }
+                };
+            };
+
+            // Runs the task without taking its result, that's left for await_resume()
+            struct Run {
+                Task<T>& task;
+
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept { return task.await_suspend(h); }
+                void await_resume() const noexcept {}
+            };
+
+            Task<T> task;
+            bool done = false;
+            std::coroutine_handle<> waiter = nullptr;
+
+            static Driver drive(Started* self) {
+                co_await Run{self->task};
+                self->done = true;
+                if (self->waiter) self->waiter.resume(); // May destroy 'self'
+            }
+        };
+    }
+
+    // Run two tasks side by side on the current reactor and return both results once both have finished. If either
+    // throws, the first exception is rethrown after the other has finished too
+    template<typename A, typename B>
+    Task<std::pair<A, B>> all(Task<A> first, Task<B> second) {
+        detail::Started<B> other(std::move(second));
+        std::exception_ptr error;
+
+        std::optional<A> a;
+        try {
+            a = co_await first;
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::optional<B> b;
+        try {
+            b = co_await other;
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+
+        if (error) std::rethrow_exception(error);
+        co_return std::pair<A, B>(std::move(*a), std::move(*b));
+    }
+
+    // Output and exit code of a console process
+    struct ProcessResult {
+        int exitCode = 0;
+        std::string output;
+    };
+
+    class Reactor
+    {
+    public:
+        Reactor();
+        ~Reactor();
+
+        Reactor(const Reactor&) = delete;
+        Reactor& operator=(const Reactor&) = delete;
+
+        // Queue a top-level coroutine. It starts once run() is called. 'name' labels its outcome
+        void spawn(Task<void> task, const std::string& name = "");
+
+        // Run until every spawned coroutine has finished. Once *abortFlag goes true the reactor is
+        // cancelled, see cancelled(). Sleeps only end early if their own token is cancelled, so work
+        // under an uncancellable token, such as a safety unload, keeps its timing after an abort
+        void run(const std::atomic<bool>* abortFlag = nullptr);
+
+        bool cancelled() const { return isCancelled; }
+
+        // Run on a virtual clock that starts at the current time. Whenever nothing is runnable and no I/O is pending,
+        // the clock jumps straight to the next timer, so a replay whose every wait is a sleep takes no real time
+        void useVirtualClock();
+
+        // Time on this reactor's clock, see useVirtualClock()
+        Clock::time_point now() const { return (virtualClock) ? virtualNow : Clock::now(); }
+
+        // Make run() check its abort flag now instead of at the next poll. Safe from any thread, e.g. a Ctrl+C handler
+        void wake();
+
+        // Number of top-level coroutines that ended with an exception
+        size_t failures() const { return completed.failures(); }
+
+        // Per-coroutine outcomes, reported as each one finishes
+        CompletionLog& completions() { return completed; }
+
+        // Reactor running on this thread, NULL outside run()
+        static Reactor* current();
+
+#ifdef _WIN32
+        // Port that ReadAwaiter completions are posted to. A pipe read through ReadAwaiter must be bound to it
+        HANDLE completionPort() const { return port; }
+#endif
+
+        // Awaitable that resumes the caller at 'deadline', or as soon as 'token' is cancelled
+        struct TimerAwaiter {
+            Reactor& reactor;
+            Clock::time_point deadline;
+            Cancel::Token token;
+
+            bool await_ready() const { return token.cancelled() || deadline <= reactor.now(); }
+            void await_suspend(std::coroutine_handle<> h) { reactor.addTimer(deadline, h, token); }
+            void await_resume() const {}
+        };
+
+        // Awaitable that resumes the caller on the next pass of the loop
+        struct YieldAwaiter {
+            Reactor& reactor;
+
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) { reactor.ready.push_back(h); }
+            void await_resume() const {}
+        };
+
+        // Awaitable that resumes the caller once 'pipe' has data or is closed. The pipe comes from runProcess()
+#ifdef _WIN32
+        struct ReadAwaiter {
+            // The completion port hands back the OVERLAPPED address, which leads back to the awaiter
+            struct Op {
+                OVERLAPPED overlapped;
+                ReadAwaiter* owner;
+            };
+
+            Reactor& reactor;
+            HANDLE pipe;
+            char* buffer;
+            DWORD capacity;
+            Op op = {};
+            DWORD bytesRead = 0;
+            bool closed = false;
+            std::coroutine_handle<> waiter = nullptr;
+
+            bool await_ready() const { return false; }
+            bool await_suspend(std::coroutine_handle<> h);
+            size_t await_resume() const { return (closed) ? 0 : bytesRead; }
+        };
+#else
+        struct ReadAwaiter {
+            Reactor& reactor;
+            int pipe;
+            char* buffer;
+            size_t capacity;
+            long bytesRead = -1; // -1 until the read has been done
+            std::coroutine_handle<> waiter = nullptr;
+
+            bool await_ready();
+            void await_suspend(std::coroutine_handle<> h);
+            size_t await_resume();
+        };
+#endif
+
+    private:
+        friend Task<ProcessResult> runProcess(std::vector<std::string> argv, std::chrono::milliseconds timeout, Cancel::Token token);
+
+        struct Timer {
+            Clock::time_point deadline;
+            unsigned long long seq;
+            std::coroutine_handle<> handle;
+            Cancel::Token token;
+            Cancel::Registration onCancel;  // Flags the reactor to release this timer early
+
+            bool operator>(const Timer& other) const {
+                return (deadline != other.deadline) ? deadline > other.deadline : seq > other.seq;
+            }
+        };
+
+        struct Detached;
+
+        std::deque<std::coroutine_handle<>> ready;
+        std::vector<Timer> timers; // Min-heap
+        unsigned long long timerSeq = 0;
+        size_t active = 0;
+        CompletionLog completed;
+        size_t pendingIo = 0;
+        bool isCancelled = false;
+        std::atomic<bool> timerCancelled{false}; // Some sleeper's token was cancelled, from any thread
+        bool virtualClock = false;
+        Clock::time_point virtualNow;
+
+#ifdef _WIN32
+        HANDLE port;
+#else
+        int epollFd;
+        int wakeFd;     // eventfd written by wake(), registered with a null pointer
+#endif
+
+        Detached launch(Task<void> task, std::string name);
+        void addTimer(Clock::time_point deadline, std::coroutine_handle<> h, const Cancel::Token& token);
+        void fireTimers();
+        void waitForIo(Clock::duration timeout);
+    };
+
+    // Suspend the calling coroutine for 'duration' on the current reactor. Cancelling 'token' ends the sleep early
+    Reactor::TimerAwaiter sleepFor(Clock::duration duration, Cancel::Token token = Cancel::Token());
+
+    // Suspend the calling coroutine until 'deadline' on the current reactor. Cancelling 'token' ends the sleep early
+    Reactor::TimerAwaiter sleepUntil(Clock::time_point deadline, Cancel::Token token = Cancel::Token());
+
+    // Let other coroutines on the current reactor run
+    Reactor::YieldAwaiter yield();
+
+    // Time on the current reactor's clock, the steady clock outside run()
+    Clock::time_point now();
+
+    // True once the current reactor has been cancelled
+    bool cancelled();
+
+    // Launch argv[0] with stdout and stderr on one pipe and collect its output without blocking the reactor. Past a
+    // non-zero 'timeout' the process tree is killed and Spawn::Timeout is thrown. Cancelling 'token' kills it at
+    // once, from whichever thread cancels, and throws JobCancelled
+    Task<ProcessResult> runProcess(std::vector<std::string> argv, std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+                                   Cancel::Token token = Cancel::Token());
+}
@@ -0,0 +1,88 @@
+#include "SampleRing.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * SampleSummary member function definitions
+ */
+void SampleSummary::add(const Telemetry& sample) {
+    if (count == 0) {
+        min = max = sample;
+    } else {
+        min.sinkVoltage = std::min(min.sinkVoltage, sample.sinkVoltage);
+        min.sinkSetCurrent = std::min(min.sinkSetCurrent, sample.sinkSetCurrent);
+        min.sinkMeasCurrent = std::min(min.sinkMeasCurrent, sample.sinkMeasCurrent);
+        max.sinkVoltage = std::max(max.sinkVoltage, sample.sinkVoltage);
+        max.sinkSetCurrent = std::max(max.sinkSetCurrent, sample.sinkSetCurrent);
+        max.sinkMeasCurrent = std::max(max.sinkMeasCurrent, sample.sinkMeasCurrent);
+        min.timestamp = max.timestamp = sample.timestamp;
+    }
+
+    sumVoltage += sample.sinkVoltage;
+    sumSetCurrent += sample.sinkSetCurrent;
+    sumMeasCurrent += sample.sinkMeasCurrent;
+    ++count;
+}
+
+Telemetry SampleSummary::mean() const {
+    Telemetry avg;
+    if (count == 0) return avg;
+
+    avg.sinkVoltage = (int)(sumVoltage / (long long)count);
+    avg.sinkSetCurrent = (int)(sumSetCurrent / (long long)count);
+    avg.sinkMeasCurrent = (int)(sumMeasCurrent / (long long)count);
+    avg.timestamp = max.timestamp;
+    avg.valid = Telemetry::VALID_ALL;
+    return avg;
+}
+
+/**
+ * SampleRing member function definitions
+ */
+SampleRing::SampleRing(const size_t& preSamples, const size_t& postSamples) : ring(preSamples + 1), post(std::max<size_t>(postSamples, 1)) {
+    window.reserve(ring.size() + post);
+}
+
+bool SampleRing::push(const Telemetry& sample) {
+    current.add(sample);
+
+    bool completed = false;
+    if (postRemaining > 0) {
+        window.push_back(sample);
+        completed = (--postRemaining == 0);
+        windowDone = completed;
+    }
+
+    ring[next] = sample;
+    next = (next + 1) % ring.size();
+    filled = std::min(filled + 1, ring.size());
+
+    return completed;
+}
+
+void SampleRing::trigger() {
+    if (postRemaining > 0 || filled == 0) return;
+
+    // Ring holds the pre-trigger samples and, newest, the trigger itself
+    window.clear();
+    size_t oldest = (next + ring.size() - filled) % ring.size();
+    for (size_t i = 0; i < filled; ++i) window.push_back(ring[(oldest + i) % ring.size()]);
+    windowTrigger = filled - 1;
+
+    postRemaining = post;
+}
+
+std::vector<Telemetry> SampleRing::takeWindow(size_t& triggerIndex) {
+    if (!windowDone) return {};
+
+    triggerIndex = windowTrigger;
+    windowDone = false;
+    return std::exchange(window, {});
+}
+
+SampleSummary SampleRing::takeInterval() {
+    return std::exchange(current, SampleSummary());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Telemetry.hpp"
+
+// Min/max/mean of the samples in one reporting interval
+struct SampleSummary {
+    size_t count = 0;
+    Telemetry min, max;
+    long long sumVoltage = 0, sumSetCurrent = 0, sumMeasCurrent = 0;
+
+    void add(const Telemetry& sample);
+    void reset() { *this = SampleSummary(); }
+
+    // Mean of every field, stamped with the last sample's time
+    Telemetry mean() const;
+};
+
+/**
+ * @brief Raw status samples for one tester at full sampling rate.
+ * Keeps the last 'preSamples' samples in a ring and the current interval as a running summary, so
+ * memory stays fixed however fast the tester is sampled. trigger() opens a window holding the ring
+ * contents, the triggering sample and the next 'postSamples' (at least 1) samples.
+ */
+class SampleRing
+{
+public:
+    SampleRing(const size_t& preSamples, const size_t& postSamples);
+
+    // Add a sample. Returns true when this sample completes an open trigger window
+    bool push(const Telemetry& sample);
+
+    // Open a window around the latest sample. Ignored while a window is already open
+    void trigger();
+
+    bool windowOpen() const { return postRemaining > 0; }
+
+    // Take a completed window. 'triggerIndex' is set to the triggering sample's position in it
+    std::vector<Telemetry> takeWindow(size_t& triggerIndex);
+
+    const SampleSummary& interval() const { return current; }
+
+    // Summary of the interval so far, and start a new one
+    SampleSummary takeInterval();
+
+private:
+    std::vector<Telemetry> ring;    // Latest samples, the oldest at 'next' once full
+    size_t next = 0;
+    size_t filled = 0;
+    size_t post;
+
+    std::vector<Telemetry> window;
+    size_t windowTrigger = 0;
+    size_t postRemaining = 0;
+    bool windowDone = false;
+
+    SampleSummary current;
+};
@@ -0,0 +1,256 @@
+#include "Scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Sched {
+
+bool TaskContext::cancelled() const {
+    return owner != nullptr && owner->cancelled();
+}
+
+/**
+ * Sched::Scheduler member function definitions
+ */
+Scheduler::Scheduler(size_t workerTotal) {
+    if (workerTotal == 0) workerTotal = std::max(2u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < workerTotal; ++i) workers.emplace_back(new Worker());
+    for (size_t i = 0; i < workerTotal; ++i) threads.emplace_back(&Scheduler::workerLoop, this, i);
+}
+
+Scheduler::~Scheduler() {
+    stopping.store(true);
+    this->notify(true);
+    for (std::thread& t : threads) t.join();
+
+    // Drop anything left behind by a group that wasn't joined
+    for (auto& w : workers) for (Task* t : w->tasks) delete t;
+    for (Task* t : inject) delete t;
+    for (Timer& t : timers) delete t.task;
+}
+
+SchedulerStats Scheduler::stats() const {
+    SchedulerStats s;
+    s.steps = stepsRun.load();
+    s.steals = stealCount.load();
+    s.sleeps = sleepCount.load();
+    return s;
+}
+
+void Scheduler::submit(Task* task) {
+    {
+        std::lock_guard<std::mutex> guard(injectLock);
+        inject.push_back(task);
+    }
+    runnable.fetch_add(1);
+    this->notify(false);
+}
+
+void Scheduler::notify(const bool& all) {
+    // Taking idleLock orders this with a worker's check-then-wait, so the wake-up can't be missed
+    std::lock_guard<std::mutex> guard(idleLock);
+    if (all) idleCv.notify_all();
+    else idleCv.notify_one();
+}
+
+void Scheduler::workerLoop(size_t index) {
+    while (true) {
+        Task* task = this->findWork(index);
+        if (task != nullptr) {
+            this->runStep(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(idleLock);
+        if (stopping.load()) break;
+        if (runnable.load() > 0) continue;
+
+        Clock::time_point deadline = this->nextDeadline();
+        if (deadline == Clock::time_point::max()) idleCv.wait(guard);
+        else if (deadline > Clock::now()) idleCv.wait_until(guard, deadline);
+    }
+}
+
+Scheduler::Task* Scheduler::findWork(size_t index) {
+    this->releaseDueTimers(index);
+
+    // Own deque first, newest job is the one most likely still in cache
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            Task* task = own.tasks.back();
+            own.tasks.pop_back();
+            runnable.fetch_sub(1);
+            return task;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(injectLock);
+        if (!inject.empty()) {
+            Task* task = inject.front();
+            inject.pop_front();
+            runnable.fetch_sub(1);
+            return task;
+        }
+    }
+
+    // Steal the oldest job from another worker, starting after ourselves so thieves spread out
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker& victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            Task* task = victim.tasks.front();
+            victim.tasks.pop_front();
+            runnable.fetch_sub(1);
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void Scheduler::runStep(Task* task) {
+    TaskContext ctx;
+    ctx.owner = task->group;
+
+    Step step;
+    try {
+        step = task->fn(ctx);
+    } catch (const JobCancelled& e) {
+        task->error = e.what();
+        task->cancelled = true;
+    } catch (const std::exception& e) {
+        task->error = e.what();
+        task->failed = true;
+    } catch (...) {
+        task->error = "Unknown critical error occurred.";
+        task->failed = true;
+    }
+    stepsRun.fetch_add(1, std::memory_order_relaxed);
+
+    // A cancelled job doesn't get to sleep unless it asked to keep the sleep, run it again so it can wind down
+    if (step.kind == Step::Kind::Sleep && ((task->group->cancelled() && !step.keep) || step.delay <= Clock::duration::zero())) {
+        step.kind = Step::Kind::Yield;
+    }
+
+    switch (step.kind) {
+    case Step::Kind::Done: {
+        JobOutcome outcome;
+        outcome.name = std::move(task->name);
+        outcome.error = std::move(task->error);
+        outcome.elapsed = Clock::now() - task->started;
+        outcome.status = (task->failed) ? JobOutcome::Status::Failed :
+                         (task->cancelled || task->group->cancelled()) ? JobOutcome::Status::Cancelled : JobOutcome::Status::Passed;
+
+        TaskGroup* group = task->group;
+        delete task;
+        group->finish(std::move(outcome));
+        break;
+    }
+    case Step::Kind::Yield:
+        // Back of the shared queue so every other runnable job goes first
+        this->submit(task);
+        break;
+    case Step::Kind::Sleep: {
+        std::lock_guard<std::mutex> guard(timerLock);
+        timers.push_back(Timer{Clock::now() + step.delay, timerSeq++, task, step.keep});
+        std::push_heap(timers.begin(), timers.end(), std::greater<Timer>());
+        sleepCount.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    }
+}
+
+void Scheduler::releaseDueTimers(size_t index) {
+    size_t released = 0;
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> timerGuard(timerLock);
+    if (timers.empty() || timers.front().wake > now) return;
+
+    Worker& own = *workers[index];
+    std::lock_guard<std::mutex> ownGuard(own.lock);
+    while (!timers.empty() && timers.front().wake <= now) {
+        std::pop_heap(timers.begin(), timers.end(), std::greater<Timer>());
+        own.tasks.push_front(timers.back().task); // Front, so idle workers can steal them
+        timers.pop_back();
+        ++released;
+    }
+    runnable.fetch_add(released);
+
+    // More than one job woke, let the other workers share them
+    if (released > 1) idleCv.notify_all();
+}
+
+Clock::time_point Scheduler::nextDeadline() {
+    std::lock_guard<std::mutex> guard(timerLock);
+    return (timers.empty()) ? Clock::time_point::max() : timers.front().wake;
+}
+
+void Scheduler::wakeGroup(const TaskGroup* group) {
+    {
+        std::lock_guard<std::mutex> guard(timerLock);
+        Clock::time_point now = Clock::now();
+        for (Timer& t : timers) {
+            if (t.task->group == group && !t.keep) t.wake = now;
+        }
+        std::make_heap(timers.begin(), timers.end(), std::greater<Timer>());
+    }
+    this->notify(true);
+}
+
+/**
+ * Sched::TaskGroup member function definitions
+ */
+TaskGroup::TaskGroup(Scheduler& scheduler) : scheduler(scheduler) {}
+
+TaskGroup::~TaskGroup() {
+    bool running;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = active > 0;
+    }
+    if (running) this->cancel();
+    this->wait();
+}
+
+void TaskGroup::spawn(StepFn step, const std::string& name) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ++active;
+    }
+    scheduler.submit(new Scheduler::Task{std::move(step), this, name, Clock::now(), ""});
+}
+
+void TaskGroup::wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]() { return active == 0; });
+}
+
+bool TaskGroup::waitFor(Clock::duration timeout) {
+    std::unique_lock<std::mutex> guard(lock);
+    return finished.wait_for(guard, timeout, [this]() { return active == 0; });
+}
+
+void TaskGroup::cancel() {
+    cancelFlag.store(true);
+    scheduler.wakeGroup(this);
+}
+
+void TaskGroup::finish(JobOutcome outcome) {
+    completed.record(std::move(outcome)); // Report before the join can return
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (--active == 0) finished.notify_all();
+}
+
+}
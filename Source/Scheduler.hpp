@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "Completion.hpp"
+
+/**
+ * @brief Work-stealing scheduler for tester jobs.
+ * A job is a step function the scheduler calls repeatedly until it reports Done. Between steps a job
+ * can yield or sleep, which hands its worker thread to another job instead of blocking it, so a small
+ * pool drives any number of testers. Each worker keeps its own deque and idle workers steal from the
+ * others. Jobs are started and joined through a TaskGroup.
+ */
+namespace Sched {
+    using Clock = std::chrono::steady_clock;
+
+    // What a job wants after the step it just ran
+    struct Step {
+        enum class Kind { Done, Yield, Sleep };
+
+        Kind kind = Kind::Done;
+        Clock::duration delay = Clock::duration::zero();
+        bool keep = false; // Sleep even if the group is cancelled
+
+        static Step done() { return Step(); }
+        static Step yield() { return Step{Kind::Yield}; }
+        static Step sleep(Clock::duration delay) { return Step{Kind::Sleep, delay}; }
+
+        // As sleep(), but kept after the group is cancelled, e.g. between the samples of a safety unload
+        static Step sleepThrough(Clock::duration delay) { return Step{Kind::Sleep, delay, true}; }
+    };
+
+    class TaskGroup;
+
+    // Passed to every step
+    class TaskContext {
+    public:
+        // True once the job's group is cancelled. A cancelled job is still stepped so it can clean up
+        bool cancelled() const;
+
+    private:
+        friend class Scheduler;
+        TaskGroup* owner = nullptr;
+    };
+
+    using StepFn = std::function<Step(TaskContext&)>;
+
+    struct SchedulerStats {
+        unsigned long long steps = 0;   // Steps run
+        unsigned long long steals = 0;  // Jobs taken from another worker's deque
+        unsigned long long sleeps = 0;  // Steps that ended in a sleep
+    };
+
+    class Scheduler
+    {
+    public:
+        // Start 'workers' threads, 0 picks one per hardware thread with a minimum of 2
+        explicit Scheduler(size_t workers = 0);
+
+        // Stop workers. Groups must be joined first, unfinished jobs are dropped
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        size_t workerCount() const { return threads.size(); }
+
+        SchedulerStats stats() const;
+
+    private:
+        friend class TaskGroup;
+
+        struct Task {
+            StepFn fn;
+            TaskGroup* group;
+            std::string name;
+            Clock::time_point started;
+            std::string error;  // Set if a step threw
+            bool failed = false;
+            bool cancelled = false; // Set if a step threw JobCancelled
+        };
+
+        struct Timer {
+            Clock::time_point wake;
+            unsigned long long seq; // Keeps equal deadlines in FIFO order
+            Task* task;
+            bool keep;              // Not woken by cancelling the group
+
+            bool operator>(const Timer& other) const {
+                return (wake != other.wake) ? wake > other.wake : seq > other.seq;
+            }
+        };
+
+        // Owner pushes and pops at the back, thieves take from the front
+        struct Worker {
+            std::mutex lock;
+            std::deque<Task*> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::mutex injectLock;
+        std::deque<Task*> inject;       // Jobs submitted from outside or yielded
+
+        std::mutex timerLock;
+        std::vector<Timer> timers;      // Min-heap of sleeping jobs
+        unsigned long long timerSeq = 0;
+
+        std::mutex idleLock;
+        std::condition_variable idleCv;
+        std::atomic<size_t> runnable{0}; // Jobs queued and not yet taken
+        std::atomic<bool> stopping{false};
+
+        std::atomic<unsigned long long> stepsRun{0}, stealCount{0}, sleepCount{0};
+
+        void submit(Task* task);
+        void notify(const bool& all);
+        void workerLoop(size_t index);
+        Task* findWork(size_t index);
+        void runStep(Task* task);
+        void releaseDueTimers(size_t index);
+        Clock::time_point nextDeadline();
+        void wakeGroup(const TaskGroup* group);
+    };
+
+    /**
+     * @brief Structured join over a set of jobs.
+     * The group outlives every job spawned into it: wait() returns once all have finished, and the
+     * destructor cancels and joins whatever is still running. Don't wait on a group from inside a job.
+     */
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(Scheduler& scheduler);
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // Queue a job, its first step runs as soon as a worker is free. 'name' labels its outcome
+        void spawn(StepFn step, const std::string& name = "");
+
+        // Block until every job has finished
+        void wait();
+
+        // As wait(), giving up after 'timeout'. Returns true if every job has finished
+        bool waitFor(Clock::duration timeout);
+
+        // Ask every job to stop. Sleeping jobs are woken so they see the request immediately
+        void cancel();
+
+        bool cancelled() const { return cancelFlag.load(std::memory_order_relaxed); }
+
+        // Number of jobs that ended with an exception
+        size_t failures() const { return completed.failures(); }
+
+        // Per-job outcomes, reported as each job finishes
+        CompletionLog& completions() { return completed; }
+
+    private:
+        friend class Scheduler;
+
+        Scheduler& scheduler;
+        std::atomic<bool> cancelFlag{false};
+        CompletionLog completed;
+
+        std::mutex lock;
+        std::condition_variable finished;
+        size_t active = 0;
+
+        void finish(JobOutcome outcome);
+    };
+}
@@ -0,0 +1,64 @@
+#include "Telemetry.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+namespace {
+    struct Field {
+        std::string_view label;     // Text directly before the ':'
+        int Telemetry::* member;
+        unsigned char flag;
+    };
+
+    const Field PM240Fields[] = {
+        {"SINK VOLTAGE", &Telemetry::sinkVoltage, Telemetry::VALID_VOLTAGE},
+        {"SINK SET CURRENT", &Telemetry::sinkSetCurrent, Telemetry::VALID_SET_CURRENT},
+        {"SINK MEASURED CURRENT", &Telemetry::sinkMeasCurrent, Telemetry::VALID_MEAS_CURRENT},
+    };
+
+    const Field PM125Fields[] = {
+        {"VOLTAGE", &Telemetry::sinkVoltage, Telemetry::VALID_VOLTAGE},
+        {"SET CURRENT", &Telemetry::sinkSetCurrent, Telemetry::VALID_SET_CURRENT},
+        {"MEASURED CURRENT", &Telemetry::sinkMeasCurrent, Telemetry::VALID_MEAS_CURRENT},
+    };
+}
+
+bool scanStatus(std::string_view output, const bool& isPM240, Telemetry& sample) {
+    const Field* fields = (isPM240) ? PM240Fields : PM125Fields;
+
+    sample = Telemetry();
+    sample.timestamp = std::chrono::steady_clock::now();
+
+    const char* begin = output.data();
+    const char* end = begin + output.size();
+    const char* colon = begin;
+
+    // Visit each ':' once and check whether the text before it ends with one of the labels still missing
+    while (sample.valid != Telemetry::VALID_ALL &&
+           (colon = static_cast<const char*>(memchr(colon, ':', end - colon))) != nullptr) {
+        size_t before = colon - begin;
+
+        for (int i = 0; i < 3; ++i) {
+            const Field& field = fields[i];
+            if ((sample.valid & field.flag) || field.label.size() > before) continue;
+            if (memcmp(colon - field.label.size(), field.label.data(), field.label.size()) != 0) continue;
+
+            // Digits follow the label, allow for padding after the ':'
+            const char* p = colon + 1;
+            while (p < end && *p == ' ') ++p;
+            if (p == end || *p < '0' || *p > '9') break;
+
+            int value = 0;
+            while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+
+            sample.*field.member = value;
+            sample.valid |= field.flag;
+            break;
+        }
+
+        ++colon;
+    }
+
+    return sample.isValid();
+}
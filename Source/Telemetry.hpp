@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+/**
+ * @brief One status sample from a tester, in integer units.
+ * Fields the console didn't report are left at 0 with their valid bit clear.
+ */
+struct Telemetry {
+    enum : unsigned char {
+        VALID_VOLTAGE = 1,
+        VALID_SET_CURRENT = 2,
+        VALID_MEAS_CURRENT = 4,
+        VALID_ALL = VALID_VOLTAGE | VALID_SET_CURRENT | VALID_MEAS_CURRENT
+    };
+
+    int sinkVoltage = 0;        // mV
+    int sinkSetCurrent = 0;     // mA
+    int sinkMeasCurrent = 0;    // mA
+    std::chrono::steady_clock::time_point timestamp; // When the console output was parsed
+    unsigned char valid = 0;    // VALID_* bits
+
+    bool isValid() const { return valid == VALID_ALL; }
+};
+
+// Fill 'sample' from raw "-s" console output in one pass, without allocating. PM240 reports
+// "SINK VOLTAGE:", "SINK SET CURRENT:" and "SINK MEASURED CURRENT:", PM125 drops the "SINK " prefix.
+// The first occurrence of each label wins. Returns true if every field was found
+bool scanStatus(std::string_view output, const bool& isPM240, Telemetry& sample);
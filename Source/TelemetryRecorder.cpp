@@ -0,0 +1,330 @@
+#include "TelemetryRecorder.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[8] = {'P', 'M', 'T', 'L', 'M', '0', '1', '\0'};
+    const uint32_t VERSION = 1;
+    const size_t FILE_HEADER_SIZE = 32;
+    const size_t BLOCK_HEADER_SIZE = 16;
+    const uint32_t KIND_ROWS = 0;
+    const uint32_t KIND_TESTER = 1;
+
+    // Bytes per row across all columns
+    const size_t ROW_BYTES = 8 + 5 * 4 + 2 + 1 + 1;
+
+    size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+    // Multi-byte fields are written in host order, every supported target is little-endian
+    template<typename T>
+    void append(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void appendColumn(std::string& out, const std::vector<T>& column) {
+        out.append(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+    }
+
+    template<typename T>
+    T load(const char* p) {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+}
+
+const char* TelemetryFile::eventStr(const uint8_t& event) {
+    const char* names[] = {"SAMPLE", "START", "STOP", "ABORT", "DROP", "RECONNECT", "PROFILE_CHANGE",
+                           "INTERVAL_MIN", "INTERVAL_MAX", "INTERVAL_MEAN", "WINDOW",
+                           "FOLDBACK", "DROOP", "OVERVOLTAGE", "OSCILLATION"};
+    return (event < sizeof(names) / sizeof(names[0])) ? names[event] : "UNKNOWN";
+}
+
+/**
+ * TelemetryRecorder member function definitions
+ */
+void TelemetryRecorder::Block::reserve(size_t n) {
+    time.reserve(n);
+    voltage.reserve(n);
+    setCurrent.reserve(n);
+    measCurrent.reserve(n);
+    targetVoltage.reserve(n);
+    targetCurrent.reserve(n);
+    tester.reserve(n);
+    profile.reserve(n);
+    event.reserve(n);
+}
+
+void TelemetryRecorder::Block::clear() {
+    time.clear();
+    voltage.clear();
+    setCurrent.clear();
+    measCurrent.clear();
+    targetVoltage.clear();
+    targetCurrent.clear();
+    tester.clear();
+    profile.clear();
+    event.clear();
+}
+
+TelemetryRecorder::TelemetryRecorder(const std::string& path, size_t rowsPerBlock) :
+    filePath(path), runStart(std::chrono::steady_clock::now()), blockRows(rowsPerBlock)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Could not create telemetry file " + path);
+
+    // Header. Wall clock start lets rows be placed in real time later
+    int64_t startMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string header(MAGIC, sizeof(MAGIC));
+    append(header, startMicros);
+    append(header, VERSION);
+    header.resize(FILE_HEADER_SIZE, '\0');
+    file.write(header.data(), header.size());
+
+    // One spare block, so recording carries on while the writer has the last one
+    rows.reserve(blockRows);
+    recycled.emplace_back();
+    recycled.back().reserve(blockRows);
+
+    writer = std::thread(&TelemetryRecorder::writerLoop, this);
+}
+
+TelemetryRecorder::~TelemetryRecorder() {
+    {
+        std::lock_guard<std::mutex> guard(rowLock);
+        if (rows.size() > 0) this->handOff();
+        stopping = true;
+    }
+    queued.notify_one();
+    writer.join(); // Writer empties the queue before it exits
+}
+
+uint16_t TelemetryRecorder::addTester(const std::string& serialNumber) {
+    std::lock_guard<std::mutex> guard(fileLock);
+    uint16_t id = testerCount++;
+
+    std::string payload;
+    append(payload, id);
+    payload += serialNumber;
+    this->writeBlock(KIND_TESTER, (uint32_t)serialNumber.size(), payload);
+    file.flush();
+
+    return id;
+}
+
+void TelemetryRecorder::record(const uint16_t& testerId, const TelemetryFile::Event& event, const int& profile, const Telemetry& sample,
+                               const int& targetVoltage, const int& targetCurrent) {
+    // Events without a reading carry no timestamp of their own
+    auto when = (sample.timestamp.time_since_epoch().count() != 0) ? sample.timestamp : std::chrono::steady_clock::now();
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(when - runStart).count();
+
+    bool handed;
+    {
+        std::lock_guard<std::mutex> guard(rowLock);
+        rows.time.push_back(micros);
+        rows.voltage.push_back(sample.sinkVoltage);
+        rows.setCurrent.push_back(sample.sinkSetCurrent);
+        rows.measCurrent.push_back(sample.sinkMeasCurrent);
+        rows.targetVoltage.push_back(targetVoltage);
+        rows.targetCurrent.push_back(targetCurrent);
+        rows.tester.push_back(testerId);
+        rows.profile.push_back((uint8_t)profile);
+        rows.event.push_back(event);
+        handed = rows.size() >= blockRows;
+        if (handed) this->handOff(); // Block is full, the writer takes it from here
+    }
+
+    if (handed) queued.notify_one();
+}
+
+void TelemetryRecorder::flush() {
+    std::unique_lock<std::mutex> guard(rowLock);
+    if (rows.size() > 0) {
+        this->handOff();
+        queued.notify_one();
+    }
+    drained.wait(guard, [this]() { return full.empty() && !writing; });
+}
+
+void TelemetryRecorder::handOff() {
+    full.push_back(std::move(rows));
+
+    // Only allocates if the writer has fallen more than a block behind
+    if (recycled.empty()) {
+        rows = Block();
+        rows.reserve(blockRows);
+    } else {
+        rows = std::move(recycled.back());
+        recycled.pop_back();
+    }
+}
+
+void TelemetryRecorder::writerLoop() {
+    std::unique_lock<std::mutex> guard(rowLock);
+    while (true) {
+        queued.wait(guard, [this]() { return stopping || !full.empty(); });
+        if (full.empty()) return; // Stopping and everything is written
+
+        Block block = std::move(full.front());
+        full.pop_front();
+        writing = true;
+        guard.unlock();
+
+        {
+            std::lock_guard<std::mutex> fileGuard(fileLock);
+            this->writeRows(block);
+            file.flush();
+        }
+        block.clear();
+
+        guard.lock();
+        recycled.push_back(std::move(block));
+        writing = false;
+        if (full.empty()) drained.notify_all();
+    }
+}
+
+void TelemetryRecorder::writeRows(Block& block) {
+    std::string payload;
+    payload.reserve(padded(block.size() * ROW_BYTES));
+    appendColumn(payload, block.time);
+    appendColumn(payload, block.voltage);
+    appendColumn(payload, block.setCurrent);
+    appendColumn(payload, block.measCurrent);
+    appendColumn(payload, block.targetVoltage);
+    appendColumn(payload, block.targetCurrent);
+    appendColumn(payload, block.tester);
+    appendColumn(payload, block.profile);
+    appendColumn(payload, block.event);
+    this->writeBlock(KIND_ROWS, (uint32_t)block.size(), payload);
+}
+
+void TelemetryRecorder::writeBlock(const uint32_t& kind, const uint32_t& count, const std::string& payload) {
+    std::string out;
+    out.reserve(BLOCK_HEADER_SIZE + padded(payload.size()));
+    append(out, kind);
+    append(out, count);
+    append(out, (uint32_t)padded(payload.size()));
+    append(out, (uint32_t)0);
+    out += payload;
+    out.resize(BLOCK_HEADER_SIZE + padded(payload.size()), '\0');
+    file.write(out.data(), out.size());
+}
+
+/**
+ * TelemetryReader member function definitions
+ */
+TelemetryReader::TelemetryReader(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Could not open telemetry file " + path);
+    hFile = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        this->unmap();
+        throw std::runtime_error("Could not read telemetry file " + path);
+    }
+    size = (size_t)fileSize.QuadPart;
+
+    if (size > 0) {
+        hMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping != NULL) data = static_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error("Could not open telemetry file " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) size = (size_t)st.st_size;
+    if (size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) data = static_cast<const char*>(p);
+    }
+    close(fd); // Mapping stays valid
+#endif
+
+    if (data == nullptr || size < FILE_HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        this->unmap();
+        throw std::runtime_error(path + " is not a telemetry file");
+    }
+
+    startMicros = load<int64_t>(data + 8);
+
+    // Walk block headers only, columns stay in the mapping
+    size_t pos = FILE_HEADER_SIZE;
+    while (pos + BLOCK_HEADER_SIZE <= size) {
+        uint32_t kind = load<uint32_t>(data + pos);
+        uint32_t count = load<uint32_t>(data + pos + 4);
+        uint32_t payloadBytes = load<uint32_t>(data + pos + 8);
+        const char* payload = data + pos + BLOCK_HEADER_SIZE;
+        if (pos + BLOCK_HEADER_SIZE + payloadBytes > size) break; // Cut off mid-write
+
+        // Columns are addressed from 'count', so a payload too short to hold them is corrupt rather than short
+        size_t needed = (kind == KIND_ROWS) ? (size_t)count * ROW_BYTES : (kind == KIND_TESTER) ? 2 + (size_t)count : 0;
+        if (payloadBytes < needed) {
+            this->unmap();
+            throw std::runtime_error(path + " has a corrupt block at offset " + std::to_string(pos));
+        }
+
+        if (kind == KIND_TESTER) {
+            uint16_t id = load<uint16_t>(payload);
+            if (testerNames.size() <= id) testerNames.resize(id + 1);
+            testerNames[id].assign(payload + 2, count);
+        } else if (kind == KIND_ROWS) {
+            TelemetryBlock block;
+            block.rows = count;
+            block.time = reinterpret_cast<const int64_t*>(payload);
+            block.voltage = reinterpret_cast<const int32_t*>(payload + 8 * (size_t)count);
+            block.setCurrent = block.voltage + count;
+            block.measCurrent = block.setCurrent + count;
+            block.targetVoltage = block.measCurrent + count;
+            block.targetCurrent = block.targetVoltage + count;
+            block.tester = reinterpret_cast<const uint16_t*>(block.targetCurrent + count);
+            block.profile = reinterpret_cast<const uint8_t*>(block.tester + count);
+            block.event = block.profile + count;
+
+            blockList.push_back(block);
+            rowTotal += count;
+        }
+
+        pos += BLOCK_HEADER_SIZE + payloadBytes;
+    }
+}
+
+TelemetryReader::~TelemetryReader() {
+    this->unmap();
+}
+
+void TelemetryReader::unmap() {
+#ifdef _WIN32
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (hMapping != NULL) CloseHandle(hMapping);
+    if (hFile != NULL) CloseHandle(hFile);
+    hMapping = NULL;
+    hFile = NULL;
+#else
+    if (data != nullptr) munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+}
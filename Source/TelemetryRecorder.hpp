@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Telemetry.hpp"
+
+/**
+ * @brief Per-run binary telemetry file with fixed-width typed columns.
+ *
+ * Layout, all integers little-endian, every block padded to 8 bytes so a mapped file's columns are aligned:
+ *     header:  "PMTLM01\0", i64 run start (µs since Unix epoch), u32 version, u32 reserved, u64 reserved
+ *     blocks:  u32 kind, u32 count, u32 payloadBytes, u32 reserved, then payload
+ *              kind 0, rows:   i64 time[count] (µs since run start), i32 voltage[count], i32 setCurrent[count],
+ *                              i32 measCurrent[count], i32 targetVoltage[count], i32 targetCurrent[count],
+ *                              u16 tester[count], u8 profile[count], u8 event[count]
+ *              kind 1, tester: u16 id, then 'count' bytes of serial number
+ */
+namespace TelemetryFile {
+    enum Event : uint8_t {
+        SAMPLE = 0,         // Periodic status sample
+        START = 1,          // Load applied, test running
+        STOP = 2,           // Time limit reached
+        ABORT = 3,          // Cancelled or failed
+        DROP = 4,           // Output dropped out
+        RECONNECT = 5,      // Sink reconnect attempt
+        PROFILE_CHANGE = 6, // New profile selected
+        INTERVAL_MIN = 7,   // Per-field minimum over a reporting interval
+        INTERVAL_MAX = 8,   // Per-field maximum over a reporting interval
+        INTERVAL_MEAN = 9,  // Per-field mean over a reporting interval
+        WINDOW = 10,        // Full-rate sample from around a trigger
+        FOLDBACK = 11,      // Current shifted down without dropping out
+        DROOP = 12,         // Voltage below the window or shifted down
+        OVERVOLTAGE = 13,   // Voltage above the window
+        OSCILLATION = 14    // Output swinging around its baseline
+    };
+
+    const char* eventStr(const uint8_t& event);
+}
+
+/**
+ * @brief Appends samples to a telemetry file.
+ * Rows are buffered per column and a full block is handed to a writer thread, so recording a sample is
+ * a few stores into memory and never waits on the disk. Thread safe.
+ */
+class TelemetryRecorder
+{
+public:
+    // Create 'path'. Throws if it can't be opened
+    explicit TelemetryRecorder(const std::string& path, size_t blockRows = 4096);
+
+    // Write out buffered rows and stop the writer
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder&) = delete;
+    TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+    // Register a tester and return its id for record()
+    uint16_t addTester(const std::string& serialNumber);
+
+    // Append one row. 'sample' supplies time and measurements, which may be zero for events without a reading
+    void record(const uint16_t& testerId, const TelemetryFile::Event& event, const int& profile, const Telemetry& sample,
+                const int& targetVoltage, const int& targetCurrent);
+
+    // Write buffered rows now. Returns once they are on disk
+    void flush();
+
+    const std::string& path() const { return filePath; }
+
+private:
+    struct Block {
+        std::vector<int64_t> time;
+        std::vector<int32_t> voltage, setCurrent, measCurrent, targetVoltage, targetCurrent;
+        std::vector<uint16_t> tester;
+        std::vector<uint8_t> profile, event;
+
+        void reserve(size_t rows);
+        void clear();
+        size_t size() const { return time.size(); }
+    };
+
+    std::string filePath;
+    std::ofstream file;
+    std::chrono::steady_clock::time_point runStart;
+    size_t blockRows;
+    uint16_t testerCount = 0;
+
+    std::mutex rowLock;         // Guards 'rows', 'full', 'recycled', 'writing' and 'stopping'
+    Block rows;
+    std::deque<Block> full;     // Blocks waiting for the writer, oldest first
+    std::vector<Block> recycled; // Written blocks, reused for recording
+    bool writing = false;       // Writer holds a block taken from 'full'
+    bool stopping = false;
+    std::condition_variable queued;  // Wakes the writer
+    std::condition_variable drained; // Wakes flush() once nothing is left to write
+
+    std::mutex fileLock;        // Guards 'file'
+    std::thread writer;
+
+    // Queue 'rows' for the writer and give recording a clean block. Caller holds rowLock
+    void handOff();
+
+    void writerLoop();
+    void writeRows(Block& block);
+    void writeBlock(const uint32_t& kind, const uint32_t& count, const std::string& payload);
+};
+
+// Column pointers for one block of rows in a mapped telemetry file
+struct TelemetryBlock {
+    size_t rows = 0;
+    const int64_t* time = nullptr;
+    const int32_t* voltage = nullptr;
+    const int32_t* setCurrent = nullptr;
+    const int32_t* measCurrent = nullptr;
+    const int32_t* targetVoltage = nullptr;
+    const int32_t* targetCurrent = nullptr;
+    const uint16_t* tester = nullptr;
+    const uint8_t* profile = nullptr;
+    const uint8_t* event = nullptr;
+};
+
+/**
+ * @brief Memory-maps a telemetry file for analysis.
+ * Opening only walks the block headers. Columns are read in place, nothing is copied.
+ */
+class TelemetryReader
+{
+public:
+    // Map 'path'. Throws if it isn't a telemetry file. A truncated last block is ignored
+    explicit TelemetryReader(const std::string& path);
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    // Run start, µs since Unix epoch
+    int64_t startEpochMicros() const { return startMicros; }
+
+    // Serial numbers indexed by tester id
+    const std::vector<std::string>& testers() const { return testerNames; }
+
+    const std::vector<TelemetryBlock>& blocks() const { return blockList; }
+
+    size_t rowCount() const { return rowTotal; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* hFile = nullptr;
+    void* hMapping = nullptr;
+#endif
+
+    int64_t startMicros = 0;
+    std::vector<std::string> testerNames;
+    std::vector<TelemetryBlock> blockList;
+    size_t rowTotal = 0;
+
+    void unmap();
+};
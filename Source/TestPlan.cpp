@@ -0,0 +1,194 @@
+#include "TestPlan.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    std::string trim(const std::string& s) {
+        size_t first = s.find_first_not_of(" \t\r");
+        if (first == std::string::npos) return "";
+        size_t last = s.find_last_not_of(" \t\r");
+        return s.substr(first, last - first + 1);
+    }
+
+    std::string lower(std::string s) {
+        for (char& c : s) c = (char)tolower((unsigned char)c);
+        return s;
+    }
+
+    // Whole non-negative number, or -1
+    int number(const std::string& s) {
+        if (s.empty() || s.size() > 9 || !std::all_of(s.begin(), s.end(), [](char c) { return isdigit((unsigned char)c); })) return -1;
+        return std::stoi(s);
+    }
+}
+
+/**
+ * TesterPlan member function definitions
+ */
+std::string TesterPlan::selectProfiles(const PdoTable& pdos) const {
+    std::vector<const Pdo*> eligible;
+    for (const Pdo& pdo : pdos.entries()) {
+        if (pdo.maxVoltage >= minVoltage) eligible.push_back(&pdo);
+    }
+
+    std::string selected;
+    auto add = [&](const int& index) { selected += (selected.empty() ? "" : ",") + std::to_string(index); };
+
+    if (profiles == "max") {
+        // Highest power, earliest index wins a tie
+        const Pdo* best = nullptr;
+        for (const Pdo* pdo : eligible) {
+            if (best == nullptr || pdo->maxPower > best->maxPower) best = pdo;
+        }
+        if (best != nullptr) add(best->index);
+    } else if (profiles == "all") {
+        for (const Pdo* pdo : eligible) add(pdo->index);
+    } else {
+        std::stringstream ss(profiles);
+        std::string field;
+        while (getline(ss, field, ',')) {
+            const Pdo* pdo = pdos.find(trim(field));
+            if (pdo == nullptr) throw std::runtime_error("(" + serialNumber + ") Planned profile " + trim(field) + " is not advertised.");
+            if (pdo->maxVoltage >= minVoltage) add(pdo->index);
+        }
+    }
+
+    if (selected.empty()) throw std::runtime_error("(" + serialNumber + ") No advertised profile matches the plan.");
+    return selected;
+}
+
+/**
+ * TestPlan member function definitions
+ */
+TestPlan TestPlan::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Could not open test plan " + path);
+    return parse(file, path);
+}
+
+TestPlan TestPlan::parse(std::istream& input, const std::string& name) {
+    TestPlan plan;
+    plan.name = name;
+
+    TesterPlan* section = nullptr;
+    std::string raw;
+    int lineNum = 0;
+    while (getline(input, raw)) {
+        ++lineNum;
+        auto fail = [&](const std::string& problem) { return std::runtime_error(name + ":" + std::to_string(lineNum) + ": " + problem); };
+
+        std::string line = trim(raw.substr(0, raw.find_first_of("#;")));
+        if (line.empty()) continue;
+
+        // Section header
+        if (line.front() == '[') {
+            if (line.back() != ']') throw fail("Unterminated section header");
+            std::stringstream ss(line.substr(1, line.size() - 2));
+            std::string kind, sn, extra;
+            ss >> kind >> sn >> extra;
+            if (lower(kind) != "tester" || sn.empty() || !extra.empty()) throw fail("Expected [tester <SN>] or [tester any]");
+
+            plan.testers.emplace_back();
+            section = &plan.testers.back();
+            section->serialNumber = (lower(sn) == "any") ? "any" : sn;
+            section->line = lineNum;
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) throw fail("Expected key = value");
+        std::string key = lower(trim(line.substr(0, eq)));
+        std::string value = trim(line.substr(eq + 1));
+        if (value.empty()) throw fail("Missing value for " + key);
+
+        if (section == nullptr) {
+            if (key != "duration") throw fail("Unknown plan setting " + key);
+            plan.durationMinutes = number(value);
+            if (plan.durationMinutes <= 0) throw fail("Duration must be a positive number of minutes");
+        } else if (key == "type") {
+            section->type = value;
+            for (char& c : section->type) c = (char)toupper((unsigned char)c);
+            if (section->type != "PM240" && section->type != "PM125") throw fail("Type must be PM240 or PM125");
+        } else if (key == "count") {
+            section->count = (lower(value) == "all") ? -1 : number(value);
+            if (section->count == 0 || section->count < -1) throw fail("Count must be a positive number or all");
+        } else if (key == "profiles" || key == "profile") {
+            section->profiles = lower(value);
+            if (section->profiles != "max" && section->profiles != "all") {
+                std::stringstream ss(value);
+                std::string field;
+                while (getline(ss, field, ',')) {
+                    if (number(trim(field)) <= 0) throw fail("Profiles must be max, all, or profile numbers separated by commas");
+                }
+            }
+        } else if (key == "min_voltage") {
+            section->minVoltage = number(value);
+            if (section->minVoltage < 0) throw fail("min_voltage must be a number of mV");
+        } else if (key == "load") {
+            section->loadCurrent = number(value);
+            if (section->loadCurrent <= 0) throw fail("Load must be a positive number of mA");
+        } else if (key == "duration") {
+            section->durationMinutes = number(value);
+            if (section->durationMinutes <= 0) throw fail("Duration must be a positive number of minutes");
+        } else {
+            throw fail("Unknown tester setting " + key);
+        }
+    }
+
+    for (const TesterPlan& t : plan.testers) {
+        if (!t.isAny() && (t.count != 1 || !t.type.empty())) {
+            throw std::runtime_error(name + ":" + std::to_string(t.line) + ": type and count only apply to [tester any]");
+        }
+    }
+    if (plan.testers.empty()) throw std::runtime_error(name + ": Plan has no [tester] sections");
+
+    return plan;
+}
+
+std::vector<TesterPlan> TestPlan::resolve(const std::vector<std::string>& serials, const std::vector<std::string>& types) const {
+    std::vector<bool> taken(serials.size(), false);
+    std::vector<TesterPlan> assigned;
+
+    auto assign = [&](const TesterPlan& rule, const size_t& i) {
+        taken[i] = true;
+        assigned.push_back(rule);
+        assigned.back().serialNumber = serials[i];
+        assigned.back().type = types[i];
+        assigned.back().count = 1;
+        if (assigned.back().durationMinutes == 0) assigned.back().durationMinutes = durationMinutes;
+    };
+
+    // Named testers first, so an "any" rule can't take one of them
+    for (const TesterPlan& rule : testers) {
+        if (rule.isAny()) continue;
+        auto it = std::find(serials.begin(), serials.end(), rule.serialNumber);
+        if (it == serials.end()) throw std::runtime_error(name + ":" + std::to_string(rule.line) + ": Tester " + rule.serialNumber + " was not found");
+        size_t i = it - serials.begin();
+        if (taken[i]) throw std::runtime_error(name + ":" + std::to_string(rule.line) + ": Tester " + rule.serialNumber + " is planned twice");
+        assign(rule, i);
+    }
+
+    for (const TesterPlan& rule : testers) {
+        if (!rule.isAny()) continue;
+        int matched = 0;
+        for (size_t i = 0; i < serials.size() && (rule.count < 0 || matched < rule.count); ++i) {
+            if (taken[i] || (!rule.type.empty() && types[i] != rule.type)) continue;
+            assign(rule, i);
+            ++matched;
+        }
+
+        if (matched == 0 || (rule.count > 0 && matched < rule.count)) {
+            std::string family = rule.type.empty() ? "" : rule.type + " ";
+            throw std::runtime_error(name + ":" + std::to_string(rule.line) + ": Only " + std::to_string(matched) + " free " + family + "tester(s) for this rule");
+        }
+    }
+
+    return assigned;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "PdoTable.hpp"
+
+/**
+ * @brief What one tester, or one rule for "any" tester, should run.
+ * Plan file section:
+ *
+ *     [tester PM240-0001]      ; or [tester any]
+ *     type = PM240             ; "any" only: PM240 or PM125
+ *     count = 2                ; "any" only: testers to take, or "all". Default 1
+ *     profiles = max           ; max, all, or indices such as 1,3
+ *     min_voltage = 9000       ; mV, ignore profiles that can't reach this voltage
+ *     load = 2000              ; mA, stress load. Default is the profile's max current
+ *     duration = 60            ; minutes, overrides the plan default
+ */
+struct TesterPlan {
+    std::string serialNumber = "any";
+    std::string type;               // Family filter for "any", filled in for resolved testers
+    std::string profiles = "max";
+    int count = 1;                  // -1 for every matching tester
+    int minVoltage = 0;             // mV
+    int loadCurrent = 0;            // mA, 0 for the profile's max current
+    int durationMinutes = 0;        // 0 for the plan default
+    int line = 0;                   // Line of the section header, for error messages
+
+    bool isAny() const { return serialNumber == "any"; }
+
+    // Profiles the rule picks from a DUT's advertisement, comma separated. Throws if it picks none
+    std::string selectProfiles(const PdoTable& pdos) const;
+};
+
+/**
+ * @brief Declarative campaign, so a run can start without operator input.
+ * Line based, '#' or ';' starts a comment. Keys before the first section apply to the whole plan:
+ *
+ *     duration = 120           ; minutes, default for every tester
+ */
+class TestPlan
+{
+public:
+    std::string name;               // File the plan came from
+    int durationMinutes = 120;
+    std::vector<TesterPlan> testers;
+
+    // Parse a plan file. Throws "file:line: problem" on anything it doesn't understand
+    static TestPlan load(const std::string& path);
+    static TestPlan parse(std::istream& input, const std::string& name);
+
+    // Assign the plan to discovered testers, given as parallel serial number and type lists. Named testers must
+    // be present, "any" rules then take the remaining testers in discovery order. Every result has its serial
+    // number, type and duration filled in. Throws if a rule can't be met
+    std::vector<TesterPlan> resolve(const std::vector<std::string>& serials, const std::vector<std::string>& types) const;
+};
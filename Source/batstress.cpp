@@ -1,6 +1,15 @@
 #define _WIN32_WINNT 0x0600
 
 #include "Passmark.hpp"
+#include "ConsoleCapture.hpp"
+#include "AsyncTester.hpp"
+#include "Reactor.hpp"
+#include "AsyncLog.hpp"
+#include "TelemetryRecorder.hpp"
+#include "SampleRing.hpp"
+#include "AnomalyDetector.hpp"
+#include "JobQueue.hpp"
+#include "LeaseTable.hpp"
 
 #include <vector>
 #include <stdexcept>
@@ -13,83 +22,185 @@
 #include <algorithm>
 #include <iomanip>
 #include <cstdlib>
+#include <memory>
+#include <optional>
+#include <deque>
+#include <ctime>
+#include <future>
+#include <exception>
+#include <filesystem>
 
 // Determine max output from available profiles
 std::string getMax(tester& Tester) {
-    std::string indexStr = ""; // return value
-
-    // Initialize loop variables
-    int voltage = 5000, current = 500, pNow;
-    int pLast = voltage * current;
-
-    for (std::string line : Tester.sink.profileList) { // Iterate through output line by line
-        std::string searchStr = "INDEX:";
-        size_t pos1 = line.find(searchStr);
-
-        if (pos1 != std::string::npos) { // Get index of current profile
-            std::string temp = line.substr(pos1 + searchStr.size(), 1);
-            searchStr = "V:";
-            size_t pos2 = line.find(searchStr, pos1);
-            
-            // Check if profile is variable voltage type
-            bool isVariableVoltage = false;
-            std::for_each(VariableVoltageTypes.begin(), VariableVoltageTypes.end(), [&](std::string s) {
-                size_t Pos1 = line.find("TYPE:", pos1);
-                size_t Pos2 = line.find(",", Pos1);
-                if (Pos1 != std::string::npos && Pos2 != std::string::npos) {
-                    Pos1 += 5;
-                    isVariableVoltage = (line.substr(Pos1, Pos2 - Pos1) == s) ? true : isVariableVoltage;
-                }
-            });
+    // Only select a profile that beats the 5V/500mA default
+    const Pdo* best = Tester.sink.pdos.maxPower();
+    return (best != nullptr && best->maxPower > 5000 * 500 / 1000) ? std::to_string(best->index) : "";
+}
 
-            // Get max supported voltage of profile
-            if (isVariableVoltage) {
-                searchStr = "-";
-                pos2 = (pos2 != std::string::npos) ? line.find(searchStr, pos2) : std::string::npos;
-            }
-            voltage = (pos2 != std::string::npos) ? std::stoi(getNumStr(line, pos2 + searchStr.size())) : 0;
+// Profile to continue on after a re-advertisement: the lowest power one that still delivers the running target,
+// otherwise the highest power one
+std::string reselect(tester& Tester, const int& targetVoltage, const int& targetCurrent) {
+    const Pdo* fit = Tester.sink.pdos.bestFit(targetVoltage, targetCurrent);
+    return (fit != nullptr) ? std::to_string(fit->index) : getMax(Tester);
+}
+
+// Select profile at its max voltage. Returns {target voltage, measured voltage, max current}
+Async::Task<std::vector<int>> magic(AsyncTester t, std::string profile) {
+    const Pdo& pdo = t.Tester.sink.getProfileInfo(profile);
+    int setVoltage = pdo.maxVoltage; // Set to max supported voltage
+
+    // Determine profile type
+    tester::status Stats = (pdo.isVariableVoltage) ? co_await t.setVariableVoltageProfile(profile, setVoltage) : co_await t.setProfile(profile);
+
+    co_return std::vector<int>{setVoltage, Stats.sinkVoltage, pdo.maxCurrent};
+}
+
+// How often StressTest samples and reports
+struct SamplingConfig {
+    double rateHz = 1.0;                            // Status reads per second
+    std::chrono::seconds reportPeriod{30};          // Console summary and telemetry interval rows
+    std::chrono::seconds preTrigger{10};            // Full-rate history kept before a drop
+    std::chrono::seconds postTrigger{10};           // Full-rate samples kept after a drop
+    bool recordRaw = false;                         // Record every sample, not just intervals and trigger windows
+    AnomalyConfig anomaly;
+
+    // PASSMARK_SAMPLE_HZ sets the rate, clamped to one sample per report up to 50Hz. PASSMARK_TELEMETRY_RAW=1 sets recordRaw.
+    // PASSMARK_ANOMALY_THRESHOLD and PASSMARK_ANOMALY_DEBOUNCE (samples) tune the detector
+    static SamplingConfig fromEnvironment() {
+        SamplingConfig cfg;
+        const char* rate = getenv("PASSMARK_SAMPLE_HZ");
+        if (rate != nullptr && atof(rate) > 0) cfg.rateHz = std::clamp(atof(rate), 1.0 / cfg.reportPeriod.count(), 50.0);
+        const char* raw = getenv("PASSMARK_TELEMETRY_RAW");
+        cfg.recordRaw = (raw != nullptr && std::string(raw) == "1");
+        const char* threshold = getenv("PASSMARK_ANOMALY_THRESHOLD");
+        if (threshold != nullptr && atof(threshold) > 0) cfg.anomaly.threshold = atof(threshold);
+        const char* debounce = getenv("PASSMARK_ANOMALY_DEBOUNCE");
+        if (debounce != nullptr && atoi(debounce) > 0) cfg.anomaly.debounce = atoi(debounce);
+        return cfg;
+    }
 
-            // Get max supported current of profile
-            searchStr = "I:";
-            size_t pos3 = line.find(searchStr, pos2);
-            current = (pos3 != std::string::npos) ? std::stoi(getNumStr(line, pos3 + searchStr.size())) : 0;
+    size_t samplesIn(const std::chrono::seconds& span) const { return (size_t)(span.count() * rateHz + 0.5); }
+};
+
+// Testers taking part in the run and the settings every test shares. Testers can join while it runs
+struct Campaign {
+    struct Member {
+        tester Tester;
+        Cancel::Token job;          // Current test, under the tester's token. Cancelled to retire it
+        bool running = false;
+        bool needsTest = true;      // No test yet, or the last one was retired
+        bool idleLogged = false;    // Already said why no test was started
+        int missing = 0;            // Consecutive discovery passes that didn't find the tester
+        std::string duration;       // Minutes
+        int loadCurrent = 0;        // mA, 0 for the profile's max current
+
+        // Utilization, for queued jobs
+        std::chrono::steady_clock::time_point joined = Async::now();
+        std::chrono::steady_clock::time_point busySince;
+        std::chrono::steady_clock::duration busy{0};
+        int jobsPassed = 0, jobsFailed = 0;
+
+        explicit Member(tester&& t) : Tester(std::move(t)) {}
+    };
+
+    std::string duration;           // Minutes, for testers that join without a plan entry
+    SamplingConfig sampling;
+    TelemetryRecorder* recorder = nullptr;
+    Async::Reactor* reactor = nullptr;
+    JobQueue* queue = nullptr;      // Set when testers take their work from a job queue
+    bool dispatching = false;       // Dispatcher still handing out jobs
+
+    std::deque<Member> members; // Deque keeps every tester at a fixed address as more join
+    size_t running = 0;
+
+    std::vector<std::chrono::steady_clock::duration> abortLatency; // Ctrl+C to load off, one per tester unloaded
+
+    // Add a claimed tester and give it the next console color
+    Member& add(tester&& t) {
+        t.consoleColor = colors[members.size() % 4];
+        Member& m = members.emplace_back(std::move(t));
+        m.duration = duration;
+        return m;
+    }
 
-            // Determine max power supported by profile and if greater than previous profile, set return value to current profile index
-            pNow = voltage * current;
-            indexStr = (pNow > pLast) ?  temp : indexStr;
-            pLast = (indexStr == temp) ? pNow : pLast;
+    Member* find(const std::string& sn) {
+        for (Member& m : members) {
+            if (m.Tester.serialNumber == sn) return &m;
         }
+        return nullptr;
     }
 
-    return indexStr;
+    // Spawn a stress test for 'm' on the reactor
+    void start(Member& m, const std::string& profileStr);
+
+    // Spawn a queued job for 'm' on the reactor and mark the job running
+    void start(Member& m, DutJob& job);
+
+    // Log and keep how long after Ctrl+C 'm' had its load dropped
+    void unloaded(const Member& m, const std::chrono::steady_clock::time_point& at);
+};
+
+// Load current for a member's test: the planned load, capped at what the profile can deliver
+int loadFor(const Campaign::Member& m, const int& maxCurrent) {
+    return (m.loadCurrent > 0) ? std::min(m.loadCurrent, maxCurrent) : maxCurrent;
 }
 
-// Logic for power bank stress test
-void StressTest(tester& Tester, const std::string& profileStr, const std::string& duration) { //std::cout << "Pit stop!" << std::endl;
+// Telemetry event for a detected anomaly
+TelemetryFile::Event anomalyEvent(const AnomalyEvent::Kind& kind) {
+    switch (kind) {
+        case AnomalyEvent::Kind::Dropout: return TelemetryFile::DROP;
+        case AnomalyEvent::Kind::Foldback: return TelemetryFile::FOLDBACK;
+        case AnomalyEvent::Kind::Droop: return TelemetryFile::DROOP;
+        case AnomalyEvent::Kind::Overvoltage: return TelemetryFile::OVERVOLTAGE;
+        default: return TelemetryFile::OSCILLATION;
+    }
+}
 
-    auto magic = [&Tester, &profileStr]() {
-        int setVoltage; // return value
-        tester::Sink::ProfileInfo info = Tester.sink.getProfileInfo(profileStr);
-        tester::status Stats;
-        
-        // Determine profile type and set to max supported voltage
-        if (info.isVariableVoltage) {
-            size_t pos = info.voltageRange.find("-"); 
-
-            if (pos != std::string::npos) {
-                setVoltage = std::stoi(info.voltageRange.substr(pos + 1));
-                Stats = Tester.setVariableVoltageProfile(profileStr, setVoltage);
-            }
+// Per-run telemetry file, "batstress_YYYYMMDD_HHMMSS.pmt" in PASSMARK_TELEMETRY_DIR or the working directory
+std::string telemetryPath() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    std::ostringstream name;
+    name << "batstress_" << std::put_time(&local, "%Y%m%d_%H%M%S") << ".pmt";
 
-        } else {
-            setVoltage = std::stoi(info.voltageRange);
-            Stats = Tester.setProfile(profileStr);
-        }
+    const char* dir = getenv("PASSMARK_TELEMETRY_DIR");
+    return (dir != nullptr && *dir != '\0') ? (std::filesystem::path(dir) / name.str()).string() : name.str();
+}
 
-        return std::vector<int>{setVoltage, std::stoi(Stats.sinkVoltage), std::stoi(info.maxCurrent)};
-    };
+// Where a stress test has got to, kept outside the test loop so the abort path can still record against it
+struct StressRun {
+    TelemetryRecorder* recorder = nullptr;
+    uint16_t testerId = 0;
+    std::string activeProfile;      // Changes if the DUT re-advertises after a drop
+    int targetVoltage = 0, targetCurrent = 0;
+    bool unloaded = false;          // Load already dropped on the way out
+
+    void note(const TelemetryFile::Event& event, const tester::status& Stats) const {
+        if (recorder == nullptr) return;
+
+        // Events without a reading are stamped on the reactor's clock, like the samples around them
+        tester::status stamped = Stats;
+        if (stamped.timestamp.time_since_epoch().count() == 0) stamped.timestamp = Async::now();
+        recorder->record(testerId, event, std::stoi(activeProfile), stamped, targetVoltage, targetCurrent);
+    }
+};
+
+// Logic for power bank stress test. Runs on the reactor alongside every other tester's test. Samples are
+// taken on a fixed grid at cfg.rateHz and summarised every cfg.reportPeriod. Interval summaries, events and
+// full-rate windows around each drop go to the run's recorder if set. Throws JobCancelled once the tester's
+// token is cancelled, see StressTest()
+Async::Task<void> stressLoop(Campaign::Member& m, StressRun& run, const SamplingConfig& cfg) {
+    using namespace std::chrono;
+    AsyncTester t(m.Tester);
+    tester& Tester = m.Tester;
+    const std::string& duration = m.duration;
 
-    std::vector<int> initialState = magic();
+    std::string& activeProfile = run.activeProfile;
+    int& targetVoltage = run.targetVoltage;
+    int& targetCurrent = run.targetCurrent;
+    auto note = [&run](const TelemetryFile::Event& event, const tester::status& Stats) { run.note(event, Stats); };
+
+    std::vector<int> initialState = co_await magic(t, activeProfile);
 
     // Check that voltage is set. Retry up to 3 times
     int attempts = 1;
@@ -97,144 +208,581 @@ void StressTest(tester& Tester, const std::string& profileStr, const std::string
         int Vt = initialState[0] /* Target voltage */, Vm = initialState[1]; // Measured voltage
         if (Vm > Vt * 0.95 && Vm < Vt * 1.05) break;
         else if (attempts > 3) throw std::runtime_error("(" + Tester.serialNumber + ") Unable to set voltage.");
-        initialState = magic();
+        initialState = co_await magic(t, activeProfile);
         ++attempts;
     }
 
     // Set load
-    std::string iLoad = std::to_string(initialState[2]);
-    Tester.setLoad(iLoad);
+    targetVoltage = initialState[0];
+    targetCurrent = loadFor(m, initialState[2]);
+    note(TelemetryFile::START, co_await t.setLoad(std::to_string(targetCurrent)));
+
+    // Test loop. Deadlines are fixed offsets from the start, so late wake-ups never accumulate as drift
+    const auto samplePeriod = duration_cast<steady_clock::duration>(std::chrono::duration<double>(1.0 / cfg.rateHz));
+    auto startTime = Async::now();
+    auto nextSample = startTime;
+    auto nextReport = startTime;
+    auto limitMinutes = minutes(std::stoi(duration));
+    Tester.log() << "Starting " << limitMinutes.count() << "min test at " << cfg.rateHz << " samples/s...";
 
-    // Test loop
-    using namespace std::chrono;
+    SampleRing samples(cfg.samplesIn(cfg.preTrigger), cfg.samplesIn(cfg.postTrigger));
+    AnomalyDetector detector(cfg.anomaly);
+    detector.setTargets(targetVoltage, targetCurrent);
+    unsigned long long skippedSlots = 0; // Sample slots lost because an iteration overran
 
-    auto startTime = steady_clock::now();
-    auto limitMinutes = minutes(std::stoi(duration));
-    Tester.log() << "Starting " << limitMinutes.count() << "min test...";
-    
     int errCount = 0; bool errWarning = false;
 
     while (true) {
-        // Check for abort at the start of every iteration
-        if (g_abortRequested.load(std::memory_order_relaxed)) {
-            Tester.setLoad("0"); // Safety: Unload before exiting
-            throw CtrlCAbort{};
+        // A hung status read loses one sample. Repeated hangs quarantine the tester and end the test
+        tester::status Stats;
+        bool timedOut = false;
+        try {
+            Stats = co_await t.getStatus();
+        } catch (const Spawn::Timeout& e) {
+            if (Tester.isQuarantined()) throw;
+            Tester.logErr() << e.what();
+            timedOut = true;
+        }
+
+        // Without a sample there's nothing to record or judge, but the time limit, reports and sample grid still apply
+        if (!timedOut) {
+            if (cfg.recordRaw) note(TelemetryFile::SAMPLE, Stats);
+
+            // A completed window around a drop is kept at full rate
+            if (samples.push(Stats)) {
+                size_t triggerIndex = 0;
+                std::vector<Telemetry> window = samples.takeWindow(triggerIndex);
+                if (!cfg.recordRaw) for (const Telemetry& s : window) note(TelemetryFile::WINDOW, s);
+
+                const Telemetry& trig = window[triggerIndex];
+                auto first = duration_cast<milliseconds>(window.front().timestamp - trig.timestamp).count();
+                auto last = duration_cast<milliseconds>(window.back().timestamp - trig.timestamp).count();
+                Tester.log() << "Captured " << window.size() << " samples from " << first << "ms to +" << last << "ms around drop";
+            }
         }
 
         // Check remaining time
-        auto timeNow = steady_clock::now();
-        auto timerStart = timeNow;
-        auto timeRemaining = duration_cast<seconds>(limitMinutes - (timeNow - startTime));
-
-        auto Hours = duration_cast<hours>(timeRemaining);
-        auto Minutes = duration_cast<minutes>(timeRemaining % hours(1));
-        auto Seconds = duration_cast<seconds>(timeRemaining % minutes(1));
-
-        if (Seconds.count() < 0) Seconds = seconds(0);
-
-        // Format output as h:mm:ss
-        Tester.log() << "Time remaining: "
-                     << Hours.count() << ":"
-                     << std::setfill('0') << std::setw(2) << Minutes.count() << ":"
-                     << std::setfill('0') << std::setw(2) << Seconds.count();
-
-        // Print stats to console
-        tester::status Stats = Tester.getStatus();
-        Tester.log() << "Sink voltage = " << Stats.sinkVoltage << "mV, Sink measured current = " << Stats.sinkMeasCurrent << "mA";
-        
-        if (timeRemaining.count() <= 0) { // Check if test time has expired
+        auto timeRemaining = duration_cast<seconds>(limitMinutes - (Async::now() - startTime));
+        bool expired = timeRemaining.count() <= 0;
+
+        // Decimate to one console summary per reporting interval
+        if (expired || Async::now() >= nextReport) {
+            auto Hours = duration_cast<hours>(timeRemaining);
+            auto Minutes = duration_cast<minutes>(timeRemaining % hours(1));
+            auto Seconds = duration_cast<seconds>(timeRemaining % minutes(1));
+
+            if (Seconds.count() < 0) Seconds = seconds(0);
+
+            // Format output as h:mm:ss
+            Tester.log() << "Time remaining: "
+                         << Hours.count() << ":"
+                         << std::setfill('0') << std::setw(2) << Minutes.count() << ":"
+                         << std::setfill('0') << std::setw(2) << Seconds.count();
+
+            // Print stats to console
+            SampleSummary interval = samples.takeInterval();
+            Telemetry mean = interval.mean();
+            Tester.log() << "Sink voltage = " << mean.sinkVoltage << "mV (" << interval.min.sinkVoltage << "-" << interval.max.sinkVoltage
+                         << "), Sink measured current = " << mean.sinkMeasCurrent << "mA (" << interval.min.sinkMeasCurrent << "-"
+                         << interval.max.sinkMeasCurrent << "), " << interval.count << " samples";
+            if (skippedSlots > 0) Tester.log() << "Sampling fell behind, " << skippedSlots << " sample slots skipped";
+
+            note(TelemetryFile::INTERVAL_MIN, interval.min);
+            note(TelemetryFile::INTERVAL_MAX, interval.max);
+            note(TelemetryFile::INTERVAL_MEAN, mean);
+
+            skippedSlots = 0;
+            while (nextReport <= Async::now()) nextReport += cfg.reportPeriod;
+        }
+
+        if (expired) { // Check if test time has expired
             Tester.log() << "Time limit reached. Terminating test...";
-            Tester.unload();
+            note(TelemetryFile::STOP, co_await t.unload());
             break;
         }
 
-        // Check error status
-        if (errCount > 0 && !errWarning) errCount -= 1;
+        // Check error status. Only a sample with no condition building up counts as a recovery
+        if (!timedOut && errCount > 0 && !errWarning && detector.healthy()) errCount -= 1;
         errWarning = false;
 
-        // Helper lambda to handle early termination of test
-        auto abortTest = [&Tester]() {
-            Tester.unload();
-            throw std::runtime_error("DUT unresponsive.");
-        };
+        // Early termination of test. Unloading has to be awaited, so callers throw after it
+        const char* abortReason = nullptr;
 
-        // Detect when output has decreased
-        int Im = std::stoi(Stats.sinkMeasCurrent);
-        
-        if (Im == 0) { // Detect if load dropped
+        // Detect degraded output. Dropouts and a voltage outside the window are recovered, other events are recorded
+        std::optional<AnomalyEvent> anomaly = (timedOut) ? std::nullopt : detector.update(Stats);
+        if (anomaly) {
+            using Kind = AnomalyEvent::Kind;
+            note(anomalyEvent(anomaly->kind), Stats);
+            samples.trigger();
+
+            bool outOfWindow = Stats.sinkVoltage < targetVoltage * 0.95 || Stats.sinkVoltage > targetVoltage * 1.05;
+            bool recover = anomaly->kind == Kind::Dropout || ((anomaly->kind == Kind::Droop || anomaly->kind == Kind::Overvoltage) && outOfWindow);
+            if (!recover) {
+                Tester.logErr() << "Output " << anomaly->kindStr() << " detected: " << Stats.sinkVoltage << "mV, " << Stats.sinkMeasCurrent << "mA";
+            }
 
             // Check if DUT has been disconnected and attempt to reconnect
-            for (int attempts = 0; attempts < 3; ++attempts) {
-                if (!Tester.sink.isConnected()) {
+            bool connected = true;
+            if (anomaly->kind == Kind::Dropout) {
+                connected = co_await t.isConnected();
+                for (int attempts = 0; attempts < 3 && !connected; ++attempts) {
                     Tester.log() << "Attempting to reconnect...";
-                    Tester.sink.reconnect();
+                    note(TelemetryFile::RECONNECT, tester::status{});
+                    connected = co_await t.reconnect();
                 }
-                else break;
             }
-            
+
             // If DUT is still disconnected, terminate test
-            if (!Tester.sink.isConnected()) {
+            if (!connected) {
                 Tester.logErr() << "Could not connect to DUT after 3 attempts. Terminating test...";
-                abortTest();
-            }
-
-            // Check for change in advertised profiles
-            Tester.sink.getProfiles();
-            std::string newProfileStr = getMax(Tester);
-            Tester.log() << "Drop in output detected. Setting new profile...";
-
-            Stats = Tester.setProfile(newProfileStr);
-            std::vector<int> currentState = magic(); // Set new profile
-            int Vt = currentState[0], Vm = currentState[1];
-            Tester.log() << "New profile: " << Tester.sink.profileList[std::stoi(newProfileStr) - 1];
-
-            // Check that profile is set
-            if (Vm > Vt * 0.95 && Vm < Vt * 1.05) {
-                auto resetLoad = [&](std::string iLoad) {
-                    Stats = Tester.setLoad(iLoad, "200", 1000); // Set load
-                    return std::stoi(Stats.sinkMeasCurrent);
-                };
-                
-                iLoad = std::to_string(currentState[2]);
-                Im = resetLoad(iLoad);
-
-                int timerDuration = 5; // seconds
-                for (int t = 0; t < timerDuration; t += 1) {
-                    if (Im > 0) break;
-                    Im = resetLoad(iLoad);
-                } 
-
-                // if (iErr > errLimit) {
-                if (Im == 0) {
-                    Tester.logErr() << "Unable to set load within " << timerDuration << "sec.";
-                    errCount += 1;
-                    errWarning = true;
+                abortReason = "DUT unresponsive.";
+            } else if (recover) {
+                // Check for change in advertised profiles. Only re-select if the advertisement changed
+                std::vector<PdoChange> changes = co_await t.refreshProfiles();
+                if (changes.empty()) {
+                    Tester.log() << "Output " << anomaly->kindStr() << " detected. Advertised profiles unchanged, restoring profile " << activeProfile << "...";
+                } else {
+                    const char* kindStr[] = {"Added", "Removed", "Changed"};
+                    for (const PdoChange& c : changes) {
+                        Tester.log() << kindStr[(int)c.kind] << " profile " << c.index << ": " << ((c.kind == PdoChange::Kind::Removed) ? c.before.line : c.after.line);
+                    }
+
+                    std::string newProfileStr = reselect(Tester, targetVoltage, targetCurrent);
+                    if (!newProfileStr.empty()) activeProfile = newProfileStr;
+                    Tester.log() << "Output " << anomaly->kindStr() << " detected. Setting new profile...";
                 }
 
-            } else {
-                Tester.logErr() << "Unable to set new profile.";
-                errCount += 1;
-                errWarning = true;
+                // A re-advertisement can drop the active profile without offering anything better than 5V
+                if (Tester.sink.pdos.find(activeProfile) == nullptr) {
+                    Tester.logErr() << "Profile " << activeProfile << " is no longer advertised. Terminating test...";
+                    abortReason = "Active profile no longer advertised.";
+                } else {
+                    std::vector<int> currentState = co_await magic(t, activeProfile); // Set profile
+                    int Vt = currentState[0], Vm = currentState[1];
+                    targetVoltage = Vt;
+                    targetCurrent = loadFor(m, currentState[2]);
+                    tester::status selected;
+                    selected.sinkVoltage = Vm;
+                    note(TelemetryFile::PROFILE_CHANGE, selected);
+                    Tester.log() << "New profile: " << Tester.sink.getProfileInfo(activeProfile).line;
+
+                    // Check that profile is set
+                    if (Vm > Vt * 0.95 && Vm < Vt * 1.05) {
+                        std::string iLoad = std::to_string(targetCurrent);
+                        int Im = (co_await t.setLoad(iLoad, "200", milliseconds(1000))).sinkMeasCurrent; // Allow up to 1s to settle
+
+                        int timerDuration = 5; // seconds
+                        for (int sec = 0; sec < timerDuration; sec += 1) {
+                            if (Im > 0) break;
+                            Im = (co_await t.setLoad(iLoad, "200", milliseconds(1000))).sinkMeasCurrent;
+                        }
+
+                        if (Im == 0) {
+                            Tester.logErr() << "Unable to set load within " << timerDuration << "sec.";
+                            errCount += 1;
+                            errWarning = true;
+                        }
+
+                    } else {
+                        Tester.logErr() << "Unable to set new profile.";
+                        errCount += 1;
+                        errWarning = true;
+                    }
+
+                    // Learn the restored output afresh. A condition that persists is reported again after the debounce
+                    detector.setTargets(targetVoltage, targetCurrent);
+                }
             }
         }
 
-        if (errCount >= 3) {
+        if (abortReason == nullptr && errCount >= 3) {
             Tester.logErr() << "DUT failed to respond after " << errCount << " attempts. Terminating test...";
-            abortTest();
+            abortReason = "DUT unresponsive.";
+        }
+
+        if (abortReason != nullptr) {
+            note(TelemetryFile::ABORT, co_await t.unload());
+            run.unloaded = true;
+            throw std::runtime_error(abortReason);
+        }
+
+        // Wait for the next slot on the sample grid, skipping any the iteration overran
+        auto now = Async::now();
+        nextSample += samplePeriod;
+        while (nextSample <= now) {
+            nextSample += samplePeriod;
+            ++skippedSlots;
+        }
+        co_await Async::sleepUntil(nextSample, Tester.token); // Ctrl+C or a retired test ends the wait at once
+    }
+}
+
+// Drop the load after Ctrl+C. Runs under a token nothing can cancel, since this is the command that makes the DUT safe
+Async::Task<tester::status> unloadAfterAbort(Campaign& campaign, Campaign::Member& m) {
+    TokenScope uncancellable(m.Tester, Cancel::Token());
+    tester::status Stats = co_await AsyncTester(m.Tester).unload();
+    campaign.unloaded(m, std::chrono::steady_clock::now());
+    co_return Stats;
+}
+
+// Stress test on 'profileStr' that leaves the DUT unloaded however it's stopped. Its console commands run under the
+// member's job token, so Ctrl+C or retiring the tester kills the command in flight. Every aborted test is then
+// unloaded at once, as the reactor runs them side by side
+Async::Task<void> StressTest(Campaign::Member& m, std::string profileStr, Campaign& campaign) {
+    StressRun run;
+    run.recorder = campaign.recorder;
+    run.testerId = (run.recorder != nullptr) ? run.recorder->addTester(m.Tester.serialNumber) : 0;
+    run.activeProfile = profileStr;
+
+    bool aborted = false;
+    std::exception_ptr failure;
+    try {
+        TokenScope scope(m.Tester, m.job);
+        co_await stressLoop(m, run, campaign.sampling);
+    } catch (const JobCancelled&) {
+        // Tester was unplugged. Nothing to unload through
+        if (!Cancel::global().cancelled()) {
+            run.note(TelemetryFile::ABORT, tester::status{});
+            throw JobCancelled("Tester disconnected.");
+        }
+        aborted = true;
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    if (aborted) {
+        m.Tester.logErr() << "Test aborted.";
+        run.note(TelemetryFile::ABORT, co_await unloadAfterAbort(campaign, m)); // Safety: Unload before exiting
+    } else if (failure) {
+        // Any other error, e.g. a profile lookup throwing mid-recovery, would otherwise leave the DUT loaded
+        if (!run.unloaded) {
+            try {
+                run.note(TelemetryFile::ABORT, co_await AsyncTester(m.Tester).unload());
+            } catch (const std::exception& e) {
+                m.Tester.logErr() << "Unable to unload after error: " << e.what();
+            }
+        }
+        std::rethrow_exception(failure);
+    }
+}
+
+// Runs one campaign member's test and marks the member idle when it ends, however it ends
+Async::Task<void> campaignTest(Campaign& campaign, Campaign::Member& m, std::string profileStr) {
+    struct Finished {
+        Campaign& campaign;
+        Campaign::Member& m;
+        ~Finished() {
+            m.running = false;
+            --campaign.running;
+        }
+    } finished{campaign, m};
+
+    co_await StressTest(m, profileStr, campaign);
+}
+
+void Campaign::start(Member& m, const std::string& profileStr) {
+    m.job = m.Tester.token.child();
+    m.running = true;
+    m.needsTest = false;
+    m.idleLogged = false;
+    ++running;
+    reactor->spawn(campaignTest(*this, m, profileStr), m.Tester.serialNumber);
+}
+
+// Validator sweep of the profiles in 'profileStr'. The sweep makes blocking tester calls, so it runs on a worker
+// thread under the member's job token and the reactor only polls for its result. Ctrl+C or retiring the tester
+// kills the command in flight, after Ctrl+C the worker still unloads the DUT
+Async::Task<void> SweepTest(Campaign::Member& m, std::string profileStr, Campaign& campaign) {
+    tester& Tester = m.Tester;
+    Cancel::Token job = m.job;
+    std::optional<std::chrono::steady_clock::time_point> unloadedAt; // Set by the worker once it unloads after Ctrl+C
+
+    std::future<std::vector<std::string>> sweep = std::async(std::launch::async, [&Tester, job, profileStr, &unloadedAt]() {
+        std::vector<std::string> failed;
+        try {
+            TokenScope scope(Tester, job);
+            for (const std::string& profile : Tester.selectProfiles(profileStr)) {
+                job.throwIfCancelled();
+
+                for (const tester::SweepResult& r : Tester.testProfile(profile)) {
+                    if (!r.voltageSet) { // Already reported by sweepAtVoltage
+                        failed.push_back(r.profile);
+                        continue;
+                    }
+                    Tester.log() << "Profile " << r.profile << " @ " << r.targetVoltage << "mV: "
+                                 << ((r.firstFailCurrent < 0) ? "PASS" : "FAIL") << ", max passing current = " << r.maxPassCurrent
+                                 << "mA of " << r.maxCurrent << "mA (" << r.points.size() << " steps)";
+                    if (r.firstFailCurrent >= 0) failed.push_back(r.profile);
+                }
+            }
+            Tester.unload();
+        } catch (const JobCancelled&) {
+            if (!Cancel::global().cancelled()) throw JobCancelled("Tester disconnected."); // Nothing to unload through
+
+            TokenScope uncancellable(Tester, Cancel::Token());
+            Tester.unload();
+            unloadedAt = std::chrono::steady_clock::now();
+        }
+        return failed;
+    });
+
+    while (sweep.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        // Wakes as soon as the job is cancelled, then polls more often while the worker unloads. The worker stamps
+        // unloadedAt itself, so the poll interval doesn't show in the abort latency
+        if (job.cancelled()) co_await Async::sleepFor(std::chrono::milliseconds(5));
+        else co_await Async::sleepFor(std::chrono::milliseconds(200), job);
+    }
+    std::vector<std::string> failed = sweep.get(); // Rethrows a tester error
+
+    if (unloadedAt) {
+        Tester.logErr() << "Sweep aborted.";
+        campaign.unloaded(m, *unloadedAt);
+        co_return;
+    }
+    if (!failed.empty()) {
+        failed.erase(std::unique(failed.begin(), failed.end()), failed.end());
+        std::string list;
+        for (const std::string& p : failed) list += (list.empty() ? "" : ",") + p;
+        throw std::runtime_error("Sweep failed on profile(s) " + list + ".");
+    }
+}
+
+// Runs one queued job on a campaign member and records how it ended in the queue. A job cut short by an abort or
+// a disconnected tester goes back in the queue for the next idle tester
+Async::Task<void> queuedJob(Campaign& campaign, Campaign::Member& m, DutJob job) {
+    struct Finished {
+        Campaign& campaign;
+        Campaign::Member& m;
+        ~Finished() {
+            m.busy += Async::now() - m.busySince;
+            m.running = false;
+            --campaign.running;
+        }
+    } finished{campaign, m};
+
+    JobQueue& queue = *campaign.queue;
+    try {
+        co_await AsyncTester(m.Tester).refreshProfiles();
+
+        TesterPlan rule = job.rule;
+        rule.serialNumber = m.Tester.serialNumber;
+        std::string profileStr = rule.selectProfiles(m.Tester.sink.pdos);
+        m.Tester.log() << "Starting job " << job.id << ", " << job.kindStr() << " on profile(s) " << profileStr;
+
+        if (job.kind == DutJob::Kind::Stress) {
+            if (profileStr.find(',') != std::string::npos) throw std::runtime_error("(" + m.Tester.serialNumber + ") Job selects more than one profile, a stress test runs one.");
+            m.duration = (rule.durationMinutes > 0) ? std::to_string(rule.durationMinutes) : campaign.duration;
+            m.loadCurrent = rule.loadCurrent;
+            co_await StressTest(m, profileStr, campaign);
+        } else {
+            co_await SweepTest(m, profileStr, campaign);
+        }
+    } catch (const JobCancelled&) {
+        queue.requeue(job.id);
+        throw;
+    } catch (const std::exception& e) {
+        if (Cancel::global().cancelled()) queue.requeue(job.id);
+        else {
+            queue.finish(job.id, DutJob::State::Failed, e.what());
+            ++m.jobsFailed;
+        }
+        throw;
+    }
+
+    // An aborted test returns normally, the job is still unfinished
+    if (Cancel::global().cancelled()) queue.requeue(job.id);
+    else {
+        queue.finish(job.id, DutJob::State::Passed);
+        ++m.jobsPassed;
+    }
+}
+
+void Campaign::start(Member& m, DutJob& job) {
+    queue->start(job, m.Tester.serialNumber);
+    Lease::describe(m.Tester.serialNumber, std::string("batstress ") + job.id + " " + job.kindStr()); // Shown to other tools waiting for it
+    m.job = m.Tester.token.child();
+    m.running = true;
+    m.idleLogged = false;
+    m.busySince = Async::now();
+    ++running;
+    reactor->spawn(queuedJob(*this, m, job), m.Tester.serialNumber + " " + job.id);
+}
+
+void Campaign::unloaded(const Member& m, const std::chrono::steady_clock::time_point& at) {
+    auto latency = at - Cancel::global().cancelledAt();
+    abortLatency.push_back(latency);
+    m.Tester.log() << "Load off " << std::chrono::duration_cast<std::chrono::milliseconds>(latency).count() << "ms after Ctrl+C.";
+}
+
+const char* const HOTPLUG_WATCHER = "hot-plug watcher";
+const char* const DISPATCHER = "job dispatcher";
+
+// Hand pending jobs to idle testers, each tester takes the first job its type can run. The queue file is re-read
+// every 'period' so jobs can be added while testers work, and states are written back as jobs start and end. Ends
+// once nothing is running and no idle tester can take a pending job, unless 'follow' keeps it waiting for more
+Async::Task<void> Dispatcher(Campaign& campaign, std::chrono::seconds period, bool follow) {
+    struct Done {
+        Campaign& campaign;
+        ~Done() { campaign.dispatching = false; }
+    } done{campaign};
+
+    JobQueue& queue = *campaign.queue;
+    bool saveWarned = false;
+
+    while (!Async::cancelled()) {
+        try {
+            queue.reload();
+        } catch (const std::runtime_error& e) {
+            Log::submit(7, true, std::string("WARNING: Job queue not re-read: ") + e.what()); // Jobs already read carry on
+        }
+
+        for (Campaign::Member& m : campaign.members) {
+            if (m.running || m.missing > 0 || m.Tester.isQuarantined()) continue;
+            DutJob* job = queue.next(m.Tester.type);
+            if (job != nullptr) campaign.start(m, *job);
+        }
+
+        if (!queue.save() && !saveWarned) {
+            Log::submit(7, true, "WARNING: Could not write job state " + queue.statePath());
+            saveWarned = true;
+        }
+
+        if (!follow && campaign.running == 0) {
+            size_t left = queue.count(DutJob::State::Pending);
+            if (left > 0) Log::submit(7, true, "WARNING: " + std::to_string(left) + " job(s) left pending, no tester can run them");
+            break;
+        }
+
+        co_await Async::sleepFor(period, Cancel::global());
+    }
+}
+
+// Re-run discovery every 'period' while any test is running. Testers that appear are claimed and start a test on
+// their best profile, or wait for the dispatcher when jobs are queued. Testers missing from two passes in a row have
+// their test retired. Tests already running are left alone
+Async::Task<void> HotPlugWatcher(Campaign& campaign, std::chrono::seconds period) {
+    using namespace std::chrono;
+    auto nextPass = Async::now() + period;
+
+    while ((campaign.running > 0 || campaign.dispatching) && !Async::cancelled()) {
+        // Sleep in short steps so the watcher ends soon after the last test
+        auto now = Async::now();
+        if (now < nextPass) {
+            co_await Async::sleepFor(std::min<steady_clock::duration>(seconds(1), nextPass - now), Cancel::global());
+            continue;
         }
+        while (nextPass <= now) nextPass += period;
+
+        testerList live;
+        try {
+            live = co_await findTestersAsync();
+        } catch (const std::exception& e) {
+            Log::submit(7, true, std::string("WARNING: Tester discovery failed: ") + e.what());
+            continue;
+        }
+
+        // Retire tests on testers that have gone. One missed pass is tolerated
+        for (Campaign::Member& m : campaign.members) {
+            bool present = std::find(live.testers.begin(), live.testers.end(), m.Tester.serialNumber) != live.testers.end();
+            m.missing = (present) ? 0 : m.missing + 1;
+            if (m.running && m.missing == 2) {
+                m.Tester.logErr() << "Tester disconnected. Retiring its test...";
+                m.job.cancel(); // Kills a console command hung on the missing tester
+                m.needsTest = true;
+            }
+        }
+
+        // Claim new testers, and start again on retired ones that came back
+        for (size_t i = 0; i < live.testers.size(); ++i) {
+            Campaign::Member* m = campaign.find(live.testers[i]);
+            if (m != nullptr && (m->running || !m->needsTest || m->Tester.isQuarantined())) continue;
+
+            if (m == nullptr) {
+                tester joining;
+                if (!joining.tryClaim(live.testers[i])) continue; // In use by another process
+                joining.assignType(live.type[i]);
+                if (!joining.startSession()) Log::submit(7, true, "WARNING: No console worker for " + joining.serialNumber + ", spawning per command");
+                m = &campaign.add(std::move(joining));
+                m->Tester.log() << "Tester connected.";
+            }
+            if (campaign.queue != nullptr) continue; // The dispatcher gives it a job
+
+            try {
+                co_await AsyncTester(m->Tester).refreshProfiles();
+            } catch (const std::exception& e) {
+                if (!m->idleLogged) m->Tester.logErr() << "Could not read DUT profiles: " << e.what();
+                m->idleLogged = true;
+                continue;
+            }
 
-        int sleepTime = 30 - duration_cast<seconds>(steady_clock::now() - timerStart).count(); // 30 seconds - time spent in loop iteration
-        for (int i = 0; i < sleepTime; ++i) {
-            if (g_abortRequested.load(std::memory_order_relaxed)) {
-                Tester.unload();
-                throw CtrlCAbort{};
+            std::string profileStr = getMax(m->Tester);
+            if (profileStr.empty()) {
+                if (!m->idleLogged) m->Tester.log() << "No DUT profile above 5V/500mA. Waiting for a DUT...";
+                m->idleLogged = true;
+                continue;
             }
-            Sleep(1000); 
+
+            m->Tester.log() << "Starting test on profile " << profileStr << ": " << m->Tester.sink.getProfileInfo(profileStr).line;
+            campaign.start(*m, profileStr);
         }
     }
 }
 
-int main() {
+// PASSMARK_HOTPLUG_SECONDS between discovery passes, 15 by default. 0 turns the watcher off
+std::chrono::seconds hotPlugPeriod() {
+    const char* period = getenv("PASSMARK_HOTPLUG_SECONDS");
+    return std::chrono::seconds((period != nullptr && *period != '\0' && is_numeric(period)) ? atoi(period) : 15);
+}
+
+// Job queue file from "--queue <file>" or PASSMARK_QUEUE, empty if neither is set
+std::string queuePath(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--queue") return argv[i + 1];
+    }
+
+    const char* path = getenv("PASSMARK_QUEUE");
+    return (path != nullptr) ? path : "";
+}
+
+// Share of each member's time in the campaign spent running queued jobs
+void reportUtilization(const Campaign& campaign) {
+    using namespace std::chrono;
+    auto now = campaign.reactor->now(); // Same clock the busy times were taken on
+
+    std::cout << "\nTester utilization:" << std::endl;
+    for (const Campaign::Member& m : campaign.members) {
+        auto span = now - m.joined;
+        long long total = duration_cast<seconds>(span).count();
+        double share = (span.count() > 0) ? 100.0 * m.busy.count() / span.count() : 0.0;
+
+        std::cout << m.Tester.serialNumber << " (" << m.Tester.type << "): " << std::fixed << std::setprecision(0) << share << "% busy over "
+                  << total / 3600 << ":" << std::setfill('0') << std::setw(2) << (total / 60) % 60 << ":" << std::setw(2) << total % 60
+                  << std::setfill(' ') << ", " << m.jobsPassed + m.jobsFailed << " job(s) (" << m.jobsPassed << " passed, "
+                  << m.jobsFailed << " failed)";
+        if (m.Tester.timeouts.load() > 0) std::cout << ", " << m.Tester.timeouts.load() << " console timeout(s)";
+        if (m.Tester.isQuarantined()) std::cout << ", QUARANTINED";
+        std::cout << std::endl;
+    }
+}
+
+// How quickly Ctrl+C brought every tester to a safe state
+void reportAbortLatency(const Campaign& campaign) {
+    using namespace std::chrono;
+    if (campaign.abortLatency.empty()) return;
+
+    steady_clock::duration total{0}, worst{0};
+    for (const steady_clock::duration& d : campaign.abortLatency) {
+        total += d;
+        worst = std::max(worst, d);
+    }
+
+    auto ms = [](const steady_clock::duration& d) { return duration_cast<duration<double, std::milli>>(d).count(); };
+    std::cout << "\nAbort to safe state: " << campaign.abortLatency.size() << " tester(s) unloaded, mean " << std::fixed << std::setprecision(1)
+              << ms(total / (long long)campaign.abortLatency.size()) << "ms, max " << ms(worst) << "ms" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    DiscoveryScope discovery; // Background tester discovery is cancelled and joined however main() returns
     std::vector<tester> validTesters; // Initialize tester object(s)
 
     if (!SetConsoleCtrlHandler(CtrlHandler, TRUE)) { // Register control handler to handle Ctrl+C
@@ -243,20 +791,75 @@ int main() {
     }
 
     try {
-        validTesters = getTesters();
+        // PASSMARK_RECORD / PASSMARK_REPLAY select record or offline replay of console traffic
+        if (!Capture::startFromEnvironment()) throw std::runtime_error("Could not open console capture file.");
+
+        // Testers can take their work from a job queue instead of running one test each
+        std::string queueFile = queuePath(argc, argv);
+        std::unique_ptr<JobQueue> queue;
+        if (!queueFile.empty()) {
+            queue = std::make_unique<JobQueue>(queueFile);
+            queue->reload(); // A broken queue file stops the run before any tester is touched
+            std::cout << "Dispatching " << queue->count(DutJob::State::Pending) << " pending job(s) from " << queueFile << std::endl;
+        }
 
-        // User specifies time limit for test
-        std::cout << "Enter test duration in minutes. Default is 120m.\n\nTest duration:\t";
+        // With a plan file nothing is asked, otherwise the operator picks testers, duration and profiles
+        std::string planFile = planPath(argc, argv);
+        std::vector<TesterPlan> assigned;
         std::string duration = "";
-        getline(std::cin, duration);
-        if (duration.empty() || !is_numeric(duration)) duration = "120";
+        if (!planFile.empty()) {
+            TestPlan plan = TestPlan::load(planFile);
+            validTesters = getPlannedTesters(plan, assigned);
+            duration = std::to_string(plan.durationMinutes);
+        } else {
+            validTesters = getTesters();
 
-        // Create a thread for each tester to run tests simultaneously
-        std::vector<HANDLE> threadHandles;
-        int colorIdx = 0;
-        for (auto& Tester : validTesters) {
-            Tester.consoleColor = colors[colorIdx % 4]; // Assign a unique color
-            ++colorIdx;
+            // User specifies time limit for test. Queued jobs carry their own
+            if (queue) duration = "120";
+            else {
+                std::cout << "Enter test duration in minutes. Default is 120m.\n\nTest duration:\t";
+                getline(std::cin, duration);
+            }
+            if (duration.empty() || !is_numeric(duration)) duration = "120";
+        }
+
+        // Samples and events for this run. Testing goes ahead without them if the file can't be created
+        SamplingConfig sampling = SamplingConfig::fromEnvironment();
+        std::unique_ptr<TelemetryRecorder> recorder;
+        try {
+            recorder = std::make_unique<TelemetryRecorder>(telemetryPath());
+            std::cout << "Recording telemetry to " << recorder->path() << std::endl;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "WARNING: " << e.what() << ". Telemetry will not be recorded." << std::endl;
+        }
+
+        Campaign campaign;
+        campaign.duration = duration;
+        campaign.sampling = sampling;
+        campaign.recorder = recorder.get();
+        campaign.queue = queue.get();
+
+        // Create a test coroutine for each tester, all run on one reactor
+        Async::Reactor reactor;
+        campaign.reactor = &reactor;
+        if (Capture::isReplaying() && !Capture::isRealTime()) reactor.useVirtualClock(); // Recorded hours replay in seconds
+        reactor.completions().onComplete([](const JobOutcome& outcome) { // Report each tester as soon as it finishes
+            if (outcome.name != HOTPLUG_WATCHER && outcome.name != DISPATCHER) reportOutcome(outcome);
+        });
+
+        // Queued jobs choose their own profiles when a tester picks them up
+        if (queue) {
+            for (tester& Tester : validTesters) campaign.add(std::move(Tester));
+            validTesters.clear();
+
+            const char* follow = getenv("PASSMARK_QUEUE_FOLLOW");
+            campaign.dispatching = true;
+            reactor.spawn(Dispatcher(campaign, std::chrono::seconds(2), follow != nullptr && std::string(follow) == "1"), DISPATCHER);
+        }
+
+        for (size_t t = 0; t < validTesters.size(); ++t) {
+            Campaign::Member& member = campaign.add(std::move(validTesters[t]));
+            tester& Tester = member.Tester;
 
             std::cout << "\nTester: " << Tester.serialNumber << "\n--------------------------" << std::endl;
 
@@ -265,16 +868,24 @@ int main() {
              */
 
             Tester.sink.getProfiles();
-            int numProfiles = Tester.sink.profileList.size();
+            int numProfiles = Tester.sink.pdos.size();
             if (numProfiles == 0) throw std::runtime_error("No DUT found."); // Check if no profiles are found
 
             std::cout << "NUM PROFILES:" << numProfiles << std::endl;
-            for (std::string s : Tester.sink.profileList) std::cout << s << std::endl;
+            for (const Pdo& pdo : Tester.sink.pdos.entries()) std::cout << pdo.line << std::endl;
 
-            // Ask user which profile to test
-            std::cout << "\nSelect profile to test or press enter for auto select:\t";
+            // Ask user which profile to test, unless the plan says
             std::string profileStr = "";
-            getline(std::cin, profileStr);
+            if (!assigned.empty()) {
+                profileStr = assigned[t].selectProfiles(Tester.sink.pdos);
+                if (profileStr.find(',') != std::string::npos) throw std::runtime_error("(" + Tester.serialNumber + ") Plan selects more than one profile, a stress test runs one.");
+                member.duration = std::to_string(assigned[t].durationMinutes);
+                member.loadCurrent = assigned[t].loadCurrent;
+                std::cout << "Planned profile " << profileStr << ", " << member.duration << "min" << std::endl;
+            } else {
+                std::cout << "\nSelect profile to test or press enter for auto select:\t";
+                getline(std::cin, profileStr);
+            }
 
             // Check if profileStr is valid
             if (profileStr.empty()) {
@@ -282,41 +893,44 @@ int main() {
                 std::cout << "Profile " << profileStr << " selected." << std::endl;
             }
             else if (!is_numeric(profileStr)) throw std::runtime_error("Profile selection must be an integer!");
-            int profileNum = std::stoi(profileStr);
-            if (profileNum < 1 || profileNum > numProfiles) throw std::runtime_error("Selected profile is out of range!");
-
-            // Create thread in suspended state
-            HANDLE hThread = Bridge::startSuspended([&Tester, &profileStr, &duration]() {
-                StressTest(Tester, profileStr, duration);
-            });
+            if (Tester.sink.pdos.find(profileStr) == nullptr) throw std::runtime_error("Selected profile is out of range!");
 
-            // Check that handle isn't NULL
-            if (hThread != NULL) threadHandles.push_back(hThread);
-            else std::cerr << "Failed to create thread for tester. Error: " << GetLastError() << std::endl;
+            // Coroutine keeps its own copy of the selection, profileStr goes out of scope before it runs
+            campaign.start(member, profileStr);
         }
 
-        // Start threads once preparations are made
-        for (HANDLE h : threadHandles) {
-            if (h != NULL && h != INVALID_HANDLE_VALUE) ResumeThread(h);
+        // Testers plugged in mid-run join the campaign
+        std::chrono::seconds watchPeriod = hotPlugPeriod();
+        if (watchPeriod.count() > 0) reactor.spawn(HotPlugWatcher(campaign, watchPeriod), HOTPLUG_WATCHER);
+
+        // Halt main program until tests are finished. Ctrl+C cancels the reactor so every test unloads, and wakes it
+        // so the unloads start straight away
+        Cancel::Registration wakeOnAbort = Cancel::global().onCancel([&reactor]() { reactor.wake(); });
+        reactor.run(&g_abortRequested);
+        if (recorder) recorder->flush();
+        Log::flush(); // Let queued tester output reach the console before anything else is printed
+
+        Log::Stats logStats = Log::stats();
+        if (logStats.dropped > 0 || logStats.delayed > 0) {
+            Log::submit(7, true, "WARNING: Log dropped " + std::to_string(logStats.dropped) + " and delayed " + std::to_string(logStats.delayed) +
+                        " of " + std::to_string(logStats.written + logStats.dropped) + " lines");
+            Log::flush();
         }
 
-        // Halt main program until threads are finished
-        DWORD waitResult = WaitForMultipleObjects(
-            (DWORD)threadHandles.size(),
-            threadHandles.data(),
-            TRUE,
-            9e6 // 2.5hr time limit
-        );
-
-        if (waitResult == WAIT_TIMEOUT || waitResult == WAIT_FAILED) throw std::runtime_error("One or more threads failed.");
+        if (queue) {
+            if (!queue->save()) std::cerr << "WARNING: Could not write job state " << queue->statePath() << std::endl;
+            reportUtilization(campaign);
+        }
+        reportAbortLatency(campaign);
 
-        // Close handles
-        for (HANDLE h : threadHandles) CloseHandle(h);
-        threadHandles.clear();
+        if (g_abortRequested.load()) throw CtrlCAbort{};
+        if (reactor.failures() > 0) throw std::runtime_error("Test failed on " + reactor.completions().failedNames());
     } catch (const std::runtime_error& e) {
+        Log::flush();
         std::cerr << "Error: " << e.what() << std::endl;
         return -1;
     } catch (const CtrlCAbort& e) {
+        Log::flush();
         std::cerr << "Error: " << e.what() << std::endl;
         return -1;
     }
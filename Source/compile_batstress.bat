@@ -1 +1 @@
-g++ -std=c++11 batstress.cpp Passmark.cpp tester.cpp -o ../batstress.exe
\ No newline at end of file
+g++ -std=c++20 batstress.cpp Passmark.cpp tester.cpp ConsoleSession.cpp ProcessSpawn.cpp Telemetry.cpp PdoTable.cpp ConsoleCapture.cpp Inventory.cpp TestPlan.cpp Scheduler.cpp Completion.cpp AsyncLog.cpp Reactor.cpp AsyncTester.cpp TelemetryRecorder.cpp SampleRing.cpp AnomalyDetector.cpp JobQueue.cpp LeaseTable.cpp CancelToken.cpp -o ../batstress.exe
\ No newline at end of file
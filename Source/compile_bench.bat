@@ -0,0 +1,9 @@
+if not exist ..\bench mkdir ..\bench
+g++ -std=c++20 -O2 Bench/bench_worker.cpp tester.cpp ConsoleSession.cpp ProcessSpawn.cpp Telemetry.cpp PdoTable.cpp ConsoleCapture.cpp AsyncLog.cpp LeaseTable.cpp CancelToken.cpp -o ../bench/bench_worker.exe
+g++ -std=c++20 -O2 Bench/bench_parse.cpp Telemetry.cpp -o ../bench/bench_parse.exe
+g++ -std=c++20 -O2 Bench/bench_completion.cpp Scheduler.cpp Reactor.cpp Completion.cpp CancelToken.cpp ProcessSpawn.cpp -o ../bench/bench_completion.exe
+g++ -std=c++20 -O2 Bench/bench_timeout.cpp ProcessSpawn.cpp Reactor.cpp CancelToken.cpp Completion.cpp -o ../bench/bench_timeout.exe
+g++ -std=c++20 -O2 Bench/bench_abort.cpp ProcessSpawn.cpp Reactor.cpp CancelToken.cpp Completion.cpp -o ../bench/bench_abort.exe
+g++ -std=c++20 -O2 Bench/bench_sim.cpp tester.cpp ConsoleSession.cpp ProcessSpawn.cpp Telemetry.cpp PdoTable.cpp ConsoleCapture.cpp AsyncLog.cpp LeaseTable.cpp CancelToken.cpp Scheduler.cpp Completion.cpp -o ../bench/bench_sim.exe
+g++ -std=c++20 -O2 Bench/bench_sched.cpp Scheduler.cpp Completion.cpp -o ../bench/bench_sched.exe
+g++ -std=c++20 -O2 Bench/bench_telemetry.cpp TelemetryRecorder.cpp -o ../bench/bench_telemetry.exe
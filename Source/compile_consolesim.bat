@@ -0,0 +1,2 @@
+if not exist ..\sim mkdir ..\sim
+g++ -std=c++20 -O2 consolesim.cpp -o ../sim/USBPDPROConsole.exe && copy /Y ..\sim\USBPDPROConsole.exe ..\sim\USBPDConsole.exe
\ No newline at end of file
@@ -1 +1 @@
-g++ -std=c++11 usbvalidator.cpp Passmark.cpp tester.cpp -o ../usbvalidator.exe
\ No newline at end of file
+g++ -std=c++20 usbvalidator.cpp Passmark.cpp tester.cpp ConsoleSession.cpp ProcessSpawn.cpp Telemetry.cpp PdoTable.cpp ConsoleCapture.cpp Inventory.cpp TestPlan.cpp Scheduler.cpp Completion.cpp AsyncLog.cpp LeaseTable.cpp CancelToken.cpp -o ../usbvalidator.exe
\ No newline at end of file
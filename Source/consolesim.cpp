@@ -0,0 +1,363 @@
+/**
+ * Stand-in for USBPDConsole.exe / USBPDPROConsole.exe backed by a simulated DUT.
+ *
+ * Answers the switches the tools use (-f, -d, -p, -s, -c, -b, -v, -l) with the same field labels as the
+ * real consoles. The tester family follows the program name: anything containing "PRO" acts as a PM240,
+ * otherwise a PM125. Each invocation is a separate process, so every virtual tester keeps its state in
+ * consolesim_<SN>.state in the simulation directory ($PASSMARK_SIM_DIR, default current directory).
+ *
+ * The DUT model is read from consolesim.ini in the same directory:
+ *
+ *     pm240 = 64                  # Number of virtual PM240 testers (SIM240-0001 ...)
+ *     pm125 = 0                   # Number of virtual PM125 testers (SIM125-0001 ...)
+ *     pdos = PD-FIXED:5000:3000, PD-FIXED:9000:3000, PD-FIXED:20000:3250, PD-PPS:3300-21000:3000
+ *     settle_ms = 300             # Time for voltage and current to settle after a change
+ *     droop_mv_per_a = 100        # Output droop under load
+ *     noise = 10                  # Peak mV/mA noise on readings
+ *     foldback = 1.1              # Trip when load exceeds this multiple of the profile's max current
+ *     disconnect_rate = 0.001     # Chance per status read that the DUT drops out and renegotiates 5V
+ *     seed = 1                    # Noise and disconnects are a deterministic function of seed, SN and read count
+ *
+ *     [SIM240-0003]               # Keys after a [SN] header only apply to that tester
+ *     disconnect_rate = 0.05
+ *
+ * Build (Linux): g++ -std=c++17 -O2 consolesim.cpp -o USBPDPROConsole && ln -s USBPDPROConsole USBPDConsole
+ * Then point the tools at it with PASSMARK_CONSOLE_DIR.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SimPdo {
+    std::string type;
+    int minVoltage;
+    int maxVoltage;
+    int maxCurrent;
+};
+
+struct Model {
+    std::vector<SimPdo> pdos;
+    int settleMs = 300;
+    int droop = 100;
+    int noise = 10;
+    double foldback = 1.1;
+    double disconnectRate = 0.0;
+    uint64_t seed = 1;
+};
+
+// Everything that has to survive between console invocations
+struct State {
+    int profile = 1;
+    int targetVoltage = 5000;
+    int startVoltage = 5000;    // Voltage when the last profile change began
+    long long profileTime = 0;  // ms
+    int setCurrent = 0;
+    int startCurrent = 0;       // Measured current when the last load change began
+    long long loadTime = 0;     // ms
+    bool connected = true;
+    bool tripped = false;
+    uint64_t reads = 0;         // Status reads so far, drives the noise sequence
+};
+
+long long nowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+std::string trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\r");
+    return s.substr(a, b - a + 1);
+}
+
+std::string simDir() {
+    const char* dir = getenv("PASSMARK_SIM_DIR");
+    return (dir && *dir) ? std::string(dir) + "/" : "";
+}
+
+// splitmix64, good enough for deterministic noise
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hashStr(const std::string& s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : s) h = (h ^ (unsigned char)c) * 1099511628211ULL;
+    return h;
+}
+
+std::vector<SimPdo> parsePdos(const std::string& spec) {
+    std::vector<SimPdo> pdos;
+    std::stringstream ss(spec);
+    std::string item;
+    while (getline(ss, item, ',')) {
+        item = trim(item);
+        size_t c1 = item.find(':'), c2 = item.rfind(':');
+        if (c1 == std::string::npos || c1 == c2) continue;
+
+        SimPdo pdo;
+        pdo.type = item.substr(0, c1);
+        std::string v = item.substr(c1 + 1, c2 - c1 - 1);
+        size_t dash = v.find('-');
+        pdo.minVoltage = std::atoi(v.substr(0, dash).c_str());
+        pdo.maxVoltage = (dash == std::string::npos) ? pdo.minVoltage : std::atoi(v.substr(dash + 1).c_str());
+        pdo.maxCurrent = std::atoi(item.substr(c2 + 1).c_str());
+        pdos.push_back(pdo);
+    }
+    return pdos;
+}
+
+// Read global keys and the keys of this tester's [SN] section
+void loadConfig(const std::string& sn, int& pm240, int& pm125, Model& model) {
+    model.pdos = parsePdos("PD-FIXED:5000:3000, PD-FIXED:9000:3000, PD-FIXED:15000:3000, PD-FIXED:20000:3250, PD-PPS:3300-21000:3000");
+
+    std::ifstream in(simDir() + "consolesim.ini");
+    std::string line, section;
+    while (getline(in, line)) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        if (line.front() == '[' && line.back() == ']') {
+            section = line.substr(1, line.size() - 2);
+            continue;
+        }
+        if (!section.empty() && section != sn) continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = trim(line.substr(0, eq)), value = trim(line.substr(eq + 1));
+
+        if (key == "pm240") pm240 = std::atoi(value.c_str());
+        else if (key == "pm125") pm125 = std::atoi(value.c_str());
+        else if (key == "pdos") model.pdos = parsePdos(value);
+        else if (key == "settle_ms") model.settleMs = std::max(1, std::atoi(value.c_str()));
+        else if (key == "droop_mv_per_a") model.droop = std::atoi(value.c_str());
+        else if (key == "noise") model.noise = std::atoi(value.c_str());
+        else if (key == "foldback") model.foldback = std::atof(value.c_str());
+        else if (key == "disconnect_rate") model.disconnectRate = std::atof(value.c_str());
+        else if (key == "seed") model.seed = std::strtoull(value.c_str(), NULL, 10);
+    }
+}
+
+std::string statePath(const std::string& sn) {
+    return simDir() + "consolesim_" + sn + ".state";
+}
+
+State loadState(const std::string& sn) {
+    State st;
+    st.profileTime = st.loadTime = nowMs();
+
+    std::ifstream in(statePath(sn));
+    in >> st.profile >> st.targetVoltage >> st.startVoltage >> st.profileTime >> st.setCurrent
+       >> st.startCurrent >> st.loadTime >> st.connected >> st.tripped >> st.reads;
+    return st;
+}
+
+void saveState(const std::string& sn, const State& st) {
+    // Write then rename so a crash never leaves a half-written state file
+    std::string path = statePath(sn), tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << st.profile << ' ' << st.targetVoltage << ' ' << st.startVoltage << ' ' << st.profileTime << ' '
+            << st.setCurrent << ' ' << st.startCurrent << ' ' << st.loadTime << ' ' << st.connected << ' '
+            << st.tripped << ' ' << st.reads << '\n';
+    }
+    std::remove(path.c_str());
+    std::rename(tmp.c_str(), path.c_str());
+}
+
+// First-order approach from 'from' to 'to', ~98% of the way after settleMs
+int approach(int from, int to, long long elapsed, int settleMs) {
+    double tau = settleMs / 4.0;
+    return (int)std::lround(to + (from - to) * std::exp(-(double)std::max(0LL, elapsed) / tau));
+}
+
+// Voltage and current without droop or noise at time t
+void rails(const State& st, const Model& model, long long t, int& voltage, int& current) {
+    if (!st.connected) {
+        voltage = current = 0;
+        return;
+    }
+    voltage = approach(st.startVoltage, st.targetVoltage, t - st.profileTime, model.settleMs);
+    current = (st.tripped) ? 0 : approach(st.startCurrent, st.setCurrent, t - st.loadTime, model.settleMs);
+}
+
+void renegotiate(State& st, long long t) {
+    st.profile = 1;
+    st.startVoltage = 0;
+    st.targetVoltage = 5000;
+    st.profileTime = t;
+    st.tripped = false;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string self = (argc > 0) ? argv[0] : "";
+    bool isPM240 = self.find("PRO") != std::string::npos;
+    const char* family = (isPM240) ? "SIM240-" : "SIM125-";
+
+    // Find selected tester first, config sections depend on it
+    std::string sn;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "-d") sn = argv[i + 1];
+    }
+
+    int pm240 = 8, pm125 = 0;
+    Model model;
+    loadConfig(sn, pm240, pm125, model);
+    int count = (isPM240) ? pm240 : pm125;
+
+    auto serial = [&](int n) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s%04d", family, n);
+        return std::string(buf);
+    };
+
+    // Tester discovery doesn't need a device
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) != "-f") continue;
+        std::cout << "NUM DEVICES:" << count << "\n";
+        for (int n = 1; n <= count; ++n) std::cout << "DEVICE " << n << " SERIAL=" << serial(n) << "\n";
+        return 0;
+    }
+
+    // Default to the first tester when no -d is given, like a single attached unit
+    if (sn.empty()) sn = serial(1);
+    bool known = false;
+    for (int n = 1; n <= count && !known; ++n) known = (serial(n) == sn);
+    if (!known) {
+        std::cout << "ERROR: Device " << sn << " not found\n";
+        return 1;
+    }
+
+    if (model.pdos.empty()) {
+        std::cout << "ERROR: No profiles configured for " << sn << "\n";
+        return 1;
+    }
+
+    State st = loadState(sn);
+    long long t = nowMs();
+
+    // State saved under a longer pdos list, fall back to 5V as a re-plugged DUT would
+    if (st.profile < 1 || st.profile > (int)model.pdos.size()) renegotiate(st, t);
+    const char* prefix = (isPM240) ? "SINK " : "";
+    const uint64_t stream = mix(model.seed ^ hashStr(sn));
+
+    for (int i = 1; i < argc; ++i) {
+        std::string sw = argv[i];
+        std::string arg = (i + 1 < argc) ? argv[i + 1] : "";
+
+        if (sw == "-d") {
+            ++i;
+        } else if (sw == "-p") {
+            if (!st.connected) {
+                std::cout << "NUM PROFILES:0\n";
+                continue;
+            }
+            std::cout << "NUM PROFILES:" << model.pdos.size() << "\n";
+            for (size_t n = 0; n < model.pdos.size(); ++n) {
+                const SimPdo& p = model.pdos[n];
+                std::cout << "INDEX:" << n + 1 << ", TYPE:" << p.type << ", V:" << p.minVoltage;
+                if (p.maxVoltage != p.minVoltage) std::cout << "-" << p.maxVoltage;
+                std::cout << "mV, I:" << p.maxCurrent << "mA\n";
+            }
+        } else if (sw == "-s" || sw == "-c") {
+            // Random drop-out, DUT comes back on 5V once the sink reconnects
+            ++st.reads;
+            double roll = (mix(stream + st.reads * 2) >> 11) * (1.0 / 9007199254740992.0);
+            if (st.connected && roll < model.disconnectRate) {
+                st.connected = false;
+                st.startCurrent = 0;
+                st.loadTime = t;
+            }
+
+            std::cout << prefix << "STATUS: " << (st.connected ? "CONNECTED" : "NOT CONNECTED") << "\n";
+            if (sw == "-c") continue;
+
+            int v, c;
+            rails(st, model, t, v, c);
+            int n = (int)(mix(stream + st.reads * 2 + 1) % (2 * model.noise + 1)) - model.noise;
+            if (c > 0) c = std::max(0, c + n);
+            if (v > 0) v = std::max(0, v - model.droop * c / 1000 + n);
+
+            std::cout << prefix << "VOLTAGE:" << v << "mV\n";
+            std::cout << prefix << "SET CURRENT:" << st.setCurrent << "mA\n";
+            std::cout << prefix << "MEASURED CURRENT:" << c << "mA\n";
+        } else if (sw == "-b") {
+            ++i;
+            bool close = !arg.empty() && arg.back() == '1';
+            if (close && !st.connected) {
+                st.connected = true;
+                renegotiate(st, t);
+            } else if (!close) {
+                st.connected = false;
+            }
+            std::cout << "OK\n";
+        } else if (sw == "-v") {
+            ++i;
+            size_t comma = arg.find(',');
+            int idx = std::atoi(arg.substr(0, comma).c_str());
+            if (idx < 1 || idx > (int)model.pdos.size() || !st.connected) {
+                std::cout << "ERROR: Invalid profile\n";
+                continue;
+            }
+
+            const SimPdo& p = model.pdos[idx - 1];
+            int target = (comma == std::string::npos) ? p.maxVoltage : std::atoi(arg.substr(comma + 1).c_str());
+            if (target < p.minVoltage || target > p.maxVoltage) {
+                std::cout << "ERROR: Voltage out of range\n";
+                continue;
+            }
+
+            int v, c;
+            rails(st, model, t, v, c);
+            st.profile = idx;
+            st.startVoltage = v;
+            st.targetVoltage = target;
+            st.profileTime = t;
+            st.tripped = false;
+            std::cout << "OK\n";
+        } else if (sw == "-l") {
+            ++i;
+            if (st.profile < 1 || st.profile > (int)model.pdos.size()) {
+                std::cout << "ERROR: Invalid profile\n";
+                continue;
+            }
+
+            int v, c;
+            rails(st, model, t, v, c);
+            st.startCurrent = c;
+            st.setCurrent = std::atoi(arg.c_str());
+            st.loadTime = t;
+
+            // Overload trips the source, which drops back to 5V
+            const SimPdo& p = model.pdos[st.profile - 1];
+            bool overload = st.setCurrent > p.maxCurrent * model.foldback;
+            if (overload) renegotiate(st, t);
+            st.tripped = overload;
+            std::cout << "OK\n";
+        } else {
+            std::cout << "ERROR: Unknown switch " << sw << "\n";
+            saveState(sn, st);
+            return 1;
+        }
+    }
+
+    saveState(sn, st);
+    return 0;
+}
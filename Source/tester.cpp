@@ -1,4 +1,7 @@
 #include "tester.hpp"
+#include "ConsoleCapture.hpp"
+#include "AsyncLog.hpp"
+#include "LeaseTable.hpp"
 
 #include <Windows.h>
 #include <iostream>
@@ -7,35 +10,37 @@
 #include <stdexcept>
 #include <vector>
 #include <utility>
-
-testerList findTesters() {
-    testerList list;
-    tester virtualtester;
-
-    // Lambda to handle tester polling and storing info
-    auto poll = [&](const std::string& testerType) {
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <future>
+#include <filesystem>
+
+testerList findTesters(const bool& toConsole, const Cancel::Token& token) {
+    // Poll one tester family. Each family has its own virtual tester, so both polls can run at once
+    auto poll = [&token](const std::string& testerType) {
+        tester virtualtester;
         virtualtester.assignType(testerType);
-        std::string output = runCommand(virtualtester, "-f");
-        removeBlankLines(output);
-        std::cout << testerType << " testers:\n";
-        std::stringstream ss(output);
-        std::string line;
-        while (getline(ss, line)) {
-            size_t pos = line.find("=");
-            if (pos != std::string::npos) {
-                list.type.push_back(testerType);
-                std::string tempStr = line.substr(pos + 1);
-                list.testers.push_back(tempStr);
-                std::cout << "(" << list.testers.size() << ") " << output << std::endl;
-            }
-        }
+        virtualtester.token = token.child();
+        return parseTesterList(runCommand(virtualtester, "-f"));
     };
 
-    // Poll PM240 testers
-    poll("PM240");
+    // Poll PM125 testers in the background while PM240 testers are polled here
+    std::future<std::vector<std::string>> pm125 = std::async(std::launch::async, poll, std::string("PM125"));
+    std::vector<std::string> pm240 = poll("PM240");
 
-    //Poll PM125 testers
-    poll("PM125");
+    // Merge, PM240 first so numbering matches a sequential poll
+    testerList list;
+    for (const auto& [testerType, found] : {std::pair<std::string, std::vector<std::string>>{"PM240", pm240}, {"PM125", pm125.get()}}) {
+        if (toConsole) std::cout << testerType << " testers:\n";
+        for (const std::string& sn : found) {
+            list.type.push_back(testerType);
+            list.testers.push_back(sn);
+            if (toConsole) std::cout << "(" << list.testers.size() << ") " << sn << std::endl;
+        }
+    }
 
     // Check if no testers were found
     if (list.testers.empty()) throw std::runtime_error("No testers found.");
@@ -43,25 +48,24 @@ testerList findTesters() {
     return list;
 }
 
+std::vector<std::string> parseTesterList(std::string output) {
+    removeBlankLines(output);
+
+    std::vector<std::string> found;
+    std::stringstream ss(output);
+    std::string line;
+    while (getline(ss, line)) {
+        size_t pos = line.find("=");
+        if (pos != std::string::npos) found.push_back(line.substr(pos + 1));
+    }
+    return found;
+}
+
 /**
  * tester::Sink class member function definitions
  */
 bool tester::Sink::isConnected() const {
-    std::stringstream ss(runCommand(this->tRef, "-c"));
-    std::string line;
-    getline(ss, line, '\n');
-
-    auto helper = [&](std::string s) {
-        size_t pos = line.find(s);
-        if (pos != std::string::npos) {
-            return (line.find("NOT CONNECTED"), pos) ? true : false;
-        } else {
-            throw std::runtime_error("(" + this->tRef.serialNumber + ") Tester failed to respond.");
-        }
-    };
-
-    if (this->tRef.isPM125()) return helper("STATUS:");
-    if (this->tRef.isPM240()) return helper("SINK STATUS:");
+    return this->tRef.parseConnection(runCommandView(this->tRef, "-c"));
 }
 
 void tester::Sink::connect() const {
@@ -74,76 +78,69 @@ void tester::Sink::disconnect() const {
     if (this->tRef.isPM240()) runCommand(this->tRef, "-b 1,0");
 }
 
-void tester::Sink::reconnect() const {
-    this->disconnect();
-    this->connect(); 
+bool tester::Sink::reconnect() const {
+    // Both toggles and the check go out in one round trip
+    tester::CommandBatch batch = this->tRef.batch();
+    return batch.disconnect().connect().isConnected().run().back().connected;
 }
 
 void tester::Sink::getProfiles() {
-    std::string output = runCommand(this->tRef, "-p");
+    std::string_view output = runCommandView(this->tRef, "-p");
     if (output.empty()) {
         std::string errorMsg = (this->tRef.serialNumber.empty()) ? "" : "(" + this->tRef.serialNumber + ") ";
         throw std::runtime_error(errorMsg + "No response from tester.");
     }
 
-    removeBlankLines(output);
+    this->pdos = PdoTable::parse(output);
+}
 
-    std::stringstream ss(output);
-    std::string line;
-    while (getline(ss, line, '\n')) {
-        size_t pos;
-        if (line.find("INDEX:") != std::string::npos) this->profileList.push_back(line);
-    }
-}
-
-tester::Sink::ProfileInfo tester::Sink::getProfileInfo(const std::string& profile) const {
-    ProfileInfo info;
-    std::string searchStr = "INDEX:" + profile;
-    std::string profileStr = this->profileList[std::stoi(profile) - 1]; // DON'T LEAVE LIKE THIS!
-    size_t foundPos = profileStr.find(searchStr);
-    if (foundPos != std::string::npos) { // match for searchStr was found
-        size_t tPos1 = profileStr.find("TYPE:", foundPos) + 5;
-        std::string type = "";
-        size_t p = tPos1;
-        while (profileStr[p] != ',') {
-            type.push_back(profileStr[p]);
-            if (p < profileStr.size()) p += 1;
-        }
+std::vector<PdoChange> tester::Sink::refreshProfiles() {
+    return this->applyProfiles(runCommandView(this->tRef, "-p"));
+}
 
-        // Set variable voltage flag if detected
-        for (std::string s : VariableVoltageTypes) {
-            if (type == s) info.isVariableVoltage = true;
-        }
+std::vector<PdoChange> tester::Sink::applyProfiles(std::string_view output) {
+    if (output.empty()) throw std::runtime_error("(" + this->tRef.serialNumber + ") No response from tester.");
 
-        // Populate voltage range
-        size_t vPos1 = profileStr.find("V:", foundPos) + 2;
-        size_t vPos2 = profileStr.find("mV", foundPos);
-        info.voltageRange = profileStr.substr(vPos1, vPos2 - vPos1);
+    PdoTable latest = PdoTable::parse(output);
+    std::vector<PdoChange> changes = this->pdos.diff(latest);
+    if (!changes.empty()) this->pdos = std::move(latest);
 
-        // Populate max current
-        size_t iPos1 = profileStr.find("I:", foundPos) + 2;
-        size_t iPos2 = profileStr.find("mA", foundPos);
-        info.maxCurrent = profileStr.substr(iPos1, iPos2 - iPos1);
-    } else throw std::runtime_error("(" + this->tRef.serialNumber + ") Profile not found.");
+    return changes;
+}
 
-    return info;
+const Pdo& tester::Sink::getProfileInfo(const std::string& profile) const {
+    const Pdo* pdo = this->pdos.find(std::string_view(profile));
+    if (pdo == nullptr) throw std::runtime_error("(" + this->tRef.serialNumber + ") Profile not found.");
+    return *pdo;
 }
 
 /**
  * tester constructor definitions
  */
-tester::tester() : hMutex(NULL), serialNumber(""), type(""), sink(*this) {}
+tester::tester() : hMutex(NULL), leased(false), sink(*this), serialNumber(""), type("") {}
 
-tester::tester(tester&& other) noexcept : // Logic for move constructor
+tester::tester(tester&& other) noexcept : // Logic for move constructor, members in declaration order
     hMutex(other.hMutex), // Copy mutex from temporary tester
+    leased(other.leased), // Lease moves with the mutex
+    sink(*this), // New sink must point at this tester, its table is moved below
     serialNumber(std::move(other.serialNumber)), // Copy serial number from temporary tester
     type(std::move(other.type)), // Copy type from temporary tester
-    sink(*this)
+    consoleColor(other.consoleColor),
+    session(std::move(other.session)), // Take over console worker from temporary tester
+    spawner(std::move(other.spawner)), // Keep the grown output buffer
+    timeouts(other.timeouts.load()), // Keep timeout history
+    consecutiveTimeouts(other.consecutiveTimeouts.load()),
+    token(std::move(other.token)), // Keep the tester's place under the global token
+    settleConfig(other.settleConfig), // Keep settle tuning
+    settleHistory(std::move(other.settleHistory)),
+    sweepConfig(other.sweepConfig), // Keep sweep tuning
+    gridConfig(other.gridConfig)
 {
-    // Explicitly move the data from the old sink's list to the new one
-    this->sink.profileList = std::move(other.sink.profileList);
+    // Explicitly move the data from the old sink's table to the new one
+    this->sink.pdos = std::move(other.sink.pdos);
 
     other.hMutex = NULL; // temporary tester mutex must be NULL after copy or destructor will close copied mutex
+    other.leased = false;
 }
 
 tester::~tester() {
@@ -152,16 +149,25 @@ tester::~tester() {
         CloseHandle(hMutex);
         std::cout << "DEBUG: Released lock for " << serialNumber << std::endl;
     }
+
+    if (leased) Lease::release(serialNumber); // Next process in line can take it
 }
 
-bool tester::tryClaim(std::string sn) {
-    // Build unique gloable name for mutex
+bool tester::tryClaim(std::string sn, const std::chrono::milliseconds& wait) {
+    // Queue in the shared lease table first, so waiting is fair and every tool can see who holds the tester
+    bool shared = Lease::available();
+    if (shared && !Lease::acquire(sn, wait)) return false;
+
+    // Build unique gloable name for mutex. Still taken, so tools that predate the lease table are kept out
     std::string mutexName = "Global\\Lock_SN_" + sn;
 
     // Create/open mutex
     hMutex = CreateMutexA(NULL, FALSE, mutexName.c_str());
 
-    if (hMutex == NULL) return false; // OS failed to try to open mutex (rare)
+    if (hMutex == NULL) { // OS failed to try to open mutex (rare)
+        if (shared) Lease::release(sn);
+        return false;
+    }
 
    // Move the Wait logic here. Using 0ms timeout for an immediate check.
     DWORD waitResult = WaitForSingleObject(hMutex, 0);
@@ -170,15 +176,86 @@ bool tester::tryClaim(std::string sn) {
         // We successfully took ownership of the lock (Fresh or Abandoned)
         std::cout << "DEBUG: Lock acquired for " << sn << std::endl;
         this->serialNumber = sn;
+        this->leased = shared;
         return true;
     } 
 
     // If we get here, someone else owns it (WAIT_TIMEOUT)
     CloseHandle(hMutex);
     hMutex = NULL;
+    if (shared) Lease::release(sn);
+    return false;
+}
+
+void tester::noteCommand(const bool& timedOut) const {
+    if (!timedOut) {
+        consecutiveTimeouts.store(0);
+        return;
+    }
+
+    ++timeouts;
+    bool wasQuarantined = this->isQuarantined();
+    ++consecutiveTimeouts;
+    if (!wasQuarantined && this->isQuarantined()) {
+        this->logErr() << "Quarantined after " << consecutiveTimeouts.load() << " console timeouts in a row. No new tests will start on it.";
+    }
+}
+
+bool tester::isQuarantined() const {
+    static const unsigned limit = []() {
+        const char* limit = getenv("PASSMARK_QUARANTINE_TIMEOUTS");
+        return (limit != nullptr && atoi(limit) > 0) ? (unsigned)atoi(limit) : 3u;
+    }();
+    return consecutiveTimeouts.load() >= limit;
+}
+
+bool tester::startSession() {
+    if (Capture::isReplaying()) return false; // Nothing to talk to, responses come from the capture
+    if (!session) session.reset(new ConsoleSession());
+    if (session->start()) return true;
+
+    session.reset(); // Worker unavailable, use one-shot spawns
     return false;
 }
 
+/**
+ * TesterStream member function definitions
+ */
+namespace {
+    // Format buffers owned by this thread. More than one is only needed if streams nest
+    thread_local std::vector<std::unique_ptr<std::ostringstream>> streamPool;
+}
+
+std::ostringstream* TesterStream::acquireBuffer() {
+    if (streamPool.empty()) return new std::ostringstream();
+
+    std::ostringstream* buf = streamPool.back().release();
+    streamPool.pop_back();
+    return buf;
+}
+
+void TesterStream::releaseBuffer(std::ostringstream* buf) {
+    // Clear text and any manipulators (setfill etc.) left on the stream, keep the allocation
+    static const std::ostringstream pristine;
+    buf->str(std::string());
+    buf->clear();
+    buf->copyfmt(pristine);
+    streamPool.emplace_back(buf);
+}
+
+TesterStream::TesterStream(const tester& t, const bool& error) : tRef(t), isError(error), buffer(acquireBuffer()) {
+    *buffer << "(" << tRef.serialNumber << ") ";
+    prefixLength = buffer->tellp();
+}
+
+TesterStream::~TesterStream() {
+    if (buffer == nullptr) return; // Moved from
+
+    // Only print if something was written after the prefix
+    if (buffer->tellp() > prefixLength) Log::submit(tRef.consoleColor, isError, buffer->view());
+    releaseBuffer(buffer);
+}
+
 TesterStream tester::log() const { return TesterStream(*this, false); }
 
 TesterStream tester::logErr() const { return TesterStream(*this, true); }
@@ -211,58 +288,138 @@ bool tester::isPM125() const {
 }
 
 tester::status tester::getStatus() const {
-    std::string output = runCommand(*this, "-s");
-    removeBlankLines(output);
+    status Stats = this->parseStatus(runCommandView(*this, "-s"));
+    if (!Stats.isValid()) throw std::runtime_error("(" + this->serialNumber + ") Tester failed to respond.");
+    return Stats;
+}
 
+tester::status tester::parseStatus(std::string_view output) const {
     status Stats;
+    scanStatus(output, this->isPM240(), Stats);
+    return Stats;
+}
 
-    auto getReturnStr = [this, &output](std::string inputStr) {
-        size_t startPos = output.find(inputStr);
-        if (startPos != std::string::npos) { // Tester responded
-            size_t p = startPos + inputStr.size();
-            std::string ReturnStr = "";
-            while (isdigit(output[p])) {
-                ReturnStr.push_back(output[p]);
-                if (p < output.size()) p += 1;
-                else break;
-            }
-            return ReturnStr;
-        } else throw std::runtime_error("(" + this->serialNumber + ") Tester failed to respond.");
+bool tester::parseConnection(std::string_view output) const {
+    std::string_view line = output.substr(0, output.find('\n'));
+
+    auto helper = [&](std::string_view s) {
+        if (line.find(s) == std::string_view::npos) throw std::runtime_error("(" + this->serialNumber + ") Tester failed to respond.");
+        return line.find("NOT CONNECTED") == std::string_view::npos;
     };
 
-    if (this->isPM125()) {
-        Stats.sinkVoltage = getReturnStr("VOLTAGE:");
-        Stats.sinkSetCurrent = getReturnStr("SET CURRENT:");
-        Stats.sinkMeasCurrent = getReturnStr("MEASURED CURRENT:");
+    if (this->isPM125()) return helper("STATUS:");
+    return helper("SINK STATUS:");
+}
+
+bool tester::SettleTracker::update(const SettleConfig& cfg, const status& Stats, const int& targetVoltage, const int& targetCurrent) {
+    int V = Stats.sinkVoltage, I = Stats.sinkMeasCurrent;
+
+    // Sample must be on target (if one is given) and steady relative to the previous sample
+    bool onTarget = (targetVoltage <= 0 || (V > targetVoltage * 0.95 && V < targetVoltage * 1.05)) &&
+                    (targetCurrent < 0 || abs(I - targetCurrent) <= std::max(cfg.currentTolerance, targetCurrent / 20));
+    bool steady = abs(V - lastVoltage) <= cfg.voltageTolerance && abs(I - lastCurrent) <= cfg.currentTolerance;
+
+    // No target voltage: nothing counts until the rail has left where it was, then stability alone decides
+    if (leaveVoltage >= 0) {
+        if (abs(V - leaveVoltage) <= cfg.voltageTolerance) onTarget = false;
+        else leaveVoltage = -1;
     }
-    if (this->isPM240()) {
-        Stats.sinkVoltage = getReturnStr("SINK VOLTAGE:");
-        Stats.sinkSetCurrent = getReturnStr("SINK SET CURRENT:");
-        Stats.sinkMeasCurrent = getReturnStr("SINK MEASURED CURRENT:");
+
+    stableCount = (!onTarget) ? 0 : (steady) ? stableCount + 1 : 1;
+    lastVoltage = V;
+    lastCurrent = I;
+
+    return stableCount >= cfg.requiredSamples;
+}
+
+void tester::recordSettle(const std::string& transition, const DWORD& settleTime, const bool& settled) const {
+    this->settleHistory.push_back(SettleRecord{transition, settleTime, settled});
+    if (this->settleHistory.size() > 256) this->settleHistory.pop_front();
+}
+
+tester::status tester::waitForSettle(const std::string& transition, const int& targetVoltage, const int& targetCurrent, const DWORD& timeout) const {
+    return this->waitForSettle(this->batch(), transition, targetVoltage, targetCurrent, timeout);
+}
+
+tester::status tester::waitForSettle(CommandBatch lead, const std::string& transition, const int& targetVoltage, const int& targetCurrent,
+                                     const DWORD& timeout, const int& leaveVoltage) const {
+    return this->settle(SettleWait(std::move(lead), transition, targetVoltage, targetCurrent, timeout, leaveVoltage));
+}
+
+tester::SettleWait::SettleWait(CommandBatch lead, std::string transition, const int& targetVoltage, const int& targetCurrent, const DWORD& timeout,
+                               const int& leaveVoltage) :
+    tRef(lead.tRef), lead(std::move(lead)), transition(std::move(transition)), targetVoltage(targetVoltage), targetCurrent(targetCurrent), timeout(timeout)
+{
+    tracker.leaveVoltage = leaveVoltage;
+}
+
+bool tester::SettleWait::sample(DWORD& pause) {
+    const SettleConfig& cfg = this->tRef.settleConfig;
+    ULONGLONG sampleTime = GetTickCount64();
+    pause = 0;
+
+    if (first) { // Lead steps and the first sample share a round trip
+        startTime = sampleTime;
+        Stats = lead.getStatus().run().back().Stats;
+        if (!Stats.isValid()) throw std::runtime_error("(" + this->tRef.serialNumber + ") Tester failed to respond.");
+        first = false;
+    } else Stats = this->tRef.getStatus();
+
+    ULONGLONG elapsed = GetTickCount64() - startTime;
+    bool settled = tracker.update(cfg, Stats, targetVoltage, targetCurrent);
+    if (settled || elapsed >= timeout) {
+        // Record measured settle time
+        this->tRef.recordSettle(transition, (DWORD)(GetTickCount64() - startTime), settled);
+        return true;
     }
 
-    return Stats;
+    // Keep sample rate, but never sleep past the timeout
+    ULONGLONG spent = GetTickCount64() - sampleTime;
+    if (spent < cfg.pollInterval) pause = (DWORD)std::min<ULONGLONG>(cfg.pollInterval - spent, timeout - elapsed);
+    return false;
+}
+
+tester::SettleWait tester::profileWait(const std::string& profileNumStr) const {
+    // Profile change and first status read go out together. Allow up to 3s for voltage to settle
+    std::string transition = "-v " + profileNumStr;
+
+    // Use advertised voltage as target when known so the old rail isn't mistaken for a settled one
+    const Pdo* pdo = this->sink.pdos.find(std::string_view(profileNumStr));
+    if (pdo != nullptr && !pdo->isVariableVoltage) return SettleWait(this->batch().setProfile(profileNumStr), transition, pdo->maxVoltage, -1, 3000);
+
+    // Otherwise wait for the rail to move off its present voltage. A profile at the same voltage runs to the timeout
+    int before = this->getStatus().sinkVoltage;
+    return SettleWait(this->batch().setProfile(profileNumStr), transition, 0, -1, 3000, before);
+}
+
+tester::SettleWait tester::variableVoltageWait(const std::string& profileNumStr, const int& sinkVoltage) const {
+    std::string args = "-v " + profileNumStr + "," + std::to_string(sinkVoltage);
+    return SettleWait(this->batch().setVariableVoltageProfile(profileNumStr, sinkVoltage), args, sinkVoltage, -1, 3000);
+}
+
+tester::SettleWait tester::loadWait(const std::string& loadCurrent, const std::string& loadSpeed, const DWORD& settleTimeout) const {
+    // Load command and first status read go out together. Allow time for current to settle
+    return SettleWait(this->batch().setLoad(loadCurrent, loadSpeed), "-l " + loadCurrent, 0, std::stoi(loadCurrent), settleTimeout);
+}
+
+tester::status tester::settle(SettleWait wait) const {
+    DWORD pause;
+    while (!wait.sample(pause)) {
+        if (pause > 0 && !this->token.sleepFor(std::chrono::milliseconds(pause))) throw JobCancelled("(" + this->serialNumber + ") Settle wait cancelled.");
+    }
+    return wait.last();
 }
 
 tester::status tester::setProfile(const std::string& profileNumStr) const {
-    runCommand(*this, "-v " + profileNumStr); // Console command to set profile
-    Sleep(3000); // Allow time for voltage to settle
-    return getStatus();
+    return this->settle(this->profileWait(profileNumStr));
 }
 
 tester::status tester::setVariableVoltageProfile(const std::string& profileNumStr, const int& sinkVoltage) const {
-    runCommand(*this, "-v " + profileNumStr + "," + std::to_string(sinkVoltage)); // Console command to set profile
-    Sleep(3000); // Allow time for voltage to settle
-    return getStatus();
+    return this->settle(this->variableVoltageWait(profileNumStr, sinkVoltage));
 }
 
-tester::status tester::setLoad(const std::string& loadCurrent, const std::string& loadSpeed, const DWORD& sleepTime) const {
-    // Send set load command to tester
-    if (this->isPM125()) runCommand(*this, "-l " + loadCurrent);
-    if (this->isPM240()) runCommand(*this, "-l " + loadCurrent + "," + loadSpeed);
- 
-    Sleep(sleepTime); // Allow time for current to settle
-    return getStatus();
+tester::status tester::setLoad(const std::string& loadCurrent, const std::string& loadSpeed, const DWORD& settleTimeout) const {
+    return this->settle(this->loadWait(loadCurrent, loadSpeed, settleTimeout));
 }
 
 tester::status tester::unload() const {
@@ -270,131 +427,541 @@ tester::status tester::unload() const {
     return this->setLoad("0");
 }
 
-// void tester::testSinkVoltage(const std::string& profileStr) const {
-//     /**
-//      * Main logic for USB protocol test is implemented here.
-//      * (1) Check if profileStr is empty. If its not empty, only test profiles specified. Assume that profiles were already checked to be valid.
-//      * (2) Iterate through each profile.
-//      * (3) Check if profile is a variable voltage profile. If true, set up loop to iterate through voltage range
-//      */
-
-//     auto runCurrentSweep = [this](std::string profile) {
-//         auto CurrentSweep = [this](std::string maxCurrent) {
-//             int c = 0;
-//             int currentStep = 50; // Current step in mA
-//             while (c <= std::stoi(maxCurrent)) {
-//                 status Stats = this->setLoad(std::to_string(c));
-//                 c += currentStep;
-//             }
-//             this->setLoad("0");
-//         };
-
-//         ProfileInfo info = getProfileInfo(profile);
-//         if (info.isVariableVoltage) {
-//             size_t pos = info.voltageRange.find("-");
-//             if (pos != std::string::npos) {
-//                 int vMin = std::stoi(info.voltageRange.substr(0,pos));
-//                 int vMax = std::stoi(info.voltageRange.substr(pos + 1));
-//                 int vStep = 1000; // Voltage step in mV for variable voltage profiles
-
-//                 for (int v = vMin; v < vMax; v += vStep - v % vStep) {
-//                     status Stats = this->setVariableVoltageProfile(profile, v);
-
-//                     // Check that profile was set successfully
-//                     int setVoltage = std::stoi(Stats.sinkVoltage);
-//                     if (setVoltage > v * 0.95 && setVoltage < v * 1.05) {
-//                         CurrentSweep(info.maxCurrent);
-//                     } else printf("(%s) Unable to set voltage to %imV\n", this->serialNumber, v); // <<< MODIFY THIS LINE ONCE PROFILE RETURN FUNCTION EXISTSS
-//                 }
-//             }
-//         } else {
-//             status Stats = this->setProfile(profile);
-
-//             // Check that profile was set successfully
-//             int setVoltage = std::stoi(Stats.sinkVoltage);
-//             int targetVoltage = std::stoi(info.voltageRange);
-//             if (setVoltage > targetVoltage * 0.95 && setVoltage < targetVoltage * 1.05) {
-//                 CurrentSweep(info.maxCurrent);
-//             } else printf("(%s) Unable to set voltage to %imV\n", this->serialNumber, targetVoltage);
-//         }
-//     };
-
-//     if (!profileStr.empty()) { // One or more profiles were specified
-//         std::stringstream ss(profileStr);
-//         std::string field;
-//         while (getline(ss, field, ',')) {
-//             runCurrentSweep(field);
-//         }
-//     }
-// }
+/**
+ * Sweep planners, shared by the blocking sweeps and ProfileSweep
+ */
+tester::CurrentPlan::CurrentPlan(const SweepConfig& cfg, const std::string& profile, const int& targetVoltage, const int& maxCurrent) :
+    cfg(cfg), steps(std::max(1, cfg.coarseSteps))
+{
+    result.profile = profile;
+    result.targetVoltage = targetVoltage;
+    result.maxCurrent = maxCurrent;
+    result.voltageSet = true;
+}
 
-// ----------------------------------------
-// Other functions
-// ----------------------------------------
+bool tester::CurrentPlan::next(int& current) {
+    // Coarse pass. Stop early once the DUT has clearly given out
+    if (!coarseDone) {
+        if (coarseStep <= steps && failures < cfg.failLimit) {
+            current = pending = result.maxCurrent * coarseStep++ / steps;
+            return true;
+        }
 
-std::string runCommand(const tester& Tester, const std::string& commandArg) {
-    std::string commandBase = (Tester.isPM240()) ? "USBPDPROConsole.exe " : (Tester.isPM125()) ? "USBPDConsole.exe " : "Invalid tester type";
-    if (commandBase == "Invalid tester type") throw std::runtime_error(commandBase);
-    
-    // Append serial number to commandBase if not empty, i.e., if Tester object represents a real tester
-    if (!Tester.serialNumber.empty()) commandBase.append("-d " + Tester.serialNumber + " ");
-    std::string command = commandBase + commandArg;
-    
-    HANDLE hRead, hWrite;
-    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE};
-
-    // Create pipe for child process output
-    if (!CreatePipe(&hRead, &hWrite, &sa, 0)) {
-        throw std::runtime_error("Failed to create pipe");
-    }
-    
-    // Ensure program doesn't pass read side of pipe to command
-    SetHandleInformation(hRead, HANDLE_FLAG_INHERIT, 0);
-
-    // Set up output redirection
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags |= STARTF_USESTDHANDLES;
-    si.hStdOutput = hWrite;
-    si.hStdError = hWrite; // Redirect stderr to the same pipe
-
-    // Build the command line
-    PROCESS_INFORMATION pi = {};
-    std::string cmdLine = "cmd.exe /C " + command; // Use cmd.exe to run the command
-
-    //Create child process
-    if (!CreateProcessA(
-        NULL,
-        &cmdLine[0],    // Command line must be mutable
-        NULL, NULL, TRUE,
-        0, NULL, NULL,
-        &si, &pi)) {
-            CloseHandle(hWrite);
-            CloseHandle(hRead);
-            throw std::runtime_error("Failed to create process");
+        coarseDone = true;
+        coarse = result.points;
+        std::sort(coarse.begin(), coarse.end(), [](const SweepPoint& a, const SweepPoint& b) { return a.setCurrent < b.setCurrent; });
+    }
+
+    // Fine pass. Bisect each interval whose ends disagree down to the configured resolution
+    while (true) {
+        if (bisecting) {
+            if (hi - lo > cfg.resolution) {
+                current = pending = (lo + hi) / 2;
+                return true;
+            }
+            bisecting = false;
+            ++interval;
         }
 
-    CloseHandle(hWrite); // Close the write end of the pipe in the parent process
+        if (interval >= coarse.size()) return false;
+        if (coarse[interval - 1].pass == coarse[interval].pass) {
+            ++interval;
+            continue;
+        }
 
-    // Read output from the pipe
-    char buffer[128];
-    DWORD bytesRead;
-    std::string output;
-    while (ReadFile(hRead, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-        buffer[bytesRead] = '\0'; // Null-terminate the string
-        output += buffer;
+        lo = coarse[interval - 1].setCurrent;
+        hi = coarse[interval].setCurrent;
+        loPass = coarse[interval - 1].pass;
+        bisecting = true;
     }
+}
+
+void tester::CurrentPlan::measured(const status& Stats) {
+    SweepPoint point;
+    point.setCurrent = pending;
+    point.measCurrent = Stats.sinkMeasCurrent;
+    point.voltage = Stats.sinkVoltage;
+    point.pass = abs(point.measCurrent - pending) <= std::max(cfg.currentTolerance, pending / 20) &&
+                 point.voltage > result.targetVoltage * 0.95 && point.voltage < result.targetVoltage * 1.05;
+    result.points.push_back(point);
+
+    if (!coarseDone) failures = (point.pass) ? 0 : failures + 1;
+    else if (point.pass == loPass) lo = pending;
+    else hi = pending;
+}
+
+tester::SweepResult tester::CurrentPlan::finish() {
+    // Summarize boundary
+    std::sort(result.points.begin(), result.points.end(), [](const SweepPoint& a, const SweepPoint& b) { return a.setCurrent < b.setCurrent; });
+    for (const SweepPoint& point : result.points) {
+        if (!point.pass) {
+            result.firstFailCurrent = point.setCurrent;
+            break;
+        }
+        result.maxPassCurrent = point.setCurrent;
+    }
+
+    return result;
+}
+
+tester::GridPlan::GridPlan(const VoltageGridConfig& cfg, const int& currentResolution, const int& vMin, const int& vMax) :
+    cfg(cfg), currentResolution(currentResolution), stepsLeft(cfg.maxSteps)
+{
+    // Sparse first pass, endpoints included
+    int points = std::max(2, cfg.initialPoints);
+    for (int k = 0; k < points; ++k) {
+        int v = (k == 0) ? vMin : (k == points - 1) ? vMax : this->snap(vMin + (vMax - vMin) * k / (points - 1));
+        if (grid.empty() || v > grid.back()) grid.push_back(v);
+    }
+}
+
+int tester::GridPlan::snap(const int& v) const {
+    // Snap voltage to the programming grid
+    return (v + cfg.resolution / 2) / cfg.resolution * cfg.resolution;
+}
+
+bool tester::GridPlan::differ(const SweepResult& a, const SweepResult& b) const {
+    // Two voltages need refining between them if one regulates and the other doesn't, or if they droop
+    // at noticeably different load currents
+    if (a.voltageSet != b.voltageSet) return true;
+    if ((a.firstFailCurrent < 0) != (b.firstFailCurrent < 0)) return true;
+    return abs(a.maxPassCurrent - b.maxPassCurrent) > currentResolution;
+}
+
+bool tester::GridPlan::next(int& voltage) {
+    if (stepsLeft <= 0) return false;
+
+    if (gridNext < grid.size()) {
+        --stepsLeft;
+        voltage = grid[gridNext++];
+        return true;
+    }
+
+    while (!intervals.empty()) {
+        std::pair<size_t, size_t> interval = intervals.front();
+        intervals.pop_front();
+        if (!this->differ(results[interval.first], results[interval.second])) continue;
+
+        int mid = this->snap((results[interval.first].targetVoltage + results[interval.second].targetVoltage) / 2);
+        if (mid <= results[interval.first].targetVoltage || mid >= results[interval.second].targetVoltage) continue; // Boundary is within resolution
+
+        --stepsLeft;
+        splitting = interval;
+        voltage = mid;
+        return true;
+    }
+
+    return false;
+}
 
-    CloseHandle(hRead);
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    DWORD exitCode = 0;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+void tester::GridPlan::visited(SweepResult result) {
+    results.push_back(std::move(result));
+    size_t m = results.size() - 1;
+
+    if (splitting) {
+        intervals.emplace_back(splitting->first, m);
+        intervals.emplace_back(m, splitting->second);
+        splitting.reset();
+    } else if (m > 0) intervals.emplace_back(m - 1, m);
+}
+
+std::vector<tester::SweepResult> tester::GridPlan::finish() {
+    std::sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        return a.targetVoltage < b.targetVoltage;
+    });
+
+    return results;
+}
+
+namespace {
+    bool reachedVoltage(const int& measured, const int& target) {
+        return measured > target * 0.95 && measured < target * 1.05;
+    }
+
+    // Result for a voltage the profile never reached, no points are taken
+    tester::SweepResult voltageNotSet(const tester& Tester, const std::string& profile, const int& targetVoltage, const int& maxCurrent) {
+        tester::SweepResult failed;
+        failed.profile = profile;
+        failed.targetVoltage = targetVoltage;
+        failed.maxCurrent = maxCurrent;
+        Tester.logErr() << "Unable to set voltage to " << targetVoltage << "mV";
+        return failed;
+    }
+}
+
+tester::SweepResult tester::sweepCurrent(const std::string& profile, const int& targetVoltage, const int& maxCurrent) const {
+    CurrentPlan plan(this->sweepConfig, profile, targetVoltage, maxCurrent);
+    int current;
+    while (plan.next(current)) plan.measured(this->setLoad(std::to_string(current)));
+
+    this->setLoad("0");
+    return plan.finish();
+}
+
+tester::SweepResult tester::sweepAtVoltage(const std::string& profile, const int& targetVoltage, const int& maxCurrent, const status& Stats) const {
+    if (reachedVoltage(Stats.sinkVoltage, targetVoltage)) return this->sweepCurrent(profile, targetVoltage, maxCurrent);
+    return voltageNotSet(*this, profile, targetVoltage, maxCurrent);
+}
+
+std::vector<tester::SweepResult> tester::sweepVoltageGrid(const std::string& profile, const int& vMin, const int& vMax, const int& maxCurrent) const {
+    GridPlan plan(this->gridConfig, this->sweepConfig.resolution, vMin, vMax);
+    int v;
+    while (plan.next(v)) plan.visited(this->sweepAtVoltage(profile, v, maxCurrent, this->setVariableVoltageProfile(profile, v)));
+    return plan.finish();
+}
+
+std::vector<std::string> tester::selectProfiles(const std::string& profileStr) {
+    if (this->sink.pdos.empty()) this->sink.getProfiles();
+
+    // Assume specified profiles were already checked to be valid
+    std::vector<std::string> profiles;
+    if (profileStr.empty()) {
+        for (const Pdo& pdo : this->sink.pdos.entries()) profiles.push_back(std::to_string(pdo.index));
+    } else {
+        std::stringstream ss(profileStr);
+        std::string field;
+        while (getline(ss, field, ',')) profiles.push_back(field);
+    }
+
+    return profiles;
+}
+
+std::vector<tester::SweepResult> tester::testProfile(const std::string& profile) const {
+    const Pdo& pdo = this->sink.getProfileInfo(profile);
+
+    if (pdo.isVariableVoltage) return this->sweepVoltageGrid(profile, pdo.minVoltage, pdo.maxVoltage, pdo.maxCurrent);
+    return {this->sweepAtVoltage(profile, pdo.maxVoltage, pdo.maxCurrent, this->setProfile(profile))};
+}
+
+std::vector<tester::SweepResult> tester::testSinkVoltage(const std::string& profileStr) {
+    std::vector<SweepResult> results;
+    for (const std::string& profile : this->selectProfiles(profileStr)) {
+        std::vector<SweepResult> profileResults = this->testProfile(profile);
+        results.insert(results.end(), profileResults.begin(), profileResults.end());
+    }
+
+    this->unload();
+    return results;
+}
+
+/**
+ * Step-wise sweep and unload, one console round trip per scheduler step
+ */
+namespace {
+    // Between two samples of a settle wait
+    Sched::Step pace(const DWORD& pause) {
+        return (pause > 0) ? Sched::Step::sleep(std::chrono::milliseconds(pause)) : Sched::Step::yield();
+    }
+}
+
+tester::ProfileSweep::ProfileSweep(const tester& parent, const std::string& profile) :
+    tRef(parent), profile(profile), pdo(parent.sink.getProfileInfo(profile)) {}
+
+Sched::Step tester::ProfileSweep::step() {
+    if (!started) {
+        started = true;
+        if (pdo.isVariableVoltage) {
+            grid.emplace(tRef.gridConfig, tRef.sweepConfig.resolution, pdo.minVoltage, pdo.maxVoltage);
+            this->nextVoltage();
+        } else {
+            voltage = pdo.maxVoltage;
+            settling.emplace(tRef.profileWait(profile));
+        }
+        if (!settling) return Sched::Step::done();
+    }
+
+    DWORD pause;
+    if (!settling->sample(pause)) return pace(pause);
+
+    status Stats = settling->last();
+    settling.reset();
+    this->settled(Stats);
+
+    // Next transition goes out on the next step, so other testers' round trips get a turn
+    return (settling) ? Sched::Step::yield() : Sched::Step::done();
+}
+
+void tester::ProfileSweep::settled(const status& Stats) {
+    switch (phase) {
+    case Phase::Voltage:
+        if (reachedVoltage(Stats.sinkVoltage, voltage)) {
+            sweep.emplace(tRef.sweepConfig, profile, voltage, pdo.maxCurrent);
+            this->nextLoad();
+        } else {
+            this->record(voltageNotSet(tRef, profile, voltage, pdo.maxCurrent));
+            this->nextVoltage();
+        }
+        break;
+    case Phase::Load:
+        sweep->measured(Stats);
+        this->nextLoad();
+        break;
+    case Phase::Unload:
+        this->record(sweep->finish());
+        sweep.reset();
+        this->nextVoltage();
+        break;
+    }
+}
+
+void tester::ProfileSweep::nextVoltage() {
+    if (!grid) return; // A fixed profile has one voltage
+
+    if (grid->next(voltage)) {
+        settling.emplace(tRef.variableVoltageWait(profile, voltage));
+        phase = Phase::Voltage;
+    } else found = grid->finish();
+}
+
+void tester::ProfileSweep::nextLoad() {
+    int current;
+    if (sweep->next(current)) {
+        settling.emplace(tRef.loadWait(std::to_string(current)));
+        phase = Phase::Load;
+    } else {
+        settling.emplace(tRef.loadWait("0"));
+        phase = Phase::Unload;
+    }
+}
+
+void tester::ProfileSweep::record(SweepResult result) {
+    if (grid) grid->visited(std::move(result));
+    else found.push_back(std::move(result));
+}
+
+Sched::Step tester::UnloadSteps::step() {
+    if (!settling) settling.emplace((stage == 0) ? tRef.profileWait("1") : tRef.loadWait("0"));
+
+    DWORD pause;
+    if (!settling->sample(pause)) {
+        return (pause > 0) ? Sched::Step::sleepThrough(std::chrono::milliseconds(pause)) : Sched::Step::yield();
+    }
+
+    settling.reset();
+    return (++stage < 2) ? Sched::Step::yield() : Sched::Step::done();
+}
+
+/**
+ * tester::CommandBatch class member function definitions
+ */
+tester::CommandBatch tester::batch() const { return CommandBatch(*this); }
+
+tester::CommandBatch& tester::CommandBatch::queue(Kind kind, const std::string& args) {
+    this->steps.push_back(Step{kind, args, 0});
+    return *this;
+}
+
+tester::CommandBatch& tester::CommandBatch::setProfile(const std::string& profileNumStr) {
+    return this->queue(Kind::Command, "-v " + profileNumStr);
+}
+
+tester::CommandBatch& tester::CommandBatch::setVariableVoltageProfile(const std::string& profileNumStr, const int& sinkVoltage) {
+    return this->queue(Kind::Command, "-v " + profileNumStr + "," + std::to_string(sinkVoltage));
+}
+
+tester::CommandBatch& tester::CommandBatch::setLoad(const std::string& loadCurrent, const std::string& loadSpeed) {
+    if (this->tRef.isPM125()) return this->queue(Kind::Command, "-l " + loadCurrent);
+    return this->queue(Kind::Command, "-l " + loadCurrent + "," + loadSpeed);
+}
+
+tester::CommandBatch& tester::CommandBatch::connect() {
+    return this->queue(Kind::Command, (this->tRef.isPM125()) ? "-b 1" : "-b 1,1");
+}
+
+tester::CommandBatch& tester::CommandBatch::disconnect() {
+    return this->queue(Kind::Command, (this->tRef.isPM125()) ? "-b 0" : "-b 1,0");
+}
+
+tester::CommandBatch& tester::CommandBatch::getStatus() {
+    return this->queue(Kind::Status, "-s");
+}
+
+tester::CommandBatch& tester::CommandBatch::isConnected() {
+    return this->queue(Kind::Connection, "-c");
+}
+
+tester::CommandBatch& tester::CommandBatch::wait(const DWORD& milliseconds) {
+    this->steps.push_back(Step{Kind::Command, "", milliseconds});
+    return *this;
+}
+
+std::vector<tester::CommandBatch::Round> tester::CommandBatch::rounds() const {
+    std::vector<Round> rounds(1);
+    for (size_t i = 0; i < this->steps.size(); ++i) {
+        const Step& step = this->steps[i];
+        if (step.args.empty()) { // Wait step ends the round
+            rounds.back().waitAfter = step.waitTime;
+            rounds.emplace_back();
+            continue;
+        }
+
+        Round& round = rounds.back();
+        round.steps.push_back(i);
+        round.commands.push_back(Spawn::buildCommandLine(consoleArgv(this->tRef, step.args)));
+        round.timeout += commandTimeout(step.args); // The round gets the sum of its commands' deadlines
+    }
+    if (rounds.back().steps.empty()) rounds.pop_back();
+    return rounds;
+}
+
+std::vector<tester::CommandBatch::StepResult> tester::CommandBatch::prepare() const {
+    std::vector<StepResult> results(this->steps.size());
+    for (size_t i = 0; i < this->steps.size(); ++i) results[i].kind = this->steps[i].kind;
+    return results;
+}
+
+void tester::CommandBatch::recordRound(const Round& round, const std::vector<std::string>& outputs, const size_t& done,
+                                       const std::chrono::steady_clock::time_point& start) const {
+    if (done == 0) return;
+    this->tRef.noteCommand(false);
+    if (!Capture::isRecording()) return;
+
+    // Only the round trip is timed, spread it evenly over the steps
+    uint32_t latency = (uint32_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / done);
+    const std::vector<int>& exitCodes = this->tRef.session->lastExitCodes();
+    for (size_t i = 0; i < done; ++i) {
+        Capture::record(captureKey(this->tRef, this->steps[round.steps[i]].args), outputs[i], exitCodes[i], latency);
+    }
+}
+
+void tester::CommandBatch::parseRound(const Round& round, std::vector<std::string>& outputs, std::vector<StepResult>& results) const {
+    for (size_t i = 0; i < round.steps.size(); ++i) {
+        StepResult& result = results[round.steps[i]];
+        result.output = std::move(outputs[i]);
+        if (result.kind == Kind::Status) result.Stats = this->tRef.parseStatus(result.output);
+        if (result.kind == Kind::Connection) result.connected = this->tRef.parseConnection(result.output);
+    }
+}
+
+std::vector<tester::CommandBatch::StepResult> tester::CommandBatch::run() {
+    std::vector<StepResult> results = this->prepare();
+    std::vector<std::string> outputs;
+
+    for (const Round& round : this->rounds()) {
+        if (!round.steps.empty()) {
+            // Replay serves each step from the capture, so skip the worker entirely
+            auto start = std::chrono::steady_clock::now();
+            bool batched;
+            try {
+                batched = !Capture::isReplaying() && this->tRef.session && this->tRef.session->runBatch(round.commands, outputs, round.timeout, this->tRef.token);
+            } catch (const Spawn::Timeout&) {
+                this->tRef.noteCommand(true);
+                throw timeoutError(this->tRef, "batch", round.timeout);
+            }
+
+            // A worker that died part way through still finished the steps before it. Those stand, so a "-l" or "-b"
+            // it already ran isn't sent twice; only the steps whose end marker never came back are spawned
+            size_t done = (batched) ? round.steps.size() : (!Capture::isReplaying() && this->tRef.session) ? this->tRef.session->lastCompleted() : 0;
+            this->recordRound(round, outputs, done, start);
+
+            outputs.resize(done);
+            for (size_t i = done; i < round.steps.size(); ++i) outputs.emplace_back(runCommandView(this->tRef, this->steps[round.steps[i]].args));
+            this->parseRound(round, outputs, results);
+        }
+
+        if (round.waitAfter > 0 && !this->tRef.token.sleepFor(std::chrono::milliseconds(round.waitAfter))) {
+            throw JobCancelled("(" + this->tRef.serialNumber + ") Command batch cancelled.");
+        }
+    }
+
+    this->steps.clear();
+    return results;
+}
+
+// ----------------------------------------
+
+std::chrono::milliseconds commandTimeout(const std::string& commandArg) {
+    // Seconds per switch. Discovery scans the bus, profile reads and reconnects wait on PD negotiation
+    static const std::pair<const char*, int> limits[] = {
+        {"-f", 20}, {"-p", 15}, {"-b", 15}, {"-v", 10}, {"-l", 10}, {"-s", 5}, {"-c", 5}
+    };
+    static const double scale = []() {
+        const char* scale = getenv("PASSMARK_TIMEOUT_SCALE");
+        return (scale != nullptr && atof(scale) > 0) ? atof(scale) : 1.0;
+    }();
+
+    int seconds = 10;
+    for (const auto& limit : limits) {
+        if (commandArg.compare(0, 2, limit.first) == 0) seconds = limit.second;
+    }
+    return std::chrono::milliseconds((long long)(seconds * 1000 * scale));
+}
+
+Spawn::Timeout timeoutError(const tester& Tester, const std::string& commandArg, const std::chrono::milliseconds& timeout) {
+    std::string who = Tester.serialNumber.empty() ? Tester.type : Tester.serialNumber; // Discovery runs without a serial number
+    return Spawn::Timeout("(" + who + ") Console command " + commandArg + " timed out after " +
+                          std::to_string(std::chrono::duration_cast<std::chrono::seconds>(timeout).count()) + "s.");
+}
+
+std::vector<std::string> consoleArgv(const tester& Tester, const std::string& commandArg) {
+    std::string console = (Tester.isPM240()) ? "USBPDPROConsole.exe" : (Tester.isPM125()) ? "USBPDConsole.exe" : "Invalid tester type";
+    if (console == "Invalid tester type") throw std::runtime_error(console);
+
+    // PASSMARK_CONSOLE_DIR points at an alternative console, e.g. the consolesim stand-in
+    const char* consoleDir = getenv("PASSMARK_CONSOLE_DIR");
+    if (consoleDir != NULL && *consoleDir != '\0') console = (std::filesystem::path(consoleDir) / console).string();
+
+    // Append serial number if not empty, i.e., if Tester object represents a real tester
+    std::vector<std::string> argv{console};
+    if (!Tester.serialNumber.empty()) {
+        argv.push_back("-d");
+        argv.push_back(Tester.serialNumber);
+    }
+    Spawn::appendArgs(argv, commandArg);
+
+    return argv;
+}
+
+std::string captureKey(const tester& Tester, const std::string& commandArg) {
+    // Console name without directory, so a capture replays whichever console dir it was recorded with
+    std::string key = (Tester.isPM240()) ? "USBPDPROConsole.exe" : "USBPDConsole.exe";
+    if (!Tester.serialNumber.empty()) key += " -d " + Tester.serialNumber;
+    if (!commandArg.empty()) key += " " + commandArg;
+    return key;
+}
+
+std::string_view runCommandView(const tester& Tester, const std::string& commandArg) {
+    std::string_view output;
+    if (Tester.token.cancelled()) throw JobCancelled("(" + Tester.serialNumber + ") Command cancelled.");
+
+    if (Capture::isReplaying()) {
+        std::string key = captureKey(Tester, commandArg);
+        if (!Capture::replay(key, output)) throw std::runtime_error("No recorded response for: " + key);
+        return output;
+    }
+
+    std::vector<std::string> argv = consoleArgv(Tester, commandArg);
+    std::chrono::milliseconds timeout = commandTimeout(commandArg);
+    auto start = std::chrono::steady_clock::now();
+    int exitCode = 0;
+
+    // Prefer the resident worker. If it died, fall through to a direct spawn
+    try {
+        if (Tester.session && Tester.session->isAlive() && Tester.session->run(Spawn::buildCommandLine(argv), output, timeout, Tester.token)) {
+            exitCode = Tester.session->lastExitCodes().front();
+        } else {
+            Spawn::Result result = Tester.spawner.run(argv, timeout, Tester.token);
+            output = result.output;
+            exitCode = result.exitCode;
+        }
+    } catch (const Spawn::Timeout&) {
+        Tester.noteCommand(true);
+        throw timeoutError(Tester, commandArg, timeout);
+    }
+    Tester.noteCommand(false);
+
+    if (Capture::isRecording()) {
+        uint32_t latency = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        Capture::record(captureKey(Tester, commandArg), output, exitCode, latency);
+    }
 
     return output;
 }
 
+std::string runCommand(const tester& Tester, const std::string& commandArg) {
+    return std::string(runCommandView(Tester, commandArg));
+}
+
 void removeBlankLines(std::string& string_to_filter) {
     // Remove ' ' if followed by '\n'
     for (size_t i = 0; i < string_to_filter.size() - 1; ++i) {
@@ -403,6 +970,3 @@ void removeBlankLines(std::string& string_to_filter) {
         }
     }
 }
-
-// Modify this string to add additional types
-std::vector<std::string> VariableVoltageTypes{"PD-APDO", "PD-PPS", "QC2", "QC3"};
\ No newline at end of file
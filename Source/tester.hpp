@@ -1,33 +1,52 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <Windows.h>
 #include <functional>
 #include <sstream>
 #include <iostream>
 #include <utility>
+#include <memory>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include <optional>
+
+#include "CancelToken.hpp"
+#include "ConsoleSession.hpp"
+#include "ProcessSpawn.hpp"
+#include "Telemetry.hpp"
+#include "PdoTable.hpp"
+#include "Scheduler.hpp"
 
 struct testerList {
     std::vector<std::string> testers;
     std::vector<std::string> type;
 };
 
-// Find all connected PM240 and PM125 testers
-testerList findTesters();
+// Find all connected PM240 and PM125 testers. Both families are polled concurrently. Cancelling 'token' kills the polls
+testerList findTesters(const bool& toConsole = true, const Cancel::Token& token = Cancel::global());
+
+// Serial numbers from raw "-f" console output
+std::vector<std::string> parseTesterList(std::string output);
 
 class TesterStream;
+class AsyncTester;
 
 class tester
 {
 private:
     HANDLE hMutex; // Stores "lock" on Passmark tester
+    bool leased;   // Holds the tester's entry in the shared lease table
 
 public:
     // Define sink-only functions
     class Sink
     {
     public:
-        std::vector<std::string> profileList;
+        // Profiles advertised by the DUT, rebuilt by getProfiles()
+        PdoTable pdos;
 
         Sink(tester& parent) : tRef(parent) {}
 
@@ -40,21 +59,21 @@ public:
         // Toggle sink internal connection closed
         void disconnect() const;
 
-        // Attempt to reconnect to sink
-        void reconnect() const;
+        // Attempt to reconnect to sink. Returns true if the sink is connected afterwards
+        bool reconnect() const;
 
-        // Get current supported profiles
+        // Get current supported profiles and rebuild the profile table
         void getProfiles();
 
-        // Object to store detected profile info
-        struct ProfileInfo {
-            bool isVariableVoltage = false; // False by default
-            std::string voltageRange;
-            std::string maxCurrent;
-        };
+        // Fetch the current advertisement and compare it to the cached table. The table is only replaced
+        // if something changed. Returns the changes, empty if the advertisement is the same
+        std::vector<PdoChange> refreshProfiles();
 
-        // Get profile info
-        ProfileInfo getProfileInfo(const std::string& profile) const;
+        // As refreshProfiles(), from "-p" output the caller already fetched
+        std::vector<PdoChange> applyProfiles(std::string_view output);
+
+        // Get profile info. Throws if the profile isn't advertised
+        const Pdo& getProfileInfo(const std::string& profile) const;
 
     private:
         tester& tRef;
@@ -67,6 +86,19 @@ public:
 
     int consoleColor = 7; // Default to white
 
+    // Resident console worker, NULL when commands are spawned one at a time
+    std::unique_ptr<ConsoleSession> session;
+
+    // Direct spawn backend with a reusable output buffer, used when no worker is running
+    mutable Spawn::Runner spawner;
+
+    // Console commands that ran past their deadline, in total and in a row
+    mutable std::atomic<unsigned> timeouts{0};
+    mutable std::atomic<unsigned> consecutiveTimeouts{0};
+
+    // Cancels this tester's console commands and waits. Child of the global token, narrowed by TokenScope
+    mutable Cancel::Token token = Cancel::global().child();
+
     tester(); // Default constructor
     tester(tester&& other) noexcept; // Move constructor, argument is temporary tester object
     ~tester(); // Deconstructor
@@ -76,13 +108,23 @@ public:
     tester& operator=(const tester&) = delete;
 
     // tester class functions
-    bool tryClaim(std::string sn);
+    // Claim tester 'sn' for this process, queueing up to 'wait' if another process holds it. Returns false if it's still held
+    bool tryClaim(std::string sn, const std::chrono::milliseconds& wait = std::chrono::milliseconds(0));
+
+    // Start a resident console worker for this tester. runCommand() falls back to spawning if this fails
+    bool startSession();
 
     // Returns a temporary stream object
     TesterStream log() const;
 
     TesterStream logErr() const;
 
+    // Record how a console command ended. Enough timeouts in a row quarantine the tester
+    void noteCommand(const bool& timedOut) const;
+
+    // True after PASSMARK_QUARANTINE_TIMEOUTS (default 3) command timeouts in a row. No new work should be given to it
+    bool isQuarantined() const;
+
     // Get supported profiles from DUT
     std::string getProfiles(const bool& toConsole) const;
     
@@ -95,86 +137,430 @@ public:
     // Return true if tester type is PM125
     bool isPM125() const;
 
-    struct status {
-        std::string sinkVoltage;
-        std::string sinkSetCurrent;
-        std::string sinkMeasCurrent;
-    };
+    // Typed status sample, see Telemetry.hpp
+    typedef Telemetry status;
     
+    // Read status from tester. Throws if the tester didn't report every field
     status getStatus() const;
 
+    // Parse status fields from raw "-s" console output. Missing fields are flagged in status::valid
+    status parseStatus(std::string_view output) const;
+
+    // Parse sink connection state from raw "-c" console output
+    bool parseConnection(std::string_view output) const;
+
+    /**
+     * @brief Queues console switches and sends them to the tester in as few round trips as possible.
+     * The console runs one switch per invocation, so consecutive steps are fused into a single write
+     * to the tester's console worker. A wait() step splits the batch. Without a worker, steps are
+     * spawned one by one.
+     */
+    class SettleWait;
+
+    class CommandBatch
+    {
+    public:
+        enum class Kind { Command, Status, Connection };
+
+        // Typed result of one queued step
+        struct StepResult {
+            Kind kind = Kind::Command;
+            std::string output;     // Raw console output
+            status Stats;           // Filled for Status steps
+            bool connected = false; // Filled for Connection steps
+        };
+
+        CommandBatch(const tester& parent) : tRef(parent) {}
+
+        CommandBatch& setProfile(const std::string& profileNumStr);
+        CommandBatch& setVariableVoltageProfile(const std::string& profileNumStr, const int& sinkVoltage);
+        CommandBatch& setLoad(const std::string& loadCurrent, const std::string& loadSpeed = "200");
+        CommandBatch& connect();
+        CommandBatch& disconnect();
+        CommandBatch& getStatus();
+        CommandBatch& isConnected();
+
+        // Pause between steps, e.g. to let the rail settle before a status read
+        CommandBatch& wait(const DWORD& milliseconds);
+
+        // Send queued steps and return one result per step, in order. Empties the queue
+        std::vector<StepResult> run();
+
+    private:
+        struct Step {
+            Kind kind;
+            std::string args;   // Console switch and arguments, empty for waits
+            DWORD waitTime;
+        };
+
+        // Steps sent in one round trip, and the pause that follows them
+        struct Round {
+            std::vector<size_t> steps;              // Indices into 'steps'
+            std::vector<std::string> commands;      // Console command line of each step
+            std::chrono::milliseconds timeout{0};   // Sum of the steps' deadlines
+            DWORD waitAfter = 0;
+        };
+
+        friend class SettleWait;    // Samples through the batch's tester
+        friend class ::AsyncTester; // Runs rounds on a reactor
+
+        const tester& tRef;
+        std::vector<Step> steps;
+
+        CommandBatch& queue(Kind kind, const std::string& args);
+
+        // Split the queue at its waits
+        std::vector<Round> rounds() const;
+
+        // One empty result per step
+        std::vector<StepResult> prepare() const;
+
+        // Account for the first 'done' steps of 'round' that the console worker ran, recording them if capturing
+        void recordRound(const Round& round, const std::vector<std::string>& outputs, const size_t& done,
+                         const std::chrono::steady_clock::time_point& start) const;
+
+        // Parse the outputs of 'round', one per step, into 'results'
+        void parseRound(const Round& round, std::vector<std::string>& outputs, std::vector<StepResult>& results) const;
+    };
+
+    // Start a new command batch for this tester
+    CommandBatch batch() const;
+
+    // Settle detection settings. A rail is settled once 'requiredSamples' consecutive samples are within
+    // tolerance of each other and of the target, or gives up after the timeout passed by the caller
+    struct SettleConfig {
+        DWORD pollInterval = 100;       // Minimum time between samples in ms
+        int voltageTolerance = 50;      // Allowed mV change between consecutive samples
+        int currentTolerance = 50;      // Allowed mA change between consecutive samples and from target current
+        int requiredSamples = 3;        // Consecutive in-tolerance samples needed
+    };
+
+    // Measured settle time of one transition
+    struct SettleRecord {
+        std::string transition; // e.g. "-v 2" or "-l 3000"
+        DWORD settleTime;       // ms from command to settled (or timeout)
+        bool settled;           // False if the timeout was hit
+    };
+
+    // Judges consecutive samples against SettleConfig. Shared by the blocking and coroutine settle loops
+    struct SettleTracker {
+        int lastVoltage = 0, lastCurrent = 0, stableCount = 0;
+        int leaveVoltage = -1;  // Rail before a transition with no known target voltage, -1 if unused
+
+        // Add a sample. Returns true once enough consecutive samples are on target and steady
+        bool update(const SettleConfig& cfg, const status& Stats, const int& targetVoltage, const int& targetCurrent);
+    };
+
+    SettleConfig settleConfig;
+
+    // Most recent settle records, oldest first
+    mutable std::deque<SettleRecord> settleHistory;
+
+    // Append to settleHistory, keeping it bounded on long runs
+    void recordSettle(const std::string& transition, const DWORD& settleTime, const bool& settled) const;
+
+    // Poll status until voltage and current settle. A target of 0 mV or a negative current skips that target check
+    status waitForSettle(const std::string& transition, const int& targetVoltage, const int& targetCurrent, const DWORD& timeout) const;
+
+    // As above, sending 'lead' (e.g. the command that starts the transition) in the same round trip as the first sample.
+    // A 'leaveVoltage' of 0 or more is the rail before a transition with no known target: samples only count once the
+    // rail has moved away from it, so the old rail isn't taken for a settled new one
+    status waitForSettle(CommandBatch lead, const std::string& transition, const int& targetVoltage, const int& targetCurrent, const DWORD& timeout,
+                         const int& leaveVoltage = -1) const;
+
+    /**
+     * @brief A transition and its settle wait, taken one sample at a time so the caller decides how to wait between
+     * samples. The lead steps travel with the first sample. waitForSettle() runs one to the end, scheduler jobs
+     * sample once per step and sleep in between.
+     */
+    class SettleWait
+    {
+    public:
+        SettleWait(CommandBatch lead, std::string transition, const int& targetVoltage, const int& targetCurrent, const DWORD& timeout,
+                   const int& leaveVoltage = -1);
+
+        // Take the next sample, one round trip. Returns true once settled or timed out, otherwise sets 'pause' to the ms
+        // to wait before the next sample
+        bool sample(DWORD& pause);
+
+        // Latest sample
+        const status& last() const { return Stats; }
+
+    private:
+        const tester& tRef;
+        CommandBatch lead;
+        std::string transition;
+        int targetVoltage, targetCurrent;
+        DWORD timeout;
+        SettleTracker tracker;
+        ULONGLONG startTime = 0;
+        bool first = true;
+        status Stats;
+    };
+
+    // Transitions made by setProfile(), setVariableVoltageProfile() and setLoad(), not yet started
+    SettleWait profileWait(const std::string& profileNumStr) const;
+    SettleWait variableVoltageWait(const std::string& profileNumStr, const int& sinkVoltage) const;
+    SettleWait loadWait(const std::string& loadCurrent, const std::string& loadSpeed = "200", const DWORD& settleTimeout = 500) const;
+
+    // Run a settle wait to the end, sleeping between samples
+    status settle(SettleWait wait) const;
+
     // Set DUT profile
     status setProfile(const std::string& profileNumStr) const;
 
     // Set DUT variable voltage profile
     status setVariableVoltageProfile(const std::string& profileNumStr, const int& sinkVoltage) const;
 
-    // Set load current
-    status setLoad(const std::string& maxCurrent, const std::string& loadSpeed = "200", const DWORD& sleepTime = 500) const;
+    // Set load current. settleTimeout is the longest time to wait for the current to settle
+    status setLoad(const std::string& maxCurrent, const std::string& loadSpeed = "200", const DWORD& settleTimeout = 500) const;
 
     // Set load to zero
     status unload() const;
 
-    // Lock tester and run core 
-    void testSinkVoltage(const std::string& profileStr) const;
-};
+    // Current sweep settings
+    struct SweepConfig {
+        int coarseSteps = 10;       // Evenly spaced load steps from 0 to max current in the first pass
+        int resolution = 50;        // Stop bisecting once a pass/fail boundary is known to within this many mA
+        int currentTolerance = 50;  // Allowed mA between set and measured current, or 5% if larger
+        int failLimit = 2;          // End the coarse pass after this many consecutive failing steps
+    };
 
-class TesterStream {
-public:
-    TesterStream(const tester& t, const bool& error) : tRef(t), isError(error) {}
+    // One load step of a current sweep
+    struct SweepPoint {
+        int setCurrent;     // mA
+        int measCurrent;    // mA
+        int voltage;        // mV
+        bool pass;          // Measured current tracks set current and voltage is within +/-5% of target
+    };
 
-    // ADD THIS: Move Constructor
-    // It transfers the buffer from the old object to the new one
-    TesterStream(TesterStream&& other) noexcept 
-        : tRef(other.tRef), buffer(std::move(other.buffer)), isError(other.isError) {}
+    // Characterization of one profile at one voltage
+    struct SweepResult {
+        std::string profile;
+        int targetVoltage = 0;          // mV
+        int maxCurrent = 0;             // Advertised mA
+        bool voltageSet = false;        // False if the profile never reached target voltage, no points are taken
+        std::vector<SweepPoint> points; // Ordered by set current
+        int maxPassCurrent = -1;        // Highest passing mA below the first failure, -1 if none passed
+        int firstFailCurrent = -1;      // Lowest failing mA, -1 if every step passed
+    };
 
-    // Disable copying explicitly to prevent accidents
-    TesterStream(const TesterStream&) = delete;
-    TesterStream& operator=(const TesterStream&) = delete;
+    // Voltage grid settings for variable voltage profiles
+    struct VoltageGridConfig {
+        int initialPoints = 5;  // Evenly spaced voltages from vmin to vmax in the first pass
+        int resolution = 20;    // Smallest mV spacing to refine to, matches PPS programming step
+        int maxSteps = 40;      // Cap on voltages visited per profile, each one costs a current sweep
+    };
+
+    // Load steps of one current sweep: coarse steps, then bisection of each interval whose ends differ. Hands out one
+    // current at a time, so the blocking and the step-wise sweep visit the same points
+    class CurrentPlan
+    {
+    public:
+        CurrentPlan(const SweepConfig& cfg, const std::string& profile, const int& targetVoltage, const int& maxCurrent);
+
+        // Next load current to measure in mA. False once the sweep is complete
+        bool next(int& current);
 
-    ~TesterStream() {
-        // Only print if the buffer isn't empty (avoids double printing after a move)
-        std::string out = buffer.str();
-        if (out.empty()) return;
+        // Judge the sample taken at the current next() handed out
+        void measured(const status& Stats);
 
-        // Use a static Windows Critical Section
-        static CRITICAL_SECTION cs;
+        // Summarized result, once next() has returned false
+        SweepResult finish();
 
-        // Choose stream based on flag
-        std::ostream& output = isError ? std::cerr : std::cout;
+    private:
+        SweepConfig cfg;
+        SweepResult result;
+        int steps, coarseStep = 0, failures = 0;
+        bool coarseDone = false;
+        std::vector<SweepPoint> coarse; // Coarse points by current, once the coarse pass is over
+        size_t interval = 1;            // Coarse interval to bisect next, between coarse[interval - 1] and coarse[interval]
+        bool bisecting = false;
+        int lo = 0, hi = 0;
+        bool loPass = false;
+        int pending = 0;                // Current handed out by next()
+    };
+
+    // Voltages of one voltage grid: a sparse first pass, then breadth-first refinement between neighbours whose results
+    // differ, until the step budget runs out
+    class GridPlan
+    {
+    public:
+        GridPlan(const VoltageGridConfig& cfg, const int& currentResolution, const int& vMin, const int& vMax);
 
-        static bool initialized = false;
-        if (!initialized) {
-            InitializeCriticalSection(&cs);
-            initialized = true;
-        }
+        // Next voltage to characterize in mV. False once the grid is complete
+        bool next(int& voltage);
 
-        EnterCriticalSection(&cs); // Lock
+        // Result at the voltage next() handed out
+        void visited(SweepResult result);
 
-        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(hConsole, tRef.consoleColor);
-        output << "(" << tRef.serialNumber << ") " << out << std::endl;
-        SetConsoleTextAttribute(hConsole, 7);
+        // Results ordered by voltage, once next() has returned false
+        std::vector<SweepResult> finish();
 
-        LeaveCriticalSection(&cs); // Unlock
-    }
+    private:
+        VoltageGridConfig cfg;
+        int currentResolution;          // SweepConfig::resolution, results closer than this don't differ
+        std::vector<int> grid;          // First pass
+        size_t gridNext = 0;
+        int stepsLeft;
+        std::vector<SweepResult> results;
+
+        // Intervals still to refine, as (low, high) indices into results. Processed breadth first so the step
+        // budget is spread over every boundary rather than spent on the first one
+        std::deque<std::pair<size_t, size_t>> intervals;
+        std::optional<std::pair<size_t, size_t>> splitting; // Interval the voltage handed out by next() splits
+
+        int snap(const int& v) const;
+        bool differ(const SweepResult& a, const SweepResult& b) const;
+    };
+
+    SweepConfig sweepConfig;
+    VoltageGridConfig gridConfig;
+
+    // Sweep load current at the voltage currently set. Steps coarsely, then bisects only between steps whose results differ
+    SweepResult sweepCurrent(const std::string& profile, const int& targetVoltage, const int& maxCurrent) const;
+
+    // Sweep current if the profile reached target voltage, otherwise return a result with voltageSet false
+    SweepResult sweepAtVoltage(const std::string& profile, const int& targetVoltage, const int& maxCurrent, const status& Stats) const;
+
+    // Characterize a variable voltage profile on a sparse voltage grid, refining only between neighbouring
+    // voltages whose results differ. Results are ordered by voltage
+    std::vector<SweepResult> sweepVoltageGrid(const std::string& profile, const int& vMin, const int& vMax, const int& maxCurrent) const;
+
+    // Profiles named in profileStr (e.g. "1,3"), or every advertised profile if profileStr is empty
+    std::vector<std::string> selectProfiles(const std::string& profileStr);
+
+    // Characterize one profile: a single sweep for fixed profiles, a voltage grid for variable ones
+    std::vector<SweepResult> testProfile(const std::string& profile) const;
+
+    // Characterize the listed profiles (e.g. "1,3"), or every advertised profile if profileStr is empty
+    std::vector<SweepResult> testSinkVoltage(const std::string& profileStr);
+
+    /**
+     * @brief testProfile() as a Sched::Scheduler job. Each step() is one round trip to the console, a transition with
+     * its first sample or one settle sample, and hands the wait until the next sample back to the scheduler, so a
+     * small pool drives a whole rack. Cancelling the tester's token throws JobCancelled from the round trip in flight.
+     */
+    class ProfileSweep
+    {
+    public:
+        ProfileSweep(const tester& parent, const std::string& profile);
+
+        // Run the next round trip. Step::done() once results() is complete
+        Sched::Step step();
+
+        // Results ordered by voltage, as testProfile() returns them
+        const std::vector<SweepResult>& results() const { return found; }
+
+    private:
+        enum class Phase { Voltage, Load, Unload };
+
+        const tester& tRef;
+        std::string profile;
+        Pdo pdo;
+        std::optional<GridPlan> grid;       // Variable voltage profiles only
+        std::optional<CurrentPlan> sweep;   // Current sweep at the voltage being characterized
+        std::optional<SettleWait> settling; // Transition in flight
+        Phase phase = Phase::Voltage;
+        int voltage = 0;                    // Target of the voltage being characterized
+        bool started = false;
+        std::vector<SweepResult> found;
+
+        void settled(const status& Stats);
+        void nextVoltage();
+        void nextLoad();
+        void record(SweepResult result);
+    };
+
+    // unload() as a Sched::Scheduler job: profile 1, then no load, one round trip per step. Waits between samples
+    // with Step::sleepThrough, so a safety unload keeps its settle timing after the job is cancelled
+    class UnloadSteps
+    {
+    public:
+        explicit UnloadSteps(const tester& parent) : tRef(parent) {}
+
+        // Run the next round trip. Step::done() once the load is off
+        Sched::Step step();
+
+    private:
+        const tester& tRef;
+        int stage = 0;
+        std::optional<SettleWait> settling;
+    };
+};
+
+/**
+ * @brief Runs a tester's commands under 'token' for the scope's lifetime, e.g. a job's own token, or an
+ * uncancellable Cancel::Token() for the unload that must still happen after an abort.
+ */
+class TokenScope
+{
+public:
+    TokenScope(const tester& t, Cancel::Token token) : tRef(t), saved(std::move(t.token)) { t.token = std::move(token); }
+    ~TokenScope() { tRef.token = std::move(saved); }
+
+    TokenScope(const TokenScope&) = delete;
+    TokenScope& operator=(const TokenScope&) = delete;
+
+private:
+    const tester& tRef;
+    Cancel::Token saved;
+};
+
+/**
+ * @brief Formats one log line for a tester and hands it to the async log on destruction.
+ * Formatting happens in a per-thread buffer that is reused from line to line, so logging never takes
+ * a lock or touches the console on the tester's thread.
+ */
+class TesterStream {
+public:
+    TesterStream(const tester& t, const bool& error);
+
+    // Transfers the buffer from the old object to the new one
+    TesterStream(TesterStream&& other) noexcept
+        : tRef(other.tRef), isError(other.isError), buffer(other.buffer), prefixLength(other.prefixLength) { other.buffer = nullptr; }
+
+    // Disable copying explicitly to prevent accidents
+    TesterStream(const TesterStream&) = delete;
+    TesterStream& operator=(const TesterStream&) = delete;
+
+    ~TesterStream();
 
     template <typename T>
     TesterStream& operator<<(const T& msg) {
-        buffer << msg;
+        *buffer << msg;
         return *this;
     }
 
 private:
     const tester& tRef;
-    std::stringstream buffer;
-    const bool& isError;
+    bool isError;
+    std::ostringstream* buffer; // Borrowed from this thread's pool, NULL after a move
+    std::streamoff prefixLength; // Length of the "(SN) " prefix
+
+    static std::ostringstream* acquireBuffer();
+    static void releaseBuffer(std::ostringstream* buf);
 };
 
-// Run Passmark executable from cmd prompt and return info provided
+// Build console argv for a tester, e.g. {"USBPDPROConsole.exe", "-d", "<SN>", "-s"}
+std::vector<std::string> consoleArgv(const tester& Tester, const std::string& commandArg);
+
+// Key a console command is recorded under, e.g. "USBPDPROConsole.exe -d <SN> -s"
+std::string captureKey(const tester& Tester, const std::string& commandArg);
+
+// Deadline for one console command, by switch. PASSMARK_TIMEOUT_SCALE multiplies every default
+std::chrono::milliseconds commandTimeout(const std::string& commandArg);
+
+// Error for a tester's command that hit its deadline, e.g. "(SN) Console command -s timed out after 5s."
+Spawn::Timeout timeoutError(const tester& Tester, const std::string& commandArg, const std::chrono::milliseconds& timeout);
+
+// Run Passmark executable and return a view of its output. The view is valid until the tester's next command
+// In replay mode the response comes from the capture file instead (see ConsoleCapture.hpp).
+// Throws Spawn::Timeout if the console hangs past commandTimeout(), after killing it
+std::string_view runCommandView(const tester& Tester, const std::string& commandArg);
+
+// Run Passmark executable and return a copy of the info provided
 std::string runCommand(const tester& Tester, const std::string& commandArg);
 
 // Remove blank lines from Passmark console output string
 void removeBlankLines(std::string& string_to_filter);
-
-extern std::vector<std::string> VariableVoltageTypes;
\ No newline at end of file
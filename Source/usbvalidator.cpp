@@ -1,4 +1,6 @@
 #include "Passmark.hpp"
+#include "ConsoleCapture.hpp"
+#include "AsyncLog.hpp"
 
 #include <iostream>
 #include <vector>
@@ -6,34 +8,53 @@
 #include <Windows.h>
 #include <sstream>
 #include <stdexcept>
+#include <chrono>
+#include <optional>
 
-int main () {
+int main (int argc, char* argv[]) {
+    DiscoveryScope discovery; // Background tester discovery is cancelled and joined however main() returns
     // Initialize tester vector
     std::vector<tester> validTesters;
 
+    if (!SetConsoleCtrlHandler(CtrlHandler, TRUE)) { // Register control handler to handle Ctrl+C
+        std::cerr << "ERROR: Could not set control handler." << std::endl;
+        return -1;
+    }
+
     // ------------------
     // Core test sequence
     // ------------------
     try {
-        validTesters = getTesters(); // Discover Passmark testers and select which ones to use
+        // PASSMARK_RECORD / PASSMARK_REPLAY select record or offline replay of console traffic
+        if (!Capture::startFromEnvironment()) throw std::runtime_error("Could not open console capture file.");
 
-        // Create a thread for each tester to run tests simultaneously
-        std::vector<HANDLE> threadHandles;
-        for (auto& Tester : validTesters) {
+        // With a plan file nothing is asked, otherwise the operator picks testers and profiles
+        std::string plan = planPath(argc, argv);
+        std::vector<TesterPlan> assigned;
+        if (plan.empty()) validTesters = getTesters(); // Discover Passmark testers and select which ones to use
+        else validTesters = getPlannedTesters(TestPlan::load(plan), assigned);
+
+        // Create a job for each tester to run tests simultaneously
+        std::vector<std::pair<std::string, Sched::StepFn>> jobs; // Named by tester serial number
+        for (size_t t = 0; t < validTesters.size(); ++t) {
+            tester& Tester = validTesters[t];
             std::cout << "\nTester: " << Tester.serialNumber << "\n--------------------------" << std::endl; 
-            std::string output = Tester.getProfiles(true); // Discover supported profiles for DUT
-            size_t pos = output.find("NUM PROFILES:");
-            int numProfiles;
-            if (pos != std::string::npos) {
-                std::string numProfilesStr = output.substr(pos + 13); // Extract number of profiles from output
-                numProfiles = std::stoi(numProfilesStr);
-            }
+            Tester.sink.getProfiles(); // Discover supported profiles for DUT
+            int numProfiles = Tester.sink.pdos.size();
             if (numProfiles == 0) throw std::runtime_error("No DUT found."); // Check if no profiles are found
 
-            // Ask user which profile(s) to test
-            std::cout << "Select profile(s) to test or press enter to test all profiles:\t";
+            std::cout << "NUM PROFILES:" << numProfiles << std::endl;
+            for (const Pdo& pdo : Tester.sink.pdos.entries()) std::cout << pdo.line << std::endl;
+
+            // Ask user which profile(s) to test, unless the plan says
             std::string profileStr = "";
-            getline(std::cin, profileStr);
+            if (!assigned.empty()) {
+                profileStr = assigned[t].selectProfiles(Tester.sink.pdos);
+                std::cout << "Planned profile(s): " << profileStr << std::endl;
+            } else {
+                std::cout << "Select profile(s) to test or press enter to test all profiles:\t";
+                getline(std::cin, profileStr);
+            }
 
             // Check if profileStr is valid
             if (profileStr.empty()) {
@@ -43,40 +64,78 @@ int main () {
                 std::stringstream ss(profileStr);
                 while (getline(ss,field,',')) {
                     if (!is_numeric(field)) throw std::runtime_error("Profile selection must be an integer!");
-                    int profileNum = std::stoi(field);
-                    if (profileNum < 1 || profileNum > numProfiles) throw std::runtime_error("Selected profile is out of range!");
+                    if (Tester.sink.pdos.find(field) == nullptr) throw std::runtime_error("Selected profile is out of range!");
                 }
             }
 
-            // Create thread in suspended state
-            HANDLE hThread = Bridge::startSuspended([&Tester, &profileStr]() {
-                Tester.testSinkVoltage(profileStr); 
-            });
+            // One console round trip per step: a transition with its first sample, or one settle sample. The wait until the
+            // next sample is handed back to the scheduler, so a small pool drives every tester. profileStr is copied, it goes
+            // out of scope before the job runs
+            jobs.emplace_back(Tester.serialNumber, [&Tester, profileStr, profiles = std::vector<std::string>(), next = size_t(0), started = false,
+                                                    sweep = std::optional<tester::ProfileSweep>(),
+                                                    unload = std::optional<tester::UnloadSteps>()](Sched::TaskContext& ctx) mutable {
+                if (!started) {
+                    profiles = Tester.selectProfiles(profileStr);
+                    started = true;
+                }
 
-            // Check that handle isn't NULL
-            if (hThread != NULL) threadHandles.push_back(hThread);
-            else std::cerr << "Failed to create thread for tester. Error: " << GetLastError() << std::endl;
-        }
+                if (ctx.cancelled() || (!sweep && next == profiles.size())) {
+                    TokenScope uncancellable(Tester, Cancel::Token()); // Unload even after Ctrl+C
+                    if (!unload) unload.emplace(Tester);
+                    Sched::Step step = unload->step();
+                    if (step.kind == Sched::Step::Kind::Done && Cancel::global().cancelled()) {
+                        auto latency = std::chrono::steady_clock::now() - Cancel::global().cancelledAt();
+                        Tester.logErr() << "Test aborted. Load off " << std::chrono::duration_cast<std::chrono::milliseconds>(latency).count() << "ms after Ctrl+C.";
+                    }
+                    return step;
+                }
 
-        // Start threads once preparations are made
-        for (HANDLE h : threadHandles) {
-            if (h != NULL && h != INVALID_HANDLE_VALUE) ResumeThread(h);
+                // Ctrl+C kills the round trip in flight. The next step sees the cancelled group and unloads
+                try {
+                    if (!sweep) sweep.emplace(Tester, profiles[next++]);
+                    Sched::Step step = sweep->step();
+                    if (step.kind != Sched::Step::Kind::Done) return step;
+                } catch (const JobCancelled&) {
+                    if (!ctx.cancelled()) throw;
+                    return Sched::Step::yield();
+                }
+
+                for (const tester::SweepResult& r : sweep->results()) {
+                    if (!r.voltageSet) continue; // Already reported when the voltage wasn't reached
+                    Tester.log() << "Profile " << r.profile << " @ " << r.targetVoltage << "mV: "
+                                 << ((r.firstFailCurrent < 0) ? "PASS" : "FAIL") << ", max passing current = " << r.maxPassCurrent
+                                 << "mA of " << r.maxCurrent << "mA (" << r.points.size() << " steps)";
+                }
+                sweep.reset();
+                return Sched::Step::yield();
+            });
         }
 
-        // Halt main program until threads are finished
-        DWORD waitResult = WaitForMultipleObjects(
-            (DWORD)threadHandles.size(),
-            threadHandles.data(),
-            TRUE,
-            3.6e6 // 1hr time limit
-        );
+        // Start all jobs once preparations are made, then halt main program until they are finished. A step only blocks
+        // for one round trip, so a pool sized to the machine serves any number of testers
+        Sched::Scheduler scheduler;
+        Sched::TaskGroup group(scheduler);
+        group.completions().onComplete(reportOutcome); // Report each tester as soon as it finishes
+        Cancel::Registration cancelOnAbort = Cancel::global().onCancel([&group]() { group.cancel(); }); // Ctrl+C
+        for (auto& job : jobs) group.spawn(job.second, job.first);
+        group.wait();
+        Log::flush(); // Let queued tester output reach the console before anything else is printed
 
-        if (waitResult == WAIT_TIMEOUT || waitResult == WAIT_FAILED) throw std::runtime_error("One or more threads failed.");
+        Log::Stats logStats = Log::stats();
+        if (logStats.dropped > 0 || logStats.delayed > 0) {
+            Log::submit(7, true, "WARNING: Log dropped " + std::to_string(logStats.dropped) + " and delayed " + std::to_string(logStats.delayed) +
+                        " of " + std::to_string(logStats.written + logStats.dropped) + " lines");
+            Log::flush();
+        }
 
-        // Close handles
-        for (HANDLE h : threadHandles) CloseHandle(h);
-        threadHandles.clear();
+        if (g_abortRequested.load()) throw CtrlCAbort{};
+        if (group.failures() > 0) throw std::runtime_error("Test failed on " + group.completions().failedNames());
     } catch (const std::runtime_error&e) {
+        Log::flush();
+        std::cout << "Error: " << e.what() << std::endl;
+        return -1;
+    } catch (const CtrlCAbort& e) {
+        Log::flush();
         std::cout << "Error: " << e.what() << std::endl;
         return -1;
     }